@@ -4,28 +4,108 @@ import esphome.codegen as cg
 from esphome import pins
 from esphome import automation
 import esphome.config_validation as cv
-from esphome.components import display, spi
+import esphome.final_validate as fv
+from esphome.components import display, sensor, spi
 from esphome.const import (
     CONF_NAME,
     CONF_ID,
+    CONF_SPI_ID,
     CONF_RESET_PIN,
     CONF_PAGES,
     CONF_LAMBDA,
     CONF_REVERSED,
+    CONF_WIDTH,
+    CONF_HEIGHT,
+    STATE_CLASS_MEASUREMENT,
+    UNIT_MILLISECOND,
 )
 
 from esphome.const import __version__ as ESPHOME_VERSION
 
 DEPENDENCIES = ['spi']
+AUTO_LOAD = ['sensor']
 
 CONF_DISPLAY_CS_PIN = "display_cs_pin"
 CONF_READY_PIN = "ready_pin"
+CONF_FRAME_DIFF_MEMORY_BUDGET = "frame_diff_memory_budget"
+CONF_TRANSFER_BUFFER_SIZE = "transfer_buffer_size"
+CONF_FLUSH_TASK = "flush_task"
+CONF_QUEUE_DEPTH = "queue_depth"
+CONF_CORE = "core"
+CONF_UPDATE_MODE = "update_mode"
+CONF_UPDATE_MODE_REGIONS = "update_mode_regions"
+CONF_X = "x"
+CONF_Y = "y"
+CONF_GHOSTING = "ghosting"
+CONF_IDLE_TIME = "idle_time"
+CONF_MAX_CLEAN_AREA = "max_clean_area"
+CONF_BUDGET = "budget"
+CONF_PACKED_TRANSFERS = "packed_transfers"
+CONF_DOUBLE_BUFFERING = "double_buffering"
+CONF_SPI_AUTO_TUNE = "spi_auto_tune"
+CONF_WARM_BOOT = "warm_boot"
+CONF_POWER_SAVING = "power_saving"
+CONF_MODE = "mode"
+CONF_MAX_WRITE_RATE = "max_write_rate"
+CONF_MAX_READ_RATE = "max_read_rate"
+CONF_HARDWARE_ROTATION = "hardware_rotation"
+CONF_BAND_ROWS = "band_rows"
+CONF_PAGE_SLOTS = "page_slots"
+CONF_CONTROLLER_MEMORY = "controller_memory"
+CONF_SLOT = "slot"
+CONF_PAGE = "page"
+CONF_LATENCY_P50 = "latency_p50"
+CONF_LATENCY_P99 = "latency_p99"
 
 it8951e_ns = cg.esphome_ns.namespace('it8951e')
 IT8951EDisplay = it8951e_ns.class_(
     'IT8951EDisplay', cg.PollingComponent, spi.SPIDevice, display.DisplayBuffer
 )
 ClearAction = it8951e_ns.class_("ClearAction", automation.Action)
+PreloadPageAction = it8951e_ns.class_("PreloadPageAction", automation.Action)
+ShowPageAction = it8951e_ns.class_("ShowPageAction", automation.Action)
+UpdateMode = it8951e_ns.enum("UpdateMode", is_class=True)
+
+UPDATE_MODES = {
+    "AUTO": UpdateMode.Auto,
+    "DU": UpdateMode.DU,
+    "DU4": UpdateMode.DU4,
+    "A2": UpdateMode.A2,
+    "GC16": UpdateMode.GC16,
+    "GL16": UpdateMode.GL16,
+    "GLR16": UpdateMode.GLR16,
+    "GLD16": UpdateMode.GLD16,
+    "NONE": getattr(UpdateMode, "None"),
+}
+
+# Number of refreshes a display tile can take in each fast mode before it is cleaned
+GHOSTING_BUDGET_MODES = ["DU", "DU4", "A2", "GL16", "GLR16", "GLD16"]
+
+GHOSTING_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_IDLE_TIME): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_MAX_CLEAN_AREA): cv.positive_int,
+        cv.Optional(CONF_BUDGET): cv.Schema(
+            {cv.Optional(mode.lower()): cv.uint16_t for mode in GHOSTING_BUDGET_MODES}
+        ),
+    }
+)
+
+LATENCY_SENSOR_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_MILLISECOND,
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_MEASUREMENT,
+)
+
+UPDATE_MODE_REGION_SCHEMA = cv.Schema(
+    {
+        cv.Required(CONF_X): cv.int_range(min=0),
+        cv.Required(CONF_Y): cv.int_range(min=0),
+        cv.Required(CONF_WIDTH): cv.int_range(min=1),
+        cv.Required(CONF_HEIGHT): cv.int_range(min=1),
+        cv.Required(CONF_UPDATE_MODE): cv.enum(UPDATE_MODES, upper=True),
+    }
+)
 
 CONFIG_SCHEMA = cv.All(
     display.FULL_DISPLAY_SCHEMA.extend(
@@ -36,6 +116,44 @@ CONFIG_SCHEMA = cv.All(
             cv.Required(CONF_READY_PIN): pins.gpio_input_pin_schema,
             cv.Required(CONF_DISPLAY_CS_PIN): pins.gpio_input_pin_schema,
             cv.Optional(CONF_REVERSED): cv.boolean,
+            cv.Optional(CONF_FRAME_DIFF_MEMORY_BUDGET): cv.positive_int,
+            cv.Optional(CONF_TRANSFER_BUFFER_SIZE): cv.int_range(min=0, max=65536),
+            cv.Optional(CONF_FLUSH_TASK): cv.Schema(
+                {
+                    cv.Optional(CONF_QUEUE_DEPTH, default=2): cv.int_range(min=1, max=16),
+                    cv.Optional(CONF_CORE, default=0): cv.int_range(min=-1, max=1),
+                }
+            ),
+            cv.Optional(CONF_UPDATE_MODE): cv.enum(UPDATE_MODES, upper=True),
+            cv.Optional(CONF_UPDATE_MODE_REGIONS): cv.All(
+                cv.ensure_list(UPDATE_MODE_REGION_SCHEMA), cv.Length(max=8)
+            ),
+            cv.Optional(CONF_GHOSTING): GHOSTING_SCHEMA,
+            cv.Optional(CONF_PACKED_TRANSFERS): cv.boolean,
+            cv.Optional(CONF_DOUBLE_BUFFERING): cv.boolean,
+            cv.Optional(CONF_WARM_BOOT): cv.boolean,
+            cv.Optional(CONF_POWER_SAVING): cv.Schema(
+                {
+                    cv.Optional(CONF_IDLE_TIME, default="10s"): cv.positive_time_period_milliseconds,
+                    cv.Optional(CONF_MODE, default="SLEEP"): cv.one_of("STANDBY", "SLEEP", upper=True),
+                }
+            ),
+            cv.Optional(CONF_SPI_AUTO_TUNE): cv.Schema(
+                {
+                    cv.Optional(CONF_MAX_WRITE_RATE, default="40MHz"): cv.All(
+                        cv.frequency, cv.Range(min=16e6, max=40e6)
+                    ),
+                    cv.Optional(CONF_MAX_READ_RATE, default="20MHz"): cv.All(
+                        cv.frequency, cv.Range(min=16e6, max=40e6)
+                    ),
+                }
+            ),
+            cv.Optional(CONF_HARDWARE_ROTATION): cv.boolean,
+            cv.Optional(CONF_BAND_ROWS): cv.int_range(min=0, max=2048),
+            cv.Optional(CONF_PAGE_SLOTS): cv.int_range(min=0, max=8),
+            cv.Optional(CONF_CONTROLLER_MEMORY): cv.int_range(min=1024 * 1024, max=64 * 1024 * 1024),
+            cv.Optional(CONF_LATENCY_P50): LATENCY_SENSOR_SCHEMA,
+            cv.Optional(CONF_LATENCY_P99): LATENCY_SENSOR_SCHEMA,
         }
     )
     .extend(cv.polling_component_schema("1s"))
@@ -43,6 +161,28 @@ CONFIG_SCHEMA = cv.All(
     cv.has_at_most_one_key(CONF_PAGES, CONF_LAMBDA),
 )
 
+def _final_validate(config):
+    # The flush task drives the SPI bus outside of the main loop, which other SPI devices are used from
+    if CONF_FLUSH_TASK not in config:
+        return config
+    full_config = fv.full_config.get()
+    for domain, domain_config in full_config.items():
+        items = domain_config if isinstance(domain_config, list) else [domain_config]
+        for item in items:
+            if (
+                isinstance(item, dict)
+                and item.get(CONF_SPI_ID) == config[CONF_SPI_ID]
+                and item.get(CONF_ID) != config[CONF_ID]
+            ):
+                raise cv.Invalid(
+                    f"The flush task needs the SPI bus '{config[CONF_SPI_ID]}' for itself, "
+                    f"but a {domain} component uses it too",
+                    path=[CONF_FLUSH_TASK],
+                )
+    return config
+
+FINAL_VALIDATE_SCHEMA = _final_validate
+
 @automation.register_action(
     "IT8951E.clear",
     ClearAction,
@@ -57,6 +197,45 @@ async def bm8563_read_time_to_code(config, action_id, template_arg, args):
     await cg.register_parented(var, config[CONF_ID])
     return var
 
+@automation.register_action(
+    "IT8951E.preload_page",
+    PreloadPageAction,
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.use_id(IT8951EDisplay),
+            cv.Required(CONF_SLOT): cv.templatable(cv.int_range(min=0, max=7)),
+            cv.Required(CONF_PAGE): cv.use_id(display.DisplayPage),
+        }
+    ),
+)
+async def preload_page_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    slot = await cg.templatable(config[CONF_SLOT], args, cg.uint8)
+    cg.add(var.set_slot(slot))
+    page = await cg.get_variable(config[CONF_PAGE])
+    cg.add(var.set_page(page))
+    return var
+
+@automation.register_action(
+    "IT8951E.show_page",
+    ShowPageAction,
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.use_id(IT8951EDisplay),
+            cv.Required(CONF_SLOT): cv.templatable(cv.int_range(min=0, max=7)),
+            cv.Optional(CONF_UPDATE_MODE, default="GC16"): cv.enum(UPDATE_MODES, upper=True),
+        }
+    ),
+)
+async def show_page_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    slot = await cg.templatable(config[CONF_SLOT], args, cg.uint8)
+    cg.add(var.set_slot(slot))
+    cg.add(var.set_update_mode(config[CONF_UPDATE_MODE]))
+    return var
+
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await display.register_display(var, config)
@@ -80,3 +259,60 @@ async def to_code(config):
         cg.add(var.set_ready_pin(ready))
     if CONF_REVERSED in config:
         cg.add(var.set_reversed(config[CONF_REVERSED]))
+    if CONF_FRAME_DIFF_MEMORY_BUDGET in config:
+        cg.add(var.set_frame_diff_memory_budget(config[CONF_FRAME_DIFF_MEMORY_BUDGET]))
+    if CONF_TRANSFER_BUFFER_SIZE in config:
+        cg.add(var.set_transfer_buffer_size(config[CONF_TRANSFER_BUFFER_SIZE]))
+    if CONF_FLUSH_TASK in config:
+        flush_task = config[CONF_FLUSH_TASK]
+        cg.add(var.set_flush_task(flush_task[CONF_QUEUE_DEPTH], flush_task[CONF_CORE]))
+    if CONF_UPDATE_MODE in config:
+        cg.add(var.set_update_mode(config[CONF_UPDATE_MODE]))
+    for region in config.get(CONF_UPDATE_MODE_REGIONS, []):
+        cg.add(
+            var.add_update_mode_region(
+                region[CONF_X],
+                region[CONF_Y],
+                region[CONF_WIDTH],
+                region[CONF_HEIGHT],
+                region[CONF_UPDATE_MODE],
+            )
+        )
+    if CONF_GHOSTING in config:
+        ghosting = config[CONF_GHOSTING]
+        if CONF_IDLE_TIME in ghosting:
+            cg.add(var.set_ghosting_idle_time(ghosting[CONF_IDLE_TIME]))
+        if CONF_MAX_CLEAN_AREA in ghosting:
+            cg.add(var.set_max_clean_area(ghosting[CONF_MAX_CLEAN_AREA]))
+        for mode, refreshes in ghosting.get(CONF_BUDGET, {}).items():
+            cg.add(var.set_ghosting_budget(UPDATE_MODES[mode.upper()], refreshes))
+    if CONF_PACKED_TRANSFERS in config:
+        cg.add(var.set_packed_transfers(config[CONF_PACKED_TRANSFERS]))
+    if CONF_DOUBLE_BUFFERING in config:
+        cg.add(var.set_double_buffering(config[CONF_DOUBLE_BUFFERING]))
+    if CONF_POWER_SAVING in config:
+        power_saving = config[CONF_POWER_SAVING]
+        cg.add(var.set_power_saving(
+            power_saving[CONF_IDLE_TIME], power_saving[CONF_MODE] == "SLEEP"
+        ))
+    if CONF_WARM_BOOT in config:
+        cg.add(var.set_warm_boot(config[CONF_WARM_BOOT]))
+    if CONF_SPI_AUTO_TUNE in config:
+        spi_auto_tune = config[CONF_SPI_AUTO_TUNE]
+        cg.add(var.set_spi_auto_tune(
+            int(spi_auto_tune[CONF_MAX_WRITE_RATE]), int(spi_auto_tune[CONF_MAX_READ_RATE])
+        ))
+    if CONF_HARDWARE_ROTATION in config:
+        cg.add(var.set_hardware_rotation(config[CONF_HARDWARE_ROTATION]))
+    if CONF_BAND_ROWS in config:
+        cg.add(var.set_band_rows(config[CONF_BAND_ROWS]))
+    if CONF_PAGE_SLOTS in config:
+        cg.add(var.set_page_slots(config[CONF_PAGE_SLOTS]))
+    if CONF_CONTROLLER_MEMORY in config:
+        cg.add(var.set_controller_memory(config[CONF_CONTROLLER_MEMORY]))
+    if CONF_LATENCY_P50 in config:
+        sens = await sensor.new_sensor(config[CONF_LATENCY_P50])
+        cg.add(var.set_latency_p50_sensor(sens))
+    if CONF_LATENCY_P99 in config:
+        sens = await sensor.new_sensor(config[CONF_LATENCY_P99])
+        cg.add(var.set_latency_p99_sensor(sens))
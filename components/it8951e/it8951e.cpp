@@ -1,23 +1,36 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
-#include "esphome/core/log.h"
-#include "it8951e.h"
-#include "it8951e_priv.h"
-#include "esphome/core/application.h"
-#include "esphome/core/gpio.h"
+#include "it8951e_impl.h"
 
-#include <list>
 #include <memory>
+#include <new>
+
+#ifdef USE_ESP32
+#include <esp_heap_caps.h>
+#endif
 
 
 namespace esphome {
 namespace it8951e {
 
-static const char *TAG = "it8951e.display";
+// Interval between two LUT status polls while refreshes are in progress. Also the resolution of the LUT busy times.
+static constexpr uint32_t BUSY_POLL_MS = 10;
+
+// Names of the update modes, in the order of the enum
+static const char * const UPDATE_MODE_NAMES[] = {"INIT", "DU", "GC16", "GL16", "GLR16", "GLD16", "DU4", "A2"};
+
+// Bit of UP1SR2 making the display engine read 1bpp image data, mapped to gray levels through BGVR
+static constexpr uint16_t UP1SR2_1BPP = 1u << 2;
 
-static constexpr uint16_t PREAMBLE_COMMAND = 0x6000;
-static constexpr uint16_t PREAMBLE_WRITE_DATA = 0x0000;
-static constexpr uint16_t PREAMBLE_READ_DATA = 0x1000;
+// Fixed cost of transferring one more area, in bytes of image data: the command transactions of the area are
+// worth roughly this many bytes of pixel data at the default SPI clock
+static constexpr uint32_t AREA_OVERHEAD_BYTES = 1024;
+
+// Rows of the internal RAM strip used for band rendering, when the frame buffer cannot be allocated
+static constexpr uint16_t DEFAULT_BAND_ROWS = 64;
+
+// VCOM voltage of the panel, in mV (-2.30 V)
+static constexpr uint16_t VCOM_MV = 2300;
 
 
 #ifdef ARDUINO
@@ -30,103 +43,118 @@ using std::make_unique;
 #endif
 
 
-#if defined(IT8951E_ENABLE_DEBUG_LOGGING) && (IT8951E_ENABLE_DEBUG_LOGGING==1)
-#define IT8951E_LOGD ESP_LOGD
-#else
-#define IT8951E_LOGD(...)
-#endif
-
-class IT8951EDisplay::Impl
-{
-  public:
-    Impl(IT8951EDisplay *parent) : parent(parent) {}
-
-    void setup();
-    void clear(bool const init) const;
-    void write_buffer_to_display(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h) const;
-    void notify_update(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h);
-
-    size_t get_buffer_size() const;
-    void init_buffer(size_t buffer_size);
-    void put_pixel(int const x, int const y, Color const color);
-    void do_update();
-
-    char lut_version[17] = {0};
-    char fw_version[17] = {0};
-
-    uint16_t width = 960;
-    uint16_t height = 540;
-
-    bool reversed = false;
-
-    GPIOPin *reset_pin = nullptr;
-    GPIOPin *ready_pin = nullptr;
-    GPIOPin *cs_pin = nullptr;
-
-  private:
-    IT8951EDisplay *parent;
-
-    struct Rect {
-        uint16_t x, y, w, h;
-    };
-
-    std::list<Rect> update_areas;
-
-    uint8_t *buffer = nullptr;
-
-    uint32_t last_update_time = 0;
-    bool schedule_clean = false;
-
-    uint16_t image_buffer_address_high = 0x0012;
-    uint16_t image_buffer_address_low = 0x36e0;
-
-    void reset();
-
-    bool wait_comms_ready(uint32_t const timeout = 3000) const;
-    bool wait_display_ready(uint32_t const timeout = 3000) const;
-
-    void send_command(Command const command) const;
-    void send_command_with_args(Command const cmd, uint16_t const * const args, uint16_t const length) const;
-    void write_word(uint16_t const data) const;
-    uint16_t read_word() const;
-    void read_bytes(void * const buf, uint16_t const length) const;
-    void update_device_info();
-
-    uint16_t read_register(Register const address) const;
-    void write_register(Register const address, uint16_t const data) const;
-    void set_area(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h) const;
-    void update_area(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h, UpdateMode const mode) const;
-    void set_target_memory_addr(uint16_t const address_high, uint16_t const address_low) const;
-
-};
-
-
 /**
- * @brief Guard class to allow the CS pin to be automatically deactivated
+ * @brief Map a rectangle in display (rotated) coordinates to the frame buffer, like DisplayBuffer::draw_pixel_at
+ * does for pixels
+ *
+ * @param rotation Display rotation
+ * @param width Frame buffer width
+ * @param height Frame buffer height
+ * @param x1 Left edge of the rectangle
+ * @param y1 Top edge of the rectangle
+ * @param x2 Right edge of the rectangle, exclusive
+ * @param y2 Bottom edge of the rectangle, exclusive
+ *
+ * @return The rectangle in frame buffer coordinates
  */
-class SelectDevice
+static Area to_physical(display::DisplayRotation const rotation, int const width, int const height,
+                        int const x1, int const y1, int const x2, int const y2)
 {
-    public:
-        SelectDevice(GPIOPin *pin) : cs_pin(pin) { this->cs_pin->digital_write(false); }
-        ~SelectDevice() { this->cs_pin->digital_write(true); }
-
-    private:
-        GPIOPin *cs_pin;
-};
+    uint16_t const w = x2 - x1;
+    uint16_t const h = y2 - y1;
+    switch (rotation)
+    {
+        case display::DISPLAY_ROTATION_90_DEGREES:
+            return Area{static_cast<uint16_t>(width - y2), static_cast<uint16_t>(x1), h, w};
+        case display::DISPLAY_ROTATION_180_DEGREES:
+            return Area{static_cast<uint16_t>(width - x2), static_cast<uint16_t>(height - y2), w, h};
+        case display::DISPLAY_ROTATION_270_DEGREES:
+            return Area{static_cast<uint16_t>(y1), static_cast<uint16_t>(height - x2), h, w};
+        default:
+            return Area{static_cast<uint16_t>(x1), static_cast<uint16_t>(y1), w, h};
+    }
+}
 
 
 /**
  * @brief Allocate memory for the local screen buffer
+ *
+ * The full frame buffer goes to PSRAM. In band rendering mode, or if the frame buffer cannot be allocated, a strip
+ * of rows is allocated in internal RAM instead.
+ *
  * @param buffer_size Size of buffer to allocate
  */
 void IT8951EDisplay::Impl::init_buffer(size_t buffer_size)
 {
     ExternalRAMAllocator<uint8_t> allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
-    this->buffer = allocator.allocate(buffer_size);
+
+    if ((this->band_rows == 0) || (this->band_rows >= this->height))
+    {
+        this->buffer = allocator.allocate(buffer_size);
+        if (this->buffer)
+        {
+            this->buffer_rows = this->height;
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Could not allocate buffer for display, rendering in bands of %u rows", DEFAULT_BAND_ROWS);
+        }
+    }
+
     if (this->buffer == nullptr)
     {
-        ESP_LOGE(TAG, "Could not allocate buffer for display!");
-        return;
+        uint16_t const rows = std::min(this->band_rows ? this->band_rows : DEFAULT_BAND_ROWS, this->height);
+        size_t const strip_size = static_cast<size_t>(rows) * (this->width >> 1);
+#ifdef USE_ESP32
+        this->buffer = static_cast<uint8_t *>(heap_caps_malloc(strip_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+#else
+        this->buffer = new (std::nothrow) uint8_t[strip_size];
+#endif
+        if (this->buffer == nullptr)
+        {
+            ESP_LOGE(TAG, "Could not allocate buffer for display!");
+            return;
+        }
+        this->buffer_rows = rows;
+    }
+
+    if (this->is_banded())
+    {
+        if (this->frame_diff_budget)
+        {
+            ESP_LOGW(TAG, "Frame diff is not available in band rendering mode");
+        }
+    }
+    else
+    {
+        this->band_height = this->buffer_rows;
+
+        if (this->frame_diff_budget >= buffer_size)
+        {
+            this->sent_buffer = allocator.allocate(buffer_size);
+            if (this->sent_buffer == nullptr)
+            {
+                ESP_LOGW(TAG, "Could not allocate frame diff buffer, frame diff disabled");
+            }
+        }
+        else if (this->frame_diff_budget)
+        {
+            ESP_LOGW(TAG, "Frame diff needs %zu bytes, more than the %" PRIu32 " bytes budget. Frame diff disabled",
+                buffer_size, this->frame_diff_budget);
+        }
+    }
+
+    if (this->transfer_buffer_size)
+    {
+#ifdef USE_ESP32
+        this->transfer_buffer = static_cast<uint8_t *>(heap_caps_malloc(this->transfer_buffer_size, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL));
+#else
+        this->transfer_buffer = new (std::nothrow) uint8_t[this->transfer_buffer_size];
+#endif
+        if (this->transfer_buffer == nullptr)
+        {
+            ESP_LOGW(TAG, "Could not allocate %zu bytes transfer buffer, sending rows one by one", this->transfer_buffer_size);
+        }
     }
 }
 
@@ -140,6 +168,7 @@ void IT8951EDisplay::Impl::setup()
     this->reset_pin->setup();
     this->reset_pin->digital_write(true);
     this->reset_pin->pin_mode(gpio::FLAG_OUTPUT);
+    // Also on a warm boot: the controller lost its power in deep sleep
     this->reset();
 
     this->cs_pin->setup();
@@ -149,18 +178,82 @@ void IT8951EDisplay::Impl::setup()
     this->ready_pin->setup();
     this->ready_pin->pin_mode(gpio::FLAG_INPUT);
 
-    this->update_device_info();
+    if (this->spi_auto_tune)
+    {
+        // Also stores the rates lowered after a warm boot
+        this->rate_preference = global_preferences->make_preference<BusRates>(fnv1_hash("it8951e_bus_rates"));
+    }
+
+    if (!this->warm_boot || !this->restore_warm_boot())
+    {
+        this->update_device_info();
+        if (this->spi_auto_tune && !this->parent->is_failed())
+        {
+            this->tune_bus();
+        }
+    }
+
+    this->panel_width = this->width;
+    this->panel_height = this->height;
+    if ((this->rotation == display::DISPLAY_ROTATION_90_DEGREES) || (this->rotation == display::DISPLAY_ROTATION_270_DEGREES))
+    {
+        std::swap(this->width, this->height);
+    }
+
+    this->check_memory_layout();
+    if (this->parent->is_failed())
+    {
+        return;
+    }
+
+    this->dirty.init(this->width, this->height);
+    this->ghosting.init(this->width, this->height);
+    this->cleaning.init(this->width, this->height);
+    this->stale.init(this->width, this->height);
 
     this->init_buffer(this->get_buffer_size());
 
+    if (this->page_slots && !this->is_banded() && !this->allocate_snapshot())
+    {
+        ESP_LOGE(TAG, "Could not allocate the buffer pages are rendered into, page slots disabled");
+        this->page_slots = 0;
+    }
+
     this->send_command(Command::TCON_SYS_RUN);
 
-    this->write_register(Register::I80PCR, 0x0001);
+    this->configure();
+
+    this->last_activity = millis();
+}
+
+
+/**
+ * @brief Allocate the snapshot, in PSRAM, unless already done
+ * @return true if the snapshot is allocated
+ */
+bool IT8951EDisplay::Impl::allocate_snapshot()
+{
+    if (this->snapshot == nullptr)
+    {
+        ExternalRAMAllocator<uint8_t> allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
+        this->snapshot = allocator.allocate(this->get_buffer_size());
+        this->snapshot_valid = false;
+    }
+    return this->snapshot != nullptr;
+}
 
-    // Set vcom to -2.30v
-    IT8951E_LOGD(TAG, "Set VCOM");
-    uint16_t const args[2] = {0x0001, 2300};
-    this->send_command_with_args(Command::I80_CMD_VCOM, args, 2);
+
+/**
+ * @brief Program the host interface and the VCOM voltage, after setup and after waking the controller
+ *
+ * UP1SR2 is read back as well: the 1bpp display mode, used by solid fills in any configuration, only changes its
+ * own bit and keeps the others as the controller has them.
+ */
+void IT8951EDisplay::Impl::configure() const
+{
+    this->write_register(Register::I80PCR, 0x0001);
+    this->set_vcom(VCOM_MV);
+    this->up1sr2 = this->read_register(Register::UP1SR2) & ~UP1SR2_1BPP;
 }
 
 
@@ -169,6 +262,10 @@ void IT8951EDisplay::Impl::setup()
  */
 void IT8951EDisplay::Impl::reset()
 {
+    this->shadow.invalidate();
+    this->scheduler.clear();
+    this->one_bpp_display = false;
+
     this->reset_pin->digital_write(true);
     this->reset_pin->digital_write(false);
     delay(20);
@@ -178,214 +275,222 @@ void IT8951EDisplay::Impl::reset()
 
 
 /**
- * @brief Block until the ready pin goes high
+ * @brief Block until the display is ready
  * @param timeout Timeout in ms
  *
- * @return true if ready pin is high within the timeout, false otherwise
+ * @return true if display is ready within the timeout, false otherwise
  */
-bool IT8951EDisplay::Impl::wait_comms_ready(uint32_t const timeout) const
+bool IT8951EDisplay::Impl::wait_display_ready(uint32_t const timeout) const
 {
     uint32_t const start_time = millis();
-    while (millis() - start_time < timeout)
+    while (millis() - start_time <= timeout)
     {
-        if (this->ready_pin->digital_read())
+        if (this->poll_busy_luts() == 0)
         {
             return true;
         }
-        delay(10);
+        this->keep_alive(BUSY_POLL_MS);
     }
+    this->scheduler.clear();
     return false;
 }
 
 
 /**
- * @brief Send a command to the display
- * @param command Command to write
+ * @brief Block until an area can be loaded and refreshed: it must not overlap a refresh in progress, and a LUT
+ * engine must be free. Refreshes of other areas may still be running.
+ *
+ * @param area Area, in frame buffer coordinates
+ * @param timeout Timeout in ms. The refreshes in progress are then forgotten.
+ *
+ * @return true if the area is ready within the timeout, false otherwise
  */
-void IT8951EDisplay::Impl::send_command(Command const command) const
+bool IT8951EDisplay::Impl::wait_area_ready(Area const &area, uint32_t const timeout) const
 {
-    IT8951E_LOGD(TAG, "Write command 0x%02x", command);
-    if (!this->wait_comms_ready())
+    uint32_t const start_time = micros();
+    bool waited = false;
+    bool ready = false;
+
+    while (!ready)
     {
-        ESP_LOGE(TAG, "Display busy trying to write preamble for command 0x%04x", command);
+        ready = this->scheduler.can_start(area, this->poll_busy_luts());
 
-        return;
+        if (!ready)
+        {
+            if (micros() - start_time > timeout * 1000)
+            {
+                ESP_LOGW(TAG, "Timeout waiting for the refresh of (%d, %d) --> (%d, %d)", area.x, area.y, area.x + area.w, area.y + area.h);
+                this->scheduler.clear();
+                break;
+            }
+
+            waited = true;
+            this->keep_alive(BUSY_POLL_MS);
+        }
     }
 
-    SelectDevice display(this->cs_pin);
-
-    this->parent->write_byte16(PREAMBLE_COMMAND);
-
-    if (!this->wait_comms_ready())
+    if (waited)
     {
-        ESP_LOGE(TAG, "Display busy trying to write command 0x%04x", command);
-        return;
+        this->stats.refresh_waits++;
+        this->stats.refresh_wait_us += micros() - start_time;
     }
 
-    this->parent->write_byte16(static_cast<uint16_t>(command));
+    return ready;
 }
 
 
 /**
- * @brief Write a word (uint16_t) to the display
- * @param data Data to write
+ * @brief Wait until an area can be loaded with new image data, into the image buffer or the back buffer
+ *
+ * Without double buffering, this waits for the area to be ready to refresh. With double buffering, the data is
+ * loaded into whichever frame no refresh in progress displays the area from, while the refreshes go on: the
+ * transfer then overlaps the waveform time instead of following it.
+ *
+ * @param area Area, in frame buffer coordinates
+ * @param timeout Timeout in ms. The refreshes in progress are then forgotten.
+ *
+ * @return Frame to load the area into: FRAME_IMAGE or FRAME_BACK
  */
-void IT8951EDisplay::Impl::write_word(uint16_t const data) const
+uint32_t IT8951EDisplay::Impl::wait_load_ready(Area const &area, uint32_t const timeout) const
 {
-    IT8951E_LOGD(TAG, "Write word 0x%04x", data);
-    if (!this->wait_comms_ready())
+    // Refreshes of rotated areas are widened to the panel granularity, beyond the loaded data
+    if (!this->double_buffering || (this->rotation != display::DISPLAY_ROTATION_0_DEGREES))
     {
-        ESP_LOGE(TAG, "Display busy trying to write preamble for writing 0x%04x", data);
-        return;
+        this->wait_area_ready(area, timeout);
+        return FRAME_IMAGE;
     }
 
-    SelectDevice display(this->cs_pin);
-    this->parent->write_byte16(PREAMBLE_WRITE_DATA);
+    uint32_t const start_time = micros();
+    bool waited = false;
+    uint32_t frame = FRAME_IMAGE;
 
-    if (!this->wait_comms_ready())
+    while (true)
     {
-        ESP_LOGE(TAG, "Display busy trying to write 0x%04x", data);
-        return;
-    }
-    this->parent->write_byte16(data);
-}
+        this->poll_busy_luts();
+
+        if (this->scheduler.can_load(area, this->get_frame_address(FRAME_IMAGE)))
+        {
+            break;
+        }
 
+        if (this->scheduler.can_load(area, this->get_frame_address(FRAME_BACK)))
+        {
+            frame = FRAME_BACK;
+            break;
+        }
 
-/**
- * @brief Read a multiple bytes from the display.
- *
- * Read multiple bytes from the display into the given address.
- *
- * A read shorter than 4 bytes will read 4 bytes from the device over SPI and return only
- * the requested number of bytes.
- *
- * Chaining multiple read_bytes calls, with sizes less than 4 bytes may result in a
- * misaligned read and data loss.
- *
- * This is confirmed on ESP32 when DMA is enabled (automatically usually)
- *
- * @arg buf Pointer to the buffer to read into
- * @arg length Number of bytes to read
- */
-void IT8951EDisplay::Impl::read_bytes(void * const buf, uint16_t const length) const
-{
-    if (!this->wait_comms_ready())
-    {
-        ESP_LOGE(TAG, "Display not ready to receive read data preamble");
-        return;
-    }
+        if (micros() - start_time > timeout * 1000)
+        {
+            ESP_LOGW(TAG, "Timeout waiting for the refresh of (%d, %d) --> (%d, %d)", area.x, area.y, area.x + area.w, area.y + area.h);
+            this->scheduler.clear();
+            break;
+        }
 
-    SelectDevice display(this->cs_pin);
-    this->parent->write_byte16(PREAMBLE_READ_DATA);
+        waited = true;
+        this->keep_alive(BUSY_POLL_MS);
+    }
 
-    if (!this->wait_comms_ready())
+    if (waited)
     {
-        ESP_LOGE(TAG, "Display not ready to receive read data dummy bytes");
-        return;
+        this->stats.refresh_waits++;
+        this->stats.refresh_wait_us += micros() - start_time;
     }
 
-    this->parent->write_byte16(PREAMBLE_WRITE_DATA);
-    if (!this->wait_comms_ready())
+    if (this->scheduler.get_in_flight())
     {
-        ESP_LOGE(TAG, "Display not ready to send data");
-        return;
+        this->stats.overlapped_loads++;
     }
 
-    this->parent->transfer_array(reinterpret_cast<uint8_t *>(buf), length);
+    return frame;
 }
 
 
 /**
- * @brief Read a word (uint16_t) from the display
- *
- * @return uint16_t The word read from the display
+ * @brief Read the LUT engine status, and account the refreshes that are over
+ * @return Value of the LUTAFSR register, one bit per busy engine
  */
-uint16_t IT8951EDisplay::Impl::read_word() const
+uint16_t IT8951EDisplay::Impl::poll_busy_luts() const
 {
-    uint16_t read_data;
-    this->read_bytes(&read_data, 2);
+    uint16_t const busy_luts = this->read_register(Register::LUTAFSR);
+    uint32_t const now = millis();
+
+    RefreshSample done[RefreshScheduler::MAX_IN_FLIGHT];
+    size_t const count = this->scheduler.update(busy_luts, now, done);
+    for (size_t i = 0; i < count; i++)
+    {
+        this->record_sample(done[i]);
+    }
 
-    // IT8951E is big-endian and ESP32 is little-endian
-    return ((read_data & 0xFF00) >> 8) | ((read_data & 0x00FF) << 8);
+    this->next_busy_poll = now + BUSY_POLL_MS;
+    return busy_luts;
 }
 
 
 /**
- * @brief Send to the display a command with arguments
+ * @brief Display busy state machine: poll the LUT engine status while refreshes are in progress, at most once
+ * every BUSY_POLL_MS. Cheap to call when nothing is due.
  *
- * @param cmd Command to send
- * @param args Arguments to send, uint16_t. Endianness conversion is done automatically.
- * @param length Number of arguments
+ * @return Time in ms until the next poll is due, 0 if no refresh is in progress
  */
-void IT8951EDisplay::Impl::send_command_with_args(Command const cmd, uint16_t const * const args, uint16_t const length) const
+uint32_t IT8951EDisplay::Impl::service_refreshes() const
 {
-    this->send_command(cmd);
-    if (!this->wait_comms_ready())
+    if (this->scheduler.get_in_flight() == 0)
     {
-        ESP_LOGE(TAG, "Display not ready to receive command arguments preamble");
-        return;
+        return 0;
     }
 
-    SelectDevice display(this->cs_pin);
-    this->parent->write_byte16(PREAMBLE_WRITE_DATA);
-
-    for (uint16_t argument = 0; argument < length; argument++)
+    int32_t const due = static_cast<int32_t>(this->next_busy_poll - millis());
+    if (due > 0)
     {
-        if (!this->wait_comms_ready())
-        {
-            ESP_LOGE(TAG, "Display not ready to receive command argument #%d", argument);
-            return;
-        }
-        this->parent->write_byte16(args[argument]);
+        return due;
     }
+
+    this->poll_busy_luts();
+    return this->scheduler.get_in_flight() ? BUSY_POLL_MS : 0;
 }
 
 
 /**
- * @brief Read a display register
- * @param address Register address
- *
- * @return Register value
+ * @brief Account the timing of a finished refresh
+ * @param sample Timing of the refresh
  */
-uint16_t IT8951EDisplay::Impl::read_register(Register const address) const
+void IT8951EDisplay::Impl::record_sample(RefreshSample const &sample) const
 {
-    this->send_command(Command::TCON_REG_RD);
-    this->write_word(static_cast<uint16_t>(address));
-    uint16_t word = this->read_word();
-    return word;
-}
+    IT8951E_LOGD(TAG, "Refresh %s: transfer %" PRIu32 " us, LUT busy %" PRIu32 " ms",
+        (sample.mode < UpdateMode::None) ? UPDATE_MODE_NAMES[static_cast<size_t>(sample.mode)] : "?",
+        sample.transfer_us, sample.busy_ms);
 
-
-/**
- * @brief Write a display register
- * @param address Register address
- * @param data Data to write to register
- */
-void IT8951EDisplay::Impl::write_register(Register const address, uint16_t const data) const {
-    this->send_command(Command::TCON_REG_WR);  // tcon write reg command
-    this->write_word(static_cast<uint16_t>(address));
-    this->write_word(data);
+    if (this->flush_task.is_running())
+    {
+        // Dropped if the main loop does not keep up
+        this->refresh_samples.push(sample);
+    }
+    else
+    {
+        this->telemetry.add(sample);
+    }
 }
 
 
 /**
- * @brief Block until the display is ready
- * @param timeout Timeout in ms
- *
- * @return true if display is ready within the timeout, false otherwise
+ * @brief Publish the refresh latency percentiles, if refreshes finished since the last call. Called in the main loop.
  */
-bool IT8951EDisplay::Impl::wait_display_ready(uint32_t const timeout) const
+void IT8951EDisplay::Impl::publish_latency()
 {
-    uint32_t const start_time = millis();
-    while (millis() - start_time > timeout)
+    if (this->telemetry.get_sample_count() == this->published_samples)
     {
-        if (this->read_register(Register::LUTAFSR) == 0)
-        {
-            return true;
-        }
-        App.feed_wdt();
+        return;
+    }
+    this->published_samples = this->telemetry.get_sample_count();
+
+    if (this->latency_p50_sensor != nullptr)
+    {
+        this->latency_p50_sensor->publish_state(this->telemetry.get_percentile(50));
+    }
+    if (this->latency_p99_sensor != nullptr)
+    {
+        this->latency_p99_sensor->publish_state(this->telemetry.get_percentile(99));
     }
-    return false;
 }
 
 
@@ -394,10 +499,8 @@ bool IT8951EDisplay::Impl::wait_display_ready(uint32_t const timeout) const
  */
 void IT8951EDisplay::Impl::update_device_info()
 {
-    uint8_t device_info[40] = {};
-
-    this->send_command(Command::I80_CMD_GET_DEV_INFO);
-    this->read_bytes(device_info, 40);
+    uint8_t device_info[DEVICE_INFO_SIZE] = {};
+    this->read_device_info(device_info);
 
     uint16_t width = (device_info[0] << 8) | device_info[1];
     uint16_t height = (device_info[2] << 8) | device_info[3];
@@ -431,25 +534,40 @@ void IT8951EDisplay::Impl::update_device_info()
 }
 
 
+/**
+ * @brief Read the device info: panel size, image buffer address, LUT and firmware versions
+ * @param info Output, DEVICE_INFO_SIZE bytes
+ */
+void IT8951EDisplay::Impl::read_device_info(uint8_t * const info) const
+{
+    this->send_command(Command::I80_CMD_GET_DEV_INFO);
+    this->read_bytes(info, DEVICE_INFO_SIZE);
+}
+
+
 /**
  * @brief Set the image area the image buffer gets rendered into
  *
- * By default the image format is considered to be big endian, 4 bits per pixel (16 grayscale levels)
+ * The image format is big endian. By default it is 4 bits per pixel (16 grayscale levels). With hardware rotation,
+ * the area is in frame buffer (logical) coordinates and the controller rotates the data into the image buffer.
  *
+ * @param sequence Command sequence to append the load area command to
  * @param x X Coordinate of the draw window. Must be a multiple of 4
  * @param y Y Coordinate of the draw window
  * @param w Width of the draw window. Must be a multiple of 4
  * @param h Height of the draw window.
+ * @param pixel_mode Bits per pixel of the image data
  */
-void IT8951EDisplay::Impl::set_area(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h) const
+void IT8951EDisplay::Impl::set_area(CommandSequence &sequence, uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h,
+                                    PixelMode const pixel_mode) const
 {
     uint16_t args[5];
-    args[0] = (static_cast<uint16_t>(Endianness::BIG) << 8) | (static_cast<uint16_t>(PixelMode::BPP_4) << 4) | (static_cast<uint16_t>(Rotation::ROTATE_0));
+    args[0] = (static_cast<uint16_t>(Endianness::BIG) << 8) | (static_cast<uint16_t>(pixel_mode) << 4) | static_cast<uint16_t>(this->get_load_rotation());
     args[1] = (x + 3) & 0xFFFC;
     args[2] = y;
     args[3] = (w + 3) & 0xFFFC;
     args[4] = h;
-    this->send_command_with_args(Command::TCON_LD_IMG_AREA, args, 5);
+    sequence.add(Command::TCON_LD_IMG_AREA, args, 5);
 }
 
 
@@ -460,396 +578,2297 @@ void IT8951EDisplay::Impl::set_area(uint16_t const x, uint16_t const y, uint16_t
  * @param w Area width
  * @param h Area height
  * @param mode Display update mode. See enum for more info on the modes
+ * @param address Controller memory address of the image data, 0 for the image buffer
+ * @param one_bpp Refresh from 1bpp image data
+ * @param color_table Gray levels of the 1bpp data, foreground in the high byte. Only used in 1bpp.
  */
-void IT8951EDisplay::Impl::update_area(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h, UpdateMode const mode) const
+void IT8951EDisplay::Impl::update_area(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h, UpdateMode const mode,
+                                       uint32_t const address, bool const one_bpp, uint16_t const color_table) const
 {
     if (mode == UpdateMode::None)
     {
         return;
     }
 
+    if (mode < UpdateMode::None)
+    {
+        this->stats.refreshes[static_cast<size_t>(mode)]++;
+    }
+
     uint16_t args[7];
     args[0] = (x + 3) & 0xFFFC;
     args[1] = y;
     args[2] = ((((x + w) > this->width) ? (this->width - x) : w) + 3) & 0xFFFC;
     args[3] = ((y + h) > this->height) ? (this->height - y) : h;
     args[4] = static_cast<uint16_t>(mode);
-    args[5] = this->image_buffer_address_low;
-    args[6] = this->image_buffer_address_high;
 
-    this->wait_display_ready();
+    uint32_t const source = address ? address : this->get_image_address();
+    args[5] = source & 0xFFFF;
+    args[6] = source >> 16;
+
+    // Ghosting and refresh tracking use frame buffer coordinates, the refresh command panel coordinates
+    Area const area{args[0], args[1], args[2], args[3]};
+    if (this->rotation != display::DISPLAY_ROTATION_0_DEGREES)
+    {
+        Area const panel = to_physical(this->rotation, this->panel_width, this->panel_height,
+                                       area.x, area.y, area.x + area.w, area.y + area.h);
+        uint16_t const x_end = std::min<uint32_t>((panel.x + panel.w + 3) & 0xFFFC, this->panel_width);
+        args[0] = panel.x & 0xFFFC;
+        args[1] = panel.y;
+        args[2] = x_end - args[0];
+        args[3] = panel.h;
+    }
+
+    this->ghosting.record(area, mode);
+
+    this->set_display_depth(one_bpp, color_table);
+    this->wait_area_ready(area);
+    if (this->scheduler.get_in_flight())
+    {
+        this->stats.concurrent_refreshes++;
+    }
     this->send_command_with_args(Command::I80_CMD_DPY_BUF_AREA, args, 7);
+    this->scheduler.start(area, mode, millis(), this->last_transfer_us, source);
+    this->last_transfer_us = 0;
+    this->next_busy_poll = millis() + BUSY_POLL_MS;
 }
 
 
 /**
- * @brief Set the buffer memory address for the display
- * @param address_high High-word of the IT8951E buffer address
- * @param address_low Low-word of the IT8951E buffer address
+ * @brief Get the rotation field of the load area command
+ * @return Rotation of the image data from the frame buffer to the image buffer
  */
-void IT8951EDisplay::Impl::set_target_memory_addr(uint16_t const address_high, uint16_t const address_low) const
+Rotation IT8951EDisplay::Impl::get_load_rotation() const
 {
-    this->write_register(Register::LISARH, address_high);
-    this->write_register(Register::LISAR, address_low);
+    switch (this->rotation)
+    {
+        case display::DISPLAY_ROTATION_90_DEGREES:
+            return Rotation::ROTATE_90;
+        case display::DISPLAY_ROTATION_180_DEGREES:
+            return Rotation::ROTATE_180;
+        case display::DISPLAY_ROTATION_270_DEGREES:
+            return Rotation::ROTATE_270;
+        default:
+            return Rotation::ROTATE_0;
+    }
 }
 
 
 /**
- * @brief Clear display
- * @param init If true, a display update is performed, clearing the display irrespective of the buffer data
+ * @brief Switch the display engine between the 4bpp image buffer and 1bpp data mapped through a color table
+ *
+ * The setting also applies to the refreshes in progress, so they must be over before it changes. Switching is
+ * therefore only done when needed, and the waits it causes are counted in the statistics.
+ *
+ * @param one_bpp Enable the 1bpp display mode
+ * @param color_table Gray levels of the 1bpp data: 1 bits in the high byte, 0 bits in the low byte
  */
-void IT8951EDisplay::Impl::clear(bool const init) const
+void IT8951EDisplay::Impl::set_display_depth(bool const one_bpp, uint16_t const color_table) const
 {
-    this->set_target_memory_addr(this->image_buffer_address_high, this->image_buffer_address_low);
-    this->set_area(0, 0, width, height);
+    if ((one_bpp == this->one_bpp_display) && (!one_bpp || (color_table == this->color_table)))
+    {
+        return;
+    }
 
-    if (this->buffer)
+    bool const in_flight = this->scheduler.get_in_flight() != 0;
+    uint32_t const start_time = micros();
+    this->wait_display_ready();
+    if (in_flight)
     {
-        SelectDevice display(this->cs_pin);
-        this->parent->write_byte16(PREAMBLE_WRITE_DATA);
-        memset(this->buffer, this->reversed ? 0x00 : 0xFF, this->get_buffer_size());
-        this->parent->transfer_array(this->buffer, this->get_buffer_size());
+        this->stats.depth_switch_waits++;
+        this->stats.depth_switch_wait_us += micros() - start_time;
     }
 
-    this->send_command(Command::TCON_LD_IMG_END);
+    CommandSequence sequence;
+    if (one_bpp)
+    {
+        this->queue_register_write(sequence, Register::BGVR, color_table);
+    }
+    this->queue_register_write(sequence, Register::UP1SR2, one_bpp ? (this->up1sr2 | UP1SR2_1BPP) : this->up1sr2);
+    this->send_sequence(sequence);
 
-    if (init)
+    this->one_bpp_display = one_bpp;
+    this->color_table = color_table;
+}
+
+
+/**
+ * @brief Check if switching to a display depth would have to wait for refreshes in progress
+ * @param one_bpp 1bpp display mode
+ * @param color_table Gray levels of the 1bpp data
+ * @return true if the display mode differs and refreshes are still running
+ */
+bool IT8951EDisplay::Impl::depth_switch_blocks(bool const one_bpp, uint16_t const color_table) const
+{
+    if ((one_bpp == this->one_bpp_display) && (!one_bpp || (color_table == this->color_table)))
     {
-        this->update_area(0, 0, width, height, UpdateMode::Init);
+        return false;
+    }
+
+    if (this->scheduler.get_in_flight())
+    {
+        this->poll_busy_luts();
     }
+    return this->scheduler.get_in_flight() != 0;
 }
 
 
 /**
- * @brief Get the size of the local display buffer
+ * @brief Set the buffer memory address for the display
+ * @param sequence Command sequence to append the register writes to
+ * @param address_high High-word of the IT8951E buffer address
+ * @param address_low Low-word of the IT8951E buffer address
  */
-size_t IT8951EDisplay::Impl::get_buffer_size() const
+void IT8951EDisplay::Impl::set_target_memory_addr(CommandSequence &sequence, uint16_t const address_high, uint16_t const address_low) const
 {
-    return this->width * this->height / 2;
+    this->queue_register_write(sequence, Register::LISARH, address_high);
+    this->queue_register_write(sequence, Register::LISAR, address_low);
 }
 
 
 /**
- * @brief Write the image at the specified location, Partial update
- * @param x X coordinate of the draw window. Will be rounded up to the nearest multiple of 4
- * @param y Y coordinate of the draw window
- * @param w Draw window width. Will be rounded up to the nearest multiple of 4
- * @param h Draw window height
- * @param buffer Pointer to the buffer containing the image data
+ * @brief Stream rows of image data to the controller, within an already started data transaction
+ *
+ * The rows are gathered into the internal RAM transfer buffer, and sent in transfers of the buffer size.
+ * Full rows are contiguous in the frame buffer and are copied as one block.
+ *
+ * @param source Image data, laid out like the frame buffer
+ * @param offset Offset of the first byte to send
+ * @param row_bytes Number of bytes to send from each row
+ * @param rows Number of rows to send
  */
-void IT8951EDisplay::Impl::write_buffer_to_display(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h) const
+void IT8951EDisplay::Impl::stream_rows(uint8_t const * const source, size_t offset, size_t row_bytes, uint16_t rows) const
 {
-    if (buffer == nullptr)
+    size_t const stride = this->width >> 1;
+
+    if (row_bytes == stride)
     {
-        ESP_LOGE(TAG, "No buffer to read data from");
-        return;
+        row_bytes *= rows;
+        rows = 1;
     }
 
-    if ((x > this->width) || (y > this->height))
+    if (this->transfer_buffer == nullptr)
     {
-        ESP_LOGE(TAG, "Pos (%d, %d) out of bounds.", x, y);
+        for (uint16_t row = 0; row < rows; row++, offset += stride)
+        {
+            this->bus_write(source + offset, row_bytes);
+        }
         return;
     }
 
-    this->set_target_memory_addr(this->image_buffer_address_high, this->image_buffer_address_low);
-    this->set_area(x, y, w, h);
-
+    size_t used = 0;
+    for (uint16_t row = 0; row < rows; row++, offset += stride)
     {
-        SelectDevice display(this->cs_pin);
-        this->parent->write_byte16(PREAMBLE_WRITE_DATA);
-        for (uint32_t cursor_y = y; cursor_y < y + h; cursor_y++) {
-            uint32_t pos = cursor_y*(this->width >> 1) + (((x + 3) & 0xFFFC) >> 1);
-            this->parent->write_array(buffer + pos, ((w + 3) & 0xFFFC) >> 1);
+        size_t done = 0;
+        while (done < row_bytes)
+        {
+            size_t const chunk = std::min(row_bytes - done, this->transfer_buffer_size - used);
+            memcpy(this->transfer_buffer + used, source + offset + done, chunk);
+            used += chunk;
+            done += chunk;
+
+            if (used == this->transfer_buffer_size)
+            {
+                this->bus_write(this->transfer_buffer, used);
+                used = 0;
+            }
         }
     }
 
+    if (used)
+    {
+        this->bus_write(this->transfer_buffer, used);
+    }
+}
+
+
+/**
+ * @brief Pack a row of 4bpp pixels into 1bpp, leftmost pixel in the MSB
+ * @param line First 4bpp pixel, at an even x coordinate
+ * @param out Packed output
+ * @param pixels Number of pixels, a multiple of 8
+ * @param foreground Gray level packed as 1, all other levels are packed as 0
+ */
+static void pack_1bpp(uint8_t const *line, uint8_t *out, uint16_t const pixels, uint8_t const foreground)
+{
+    for (uint16_t i = 0; i < pixels; i += 8)
+    {
+        uint8_t bits = 0;
+        for (uint8_t j = 0; j < 4; j++, line++)
+        {
+            bits = (bits << 2) | (((*line >> 4) == foreground) << 1) | ((*line & 0x0F) == foreground);
+        }
+        *out++ = bits;
+    }
+}
+
+
+/**
+ * @brief Pack a row of 4bpp pixels of the DU4 gray levels (0, 5, 10, 15) into 2bpp, leftmost pixel in the MSBs
+ * @param line First 4bpp pixel, at an even x coordinate
+ * @param out Packed output
+ * @param pixels Number of pixels, a multiple of 4
+ */
+static void pack_2bpp(uint8_t const *line, uint8_t *out, uint16_t const pixels)
+{
+    for (uint16_t i = 0; i < pixels; i += 4, line += 2)
+    {
+        // Level 5 * n maps to n by dropping the two low bits
+        *out++ = (line[0] & 0xC0) | ((line[0] << 2) & 0x30) | ((line[1] >> 4) & 0x0C) | ((line[1] >> 2) & 0x03);
+    }
+}
+
+
+/**
+ * @brief Stream an area of the frame buffer to the controller in 1bpp or 2bpp, within an already started data
+ * transaction
+ *
+ * The rows are packed into the transfer buffer, which must hold at least one packed row.
+ *
+ * @param source Image data, laid out like the frame buffer
+ * @param area Area to send, aligned to the granularity of the packing
+ * @param bits Bits per pixel, 1 or 2
+ * @param foreground Gray level sent as 1 in 1bpp
+ */
+void IT8951EDisplay::Impl::stream_packed(uint8_t const * const source, Area const &area, uint8_t const bits, uint8_t const foreground) const
+{
+    size_t const stride = this->width >> 1;
+    size_t const row_bytes = (static_cast<size_t>(area.w) * bits) >> 3;
+
+    size_t used = 0;
+    for (uint16_t row = area.y; row < area.y + area.h; row++)
+    {
+        if (used + row_bytes > this->transfer_buffer_size)
+        {
+            this->bus_write(this->transfer_buffer, used);
+            used = 0;
+        }
+
+        uint8_t const * const line = source + row * stride + (area.x >> 1);
+        if (bits == 1)
+        {
+            pack_1bpp(line, this->transfer_buffer + used, area.w, foreground);
+        }
+        else
+        {
+            pack_2bpp(line, this->transfer_buffer + used, area.w);
+        }
+        used += row_bytes;
+    }
+
+    if (used)
+    {
+        this->bus_write(this->transfer_buffer, used);
+    }
+}
+
+
+/**
+ * @brief Find the first differing byte of two buffers, comparing 32 bits at a time
+ * @param a First buffer
+ * @param b Second buffer
+ * @param begin Index of the first byte to compare
+ * @param end Index past the last byte to compare
+ * @return Index of the first differing byte, or end if the ranges are identical
+ */
+static size_t find_first_difference(uint8_t const * const a, uint8_t const * const b, size_t begin, size_t const end)
+{
+    while ((begin < end) && (begin & 3))
+    {
+        if (a[begin] != b[begin])
+        {
+            return begin;
+        }
+        begin++;
+    }
+
+    while (begin + 4 <= end)
+    {
+        uint32_t word_a, word_b;
+        memcpy(&word_a, a + begin, 4);
+        memcpy(&word_b, b + begin, 4);
+        if (word_a ^ word_b)
+        {
+            break;
+        }
+        begin += 4;
+    }
+
+    while ((begin < end) && (a[begin] == b[begin]))
+    {
+        begin++;
+    }
+
+    return begin;
+}
+
+
+/**
+ * @brief Find the last differing byte of two buffers, comparing 32 bits at a time
+ * @param a First buffer
+ * @param b Second buffer
+ * @param begin Index of the first byte to compare
+ * @param end Index past the last byte to compare
+ * @return Index past the last differing byte, or begin if the ranges are identical
+ */
+static size_t find_last_difference(uint8_t const * const a, uint8_t const * const b, size_t const begin, size_t end)
+{
+    while ((end > begin) && (end & 3))
+    {
+        if (a[end - 1] != b[end - 1])
+        {
+            return end;
+        }
+        end--;
+    }
+
+    while (end >= begin + 4)
+    {
+        uint32_t word_a, word_b;
+        memcpy(&word_a, a + end - 4, 4);
+        memcpy(&word_b, b + end - 4, 4);
+        if (word_a ^ word_b)
+        {
+            break;
+        }
+        end -= 4;
+    }
+
+    while ((end > begin) && (a[end - 1] == b[end - 1]))
+    {
+        end--;
+    }
+
+    return end;
+}
+
+
+/**
+ * @brief Shrink an area to the pixels that differ from the data last sent to the controller
+ *
+ * The result is aligned to the 4 pixel granularity of the controller. Only used in frame diff mode.
+ *
+ * @param area Area to shrink
+ * @return false if no pixel in the area changed
+ */
+bool IT8951EDisplay::Impl::clip_to_changes(Area &area) const
+{
+    size_t const stride = this->width >> 1;
+    size_t const begin = area.x >> 1;
+    size_t const end = std::min<size_t>((area.x + area.w + 1) >> 1, stride);
+
+    size_t first_byte = end;
+    size_t last_byte = begin;
+    uint16_t first_row = area.y + area.h;
+    uint16_t last_row = area.y;
+
+    for (uint16_t row = area.y; row < area.y + area.h; row++)
+    {
+        uint8_t const * const current = this->get_source() + row * stride;
+        uint8_t const * const sent = this->sent_buffer + row * stride;
+
+        size_t const first = find_first_difference(current, sent, begin, end);
+        if (first == end)
+        {
+            continue;
+        }
+
+        first_byte = std::min(first_byte, first);
+        last_byte = std::max(last_byte, find_last_difference(current, sent, first, end));
+        first_row = std::min(first_row, row);
+        last_row = row + 1;
+    }
+
+    uint32_t const original_size = (static_cast<uint32_t>(area.w) * area.h) >> 1;
+
+    if (first_row >= last_row)
+    {
+        this->stats.diff_areas_dropped++;
+        this->stats.diff_bytes_saved += original_size;
+        return false;
+    }
+
+    uint16_t const x = (first_byte << 1) & 0xFFFC;
+    uint16_t const x_end = std::min<uint32_t>(((last_byte << 1) + 3) & 0xFFFC, this->width);
+
+    area = Area{x, first_row, static_cast<uint16_t>(x_end - x), static_cast<uint16_t>(last_row - first_row)};
+    this->stats.diff_bytes_saved += original_size - ((static_cast<uint32_t>(area.w) * area.h) >> 1);
+    return true;
+}
+
+
+/**
+ * @brief Get the overlap of two areas
+ * @param a First area
+ * @param b Second area
+ * @param result Overlap of the areas, only set if they overlap
+ * @return true if the areas overlap
+ */
+static bool intersect(Area const &a, Area const &b, Area &result)
+{
+    uint16_t const x = std::max(a.x, b.x);
+    uint16_t const y = std::max(a.y, b.y);
+    uint16_t const x_end = std::min(a.x + a.w, b.x + b.w);
+    uint16_t const y_end = std::min(a.y + a.h, b.y + b.h);
+
+    if ((x_end <= x) || (y_end <= y))
+    {
+        return false;
+    }
+
+    result = Area{x, y, static_cast<uint16_t>(x_end - x), static_cast<uint16_t>(y_end - y)};
+    return true;
+}
+
+
+/**
+ * @brief Transfer an area to the controller and refresh it, using the update mode of the regions it overlaps
+ *
+ * The part of the area inside the first overlapping mode region is refreshed with the mode of the region. The
+ * parts above, below, left and right of it are handled recursively, against the following regions only: the
+ * regions before did not overlap the area at all.
+ *
+ * With packed transfers, an area outside of all regions is widened to the 1bpp granularity.
+ *
+ * @param area Area to transfer
+ * @param first_region Index of the first mode region to check
+ */
+void IT8951EDisplay::Impl::write_area(Area const &area, size_t const first_region) const
+{
+    for (size_t i = first_region; i < this->mode_region_count; i++)
+    {
+        Area inner;
+        if (!intersect(area, this->mode_regions[i].area, inner))
+        {
+            continue;
+        }
+
+        Area const parts[4] = {
+            {area.x, area.y, area.w, static_cast<uint16_t>(inner.y - area.y)},
+            {area.x, static_cast<uint16_t>(inner.y + inner.h), area.w, static_cast<uint16_t>(area.y + area.h - inner.y - inner.h)},
+            {area.x, inner.y, static_cast<uint16_t>(inner.x - area.x), inner.h},
+            {static_cast<uint16_t>(inner.x + inner.w), inner.y, static_cast<uint16_t>(area.x + area.w - inner.x - inner.w), inner.h},
+        };
+
+        for (Area const &part : parts)
+        {
+            if (part.w && part.h)
+            {
+                this->write_area(part, i + 1);
+            }
+        }
+
+        UpdateMode const region_mode = this->mode_regions[i].mode;
+        bool const scan = this->packed_transfers || (region_mode == UpdateMode::Auto);
+        uint16_t const levels = scan ? this->get_levels(inner) : 0;
+        UpdateMode const mode = (region_mode == UpdateMode::Auto) ? select_update_mode(levels) : region_mode;
+        IT8951E_LOGD(TAG, "Pushing area (%d, %d) --> (%d, %d) to display, region mode %d",
+            inner.x, inner.y, inner.x + inner.w, inner.y + inner.h, static_cast<int>(mode));
+        this->write_buffer_to_display(inner.x, inner.y, inner.w, inner.h, mode, levels);
+        return;
+    }
+
+    Area target = area;
+    if (this->packed_transfers)
+    {
+        uint16_t const x = area.x & ~(ALIGN_1BPP - 1);
+        uint16_t const x_end = std::min<uint32_t>((area.x + area.w + ALIGN_1BPP - 1) & ~(ALIGN_1BPP - 1), this->width);
+        Area const wide{x, area.y, static_cast<uint16_t>(x_end - x), area.h};
+
+        bool overlaps = false;
+        for (size_t i = 0; i < this->mode_region_count; i++)
+        {
+            Area inner;
+            overlaps |= intersect(wide, this->mode_regions[i].area, inner);
+        }
+
+        if (!overlaps)
+        {
+            target = wide;
+        }
+    }
+
+    bool const scan = this->packed_transfers || (this->update_mode == UpdateMode::Auto);
+    uint16_t const levels = scan ? this->get_levels(target) : 0;
+    UpdateMode const mode = (this->update_mode == UpdateMode::Auto) ? select_update_mode(levels) : this->update_mode;
+    IT8951E_LOGD(TAG, "Pushing area (%d, %d) --> (%d, %d) to display, mode %d",
+        target.x, target.y, target.x + target.w, target.y + target.h, static_cast<int>(mode));
+    this->write_buffer_to_display(target.x, target.y, target.w, target.h, mode, levels);
+}
+
+
+/**
+ * @brief Get the gray levels present in an area of the frame buffer
+ *
+ * In band rendering mode, the frame buffer is gone by the time the areas are refreshed: the levels of all the
+ * image data loaded since the last update are used instead.
+ *
+ * @param area Area to check
+ * @return Gray levels, bit n for level n
+ */
+uint16_t IT8951EDisplay::Impl::get_levels(Area const &area) const
+{
+    if (this->is_banded())
+    {
+        return this->frame_levels ? this->frame_levels : 0xFFFF;
+    }
+    return scan_levels(this->get_source(), this->width >> 1, area);
+}
+
+
+/**
+ * @brief Pick the smallest pixel format an area of the frame buffer can be transferred in, see select_packing()
+ *
+ * 1bpp is not used with hardware rotation: the controller would rotate the bytes of 1bpp data (loaded as 8bpp)
+ * rather than its pixels, and rotated refreshes are widened beyond the area.
+ *
+ * @param area Area to transfer, aligned to 4 pixels
+ * @param levels Gray levels of the area, 0 if unknown
+ * @param allow_one_bpp false to rule out the solid fill and 1bpp, which refresh in the 1bpp display mode
+ * @return Bits per pixel: 0 (solid fill), 1, 2 or 4
+ */
+uint8_t IT8951EDisplay::Impl::select_packing(Area const &area, uint16_t const levels, bool const allow_one_bpp) const
+{
+    bool const packed = this->packed_transfers && (this->transfer_buffer != nullptr);
+    return it8951e::select_packing(area, levels, allow_one_bpp && (this->rotation == display::DISPLAY_ROTATION_0_DEGREES),
+                                   packed ? this->transfer_buffer_size : 0);
+}
+
+
+/**
+ * @brief Clear display
+ *
+ * With a full frame buffer and no rotation in the controller, no image data is transferred: the frame buffer is
+ * cleared, the whole image buffer is marked stale and the EPD is refreshed like a solid fill.
+ *
+ * @param init If true, a display update is performed, clearing the display irrespective of the buffer data
+ */
+void IT8951EDisplay::Impl::clear(bool const init) const
+{
+    Statistics const start = this->stats;
+    uint32_t const start_time = micros();
+
+    this->wait_display_ready();
+
+    uint8_t * const source = this->get_source();
+    if ((source != nullptr) && !this->is_banded() && (this->rotation == display::DISPLAY_ROTATION_0_DEGREES))
+    {
+        uint8_t const level = this->reversed ? 0x00 : 0x0F;
+        memset(source, level * 0x11, this->get_buffer_size());
+        this->stale.clear();
+
+        if (init)
+        {
+            this->fill_area(Area{0, 0, this->width, this->height}, 0, 0, this->width, this->height, UpdateMode::Init, level);
+        }
+        else
+        {
+            if (this->sent_buffer)
+            {
+                memcpy(this->sent_buffer, source, this->get_buffer_size());
+            }
+            this->stale.mark(0, 0, this->width, this->height);
+        }
+
+        this->stats.log_operation("Clear", start, micros() - start_time);
+        return;
+    }
+
+    uint32_t const transfer_start = micros();
+
+    CommandSequence sequence;
+    this->set_target_memory_addr(sequence, this->image_buffer_address_high, this->image_buffer_address_low);
+    this->set_area(sequence, 0, 0, width, height);
+    this->send_sequence(sequence);
+    this->set_bus_rate(this->write_rate);
+
+    if (source)
+    {
+        SelectDevice display(this->cs_pin, this->stats.cs_toggles);
+        this->bus_write16(PREAMBLE_WRITE_DATA);
+
+        // A banded buffer is sent as many times as needed to cover the display
+        size_t const stride = this->width >> 1;
+        memset(source, this->reversed ? 0x00 : 0xFF, this->buffer_rows * stride);
+        for (uint16_t row = 0; row < this->height; row += this->buffer_rows)
+        {
+            this->stream_rows(source, 0, stride, std::min<uint16_t>(this->buffer_rows, this->height - row));
+        }
+
+        if (this->sent_buffer)
+        {
+            memcpy(this->sent_buffer, source, this->get_buffer_size());
+        }
+        this->stale.clear();
+    }
+
     this->send_command(Command::TCON_LD_IMG_END);
+    this->last_transfer_us = micros() - transfer_start;
+
+    if (init)
+    {
+        this->update_area(0, 0, width, height, UpdateMode::Init);
+    }
+
+    this->stats.log_operation("Clear", start, micros() - start_time);
+}
+
+
+/**
+ * @brief Get the size of the local display buffer
+ */
+size_t IT8951EDisplay::Impl::get_buffer_size() const
+{
+    return this->width * this->height / 2;
+}
+
+
+/**
+ * @brief Write the image at the specified location, Partial update
+ *
+ * With packed transfers, the image data is sent in 1bpp or 2bpp if the content permits. 2bpp data is expanded
+ * into the image buffer by the controller. 1bpp data is loaded into the scratch buffer and refreshed from there,
+ * so the image buffer keeps older data for the area until restore_stale_areas().
+ *
+ * @param x X coordinate of the draw window. Will be rounded up to the nearest multiple of 4
+ * @param y Y coordinate of the draw window
+ * @param w Draw window width. Will be rounded up to the nearest multiple of 4
+ * @param h Draw window height
+ * @param mode Update mode used to refresh the EPD
+ * @param levels Gray levels present in the window, bit n for level n. 0 if unknown: the data is sent in 4bpp.
+ */
+void IT8951EDisplay::Impl::write_buffer_to_display(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h, UpdateMode const mode,
+                                                   uint16_t const levels) const
+{
+    uint8_t const * const source = this->get_source();
+    if (source == nullptr)
+    {
+        ESP_LOGE(TAG, "No buffer to read data from");
+        return;
+    }
+
+    if ((x > this->width) || (y > this->height))
+    {
+        ESP_LOGE(TAG, "Pos (%d, %d) out of bounds.", x, y);
+        return;
+    }
+
+    if (this->is_banded())
+    {
+        // The image data was already loaded, band by band
+        this->update_area(x, y, w, h, mode);
+        return;
+    }
+
+    Area const area{static_cast<uint16_t>((x + 3) & 0xFFFC), y, static_cast<uint16_t>((w + 3) & 0xFFFC), h};
+
+    // Two levels at most in 1bpp: the highest one is the foreground. Solid content has its level in both entries.
+    uint8_t const background = __builtin_ctz(levels | 0x8000);
+    uint8_t const foreground = 31 - __builtin_clz(levels | 0x0001);
+    uint16_t const color_table = ((foreground * 0x11) << 8) | (background * 0x11);
+
+    uint8_t bits = this->select_packing(area, levels);
+    if ((bits <= 1) && this->depth_switch_blocks(true, color_table))
+    {
+        // Sending the image data costs less than waiting for all the refreshes in progress
+        this->stats.depth_fallbacks++;
+        bits = this->select_packing(area, levels, false);
+    }
+
+    if (bits == 0)
+    {
+        this->fill_area(area, x, y, w, h, mode, __builtin_ctz(levels));
+        return;
+    }
+
+    // Loading new image data into an area being refreshed would disturb the refresh. With double buffering, the
+    // area is loaded into the back buffer instead, if the refresh displays it from the image buffer.
+    uint32_t const frame = (bits == 1) ? FRAME_SCRATCH : this->wait_load_ready(area);
+    if (bits == 1)
+    {
+        this->wait_area_ready(area);
+    }
+    uint32_t const transfer_start = micros();
+
+    // In frame diff mode, the data is sent from the copy of the sent data, so the copy always matches the controller
+    if (this->sent_buffer)
+    {
+        size_t const stride = this->width >> 1;
+        size_t const offset = y * stride + (area.x >> 1);
+        for (uint32_t row = 0; row < h; row++)
+        {
+            memcpy(this->sent_buffer + offset + row * stride, source + offset + row * stride, area.w >> 1);
+        }
+    }
+
+    this->load_area(area, this->sent_buffer ? this->sent_buffer : source, bits, foreground, frame);
+    this->last_transfer_us = micros() - transfer_start;
+
+    if (bits == 1)
+    {
+        this->stats.packed_1bpp_areas++;
+        this->stale.mark(area.x, area.y, area.w, area.h);
+        this->update_area(x, y, w, h, mode, this->get_frame_address(FRAME_SCRATCH), true, color_table);
+        return;
+    }
+
+    this->stats.packed_2bpp_areas += (bits == 2);
+
+    if (frame == FRAME_BACK)
+    {
+        this->stats.back_buffer_loads++;
+        this->stale.mark(area.x, area.y, area.w, area.h);
+    }
+    this->update_area(x, y, w, h, mode, this->get_frame_address(frame));
+}
+
+
+/**
+ * @brief Refresh an area to a single gray level, without transferring any image data
+ *
+ * Both entries of the 1bpp color table are set to the level, so the content of the scratch buffer does not matter.
+ * The image buffer of the controller keeps its older data: the area is marked stale, and restored from the frame
+ * buffer only if it is refreshed again without being loaded first.
+ *
+ * @param area Area, aligned to 32 pixels
+ * @param x X coordinate of the refreshed area
+ * @param y Y coordinate of the refreshed area
+ * @param w Width of the refreshed area
+ * @param h Height of the refreshed area
+ * @param mode Update mode used to refresh the EPD
+ * @param level Gray level of the area
+ */
+void IT8951EDisplay::Impl::fill_area(Area const &area, uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h,
+                                     UpdateMode const mode, uint8_t const level) const
+{
+    if (this->sent_buffer)
+    {
+        size_t const stride = this->width >> 1;
+        size_t const offset = area.y * stride + (area.x >> 1);
+        for (uint32_t row = 0; row < area.h; row++)
+        {
+            memcpy(this->sent_buffer + offset + row * stride, this->get_source() + offset + row * stride, area.w >> 1);
+        }
+    }
+
+    this->stats.filled_areas++;
+    this->stats.fill_bytes_saved += (static_cast<uint32_t>(area.w) * area.h) >> 1;
+    this->stale.mark(area.x, area.y, area.w, area.h);
+    this->last_transfer_us = 0;
+
+    uint16_t const color = level * 0x11;
+    this->update_area(x, y, w, h, mode, this->get_frame_address(FRAME_SCRATCH), true, (color << 8) | color);
+}
+
+
+/**
+ * @brief Load an area of image data into the controller memory, without refreshing the EPD
+ *
+ * 4bpp and 2bpp data goes to the given frame, the image buffer by default. 1bpp data goes to the scratch buffer,
+ * loaded as 8bpp data of an eighth of the width.
+ *
+ * @param area Area to load, aligned to the granularity of the pixel format
+ * @param source Image data, laid out like the frame buffer
+ * @param bits Bits per pixel: 1, 2 or 4
+ * @param foreground Gray level sent as 1 in 1bpp
+ * @param frame Controller memory frame of the 4bpp and 2bpp data: FRAME_IMAGE or FRAME_BACK
+ */
+void IT8951EDisplay::Impl::load_area(Area const &area, uint8_t const * const source, uint8_t const bits, uint8_t const foreground,
+                                     uint32_t const frame) const
+{
+    CommandSequence sequence;
+    if (bits == 1)
+    {
+        uint32_t const address = this->get_frame_address(FRAME_SCRATCH);
+        this->set_target_memory_addr(sequence, address >> 16, address & 0xFFFF);
+        this->set_area(sequence, area.x >> 3, area.y, area.w >> 3, area.h, PixelMode::BPP_8);
+    }
+    else
+    {
+        uint32_t const address = this->get_frame_address(frame);
+        this->set_target_memory_addr(sequence, address >> 16, address & 0xFFFF);
+        this->set_area(sequence, area.x, area.y, area.w, area.h, (bits == 2) ? PixelMode::BPP_2 : PixelMode::BPP_4);
+    }
+    this->send_sequence(sequence);
+    this->set_bus_rate(this->write_rate);
+
+    uint32_t const load_start = micros();
+    uint32_t const bytes_start = this->stats.bytes_written;
+    {
+        SelectDevice display(this->cs_pin, this->stats.cs_toggles);
+        this->bus_write16(PREAMBLE_WRITE_DATA);
+
+        if (bits == 4)
+        {
+            size_t const stride = this->width >> 1;
+            this->stream_rows(source, area.y * stride + (area.x >> 1), area.w >> 1, area.h);
+        }
+        else
+        {
+            this->stream_packed(source, area, bits, foreground);
+            this->stats.packed_bytes_saved += (static_cast<uint32_t>(area.w) * area.h * (4 - bits)) >> 3;
+        }
+    }
+    this->stats.image_bytes_written += this->stats.bytes_written - bytes_start;
+    this->stats.image_write_us += micros() - load_start;
+
+    this->send_command(Command::TCON_LD_IMG_END);
+}
+
+
+/**
+ * @brief Reload the image buffer of the controller for the areas last loaded in 1bpp, without refreshing the EPD
+ *
+ * Needed before refreshing areas without loading them first, i.e. cleaning. The data comes from the copy of the
+ * sent data in frame diff mode, and from the frame buffer otherwise.
+ */
+void IT8951EDisplay::Impl::restore_stale_areas() const
+{
+    if (this->stale.empty())
+    {
+        return;
+    }
+
+    Area areas[DirtyTracker::MAX_AREAS];
+    size_t const count = this->stale.extract(areas, DirtyTracker::MAX_AREAS, AREA_OVERHEAD_BYTES);
+    for (size_t i = 0; i < count; i++)
+    {
+        IT8951E_LOGD(TAG, "Restoring image buffer area (%d, %d) --> (%d, %d)",
+            areas[i].x, areas[i].y, areas[i].x + areas[i].w, areas[i].y + areas[i].h);
+        this->wait_area_ready(areas[i]);
+        this->load_area(areas[i], this->sent_buffer ? this->sent_buffer : this->get_source(), 4, 0);
+    }
+}
+
+
+/**
+ * @brief Write a pixel in the internal frame buffer at the specified location with the mentioned RGB color
+ * @param x X coordinate of the pixel
+ * @param y Y coordinate of the pixel
+ * @param Color color of the pixel
+ */
+void HOT IT8951EDisplay::Impl::put_pixel(int const x, int const y, Color const color)
+{
+    // Validation happens outside this function. In band rendering mode, pixels outside of the band are dropped.
+    uint32_t const row = y - this->band_y;
+    if (row >= this->band_height)
+    {
+        return;
+    }
+
+    this->dirty.mark_pixel(x, y);
+
+    uint32_t const internal_color = this->gray_level(color);
+    int32_t index = row * (this->width >> 1) + (x >> 1);
+
+    if (x & 0x1)
+    {
+        this->buffer[index] &= 0xF0;
+        this->buffer[index] |= internal_color;
+    }
+    else
+    {
+        this->buffer[index] &= 0x0F;
+        this->buffer[index] |= internal_color << 4;
+    }
+}
+
+
+/**
+ * @brief Convert a color to the 4 bit gray level stored in the frame buffer
+ * @param color Color to convert
+ * @return Gray level, reversed if the display is reversed
+ */
+inline uint8_t HOT IT8951EDisplay::Impl::gray_level(Color const color) const
+{
+    uint32_t internal_color = ((color.r*77) + (color.g*151) + (color.b*28)) >> 12;
+
+    if (this->reversed)
+    {
+        internal_color = (~internal_color) & 0xFu;
+    }
+
+    return internal_color;
+}
+
+
+/**
+ * @brief Fill a rectangle of the internal frame buffer with a color
+ *
+ * Whole bytes are written with memset, only the nibbles at the edges of odd aligned rows are patched.
+ *
+ * @param x X coordinate of the rectangle
+ * @param y Y coordinate of the rectangle
+ * @param w Width of the rectangle
+ * @param h Height of the rectangle
+ * @param color Fill color
+ */
+void IT8951EDisplay::Impl::fill_rect(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h, Color const color)
+{
+    // Validation happens outside this function. In band rendering mode, the rectangle is clipped to the band.
+    uint16_t const first = std::max(y, this->band_y);
+    uint16_t const last = std::min<uint32_t>(y + h, this->band_y + this->band_height);
+    if ((this->buffer == nullptr) || (w == 0) || (first >= last))
+    {
+        return;
+    }
+
+    this->dirty.mark(x, first, w, last - first);
+
+    uint8_t const level = this->gray_level(color);
+    uint8_t const pair = (level << 4) | level;
+    size_t const stride = this->width >> 1;
+
+    if ((x == 0) && (w == this->width))
+    {
+        memset(this->buffer + (first - this->band_y) * stride, pair, (last - first) * stride);
+        return;
+    }
+
+    for (uint16_t row = first; row < last; row++)
+    {
+        uint8_t * const line = this->buffer + (row - this->band_y) * stride;
+        uint16_t start = x;
+        uint16_t end = x + w;
+
+        if (start & 0x1)
+        {
+            line[start >> 1] = (line[start >> 1] & 0xF0) | level;
+            start++;
+        }
+
+        if ((end & 0x1) && (end > start))
+        {
+            end--;
+            line[end >> 1] = (line[end >> 1] & 0x0F) | (level << 4);
+        }
+
+        if (end > start)
+        {
+            memset(line + (start >> 1), pair, (end - start) >> 1);
+        }
+    }
+}
+
+
+/**
+ * @brief Convert a block of source pixels straight into the frame buffer
+ *
+ * The coordinates are physical frame buffer coordinates and must be within the display.
+ *
+ * @param x X coordinate of the top left corner
+ * @param y Y coordinate of the top left corner
+ * @param w Width of the block
+ * @param h Height of the block
+ * @param ptr Pointer to the source image data
+ * @param order Color order
+ * @param bitness Color bitness
+ * @param big_endian Endianness
+ * @param x_offset X offset of the block in the source image
+ * @param y_offset Y offset of the block in the source image
+ * @param x_pad Source pixels to skip at the end of each row
+ *
+ * @return false if the pixels could not be drawn
+ */
+bool IT8951EDisplay::Impl::draw_pixels(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h, uint8_t const * const ptr,
+                                       display::ColorOrder const order, display::ColorBitness const bitness, bool const big_endian,
+                                       uint16_t const x_offset, uint16_t const y_offset, uint16_t const x_pad)
+{
+    if (this->buffer == nullptr)
+    {
+        return false;
+    }
+
+    uint32_t const start_time = micros();
+
+    this->converter.configure(order, bitness, big_endian, this->reversed);
+
+    size_t const bytes_per_pixel = this->converter.get_bytes_per_pixel();
+    size_t const source_stride = (x_offset + w + x_pad) * bytes_per_pixel;
+    size_t const stride = this->width >> 1;
+
+    if (this->is_banded() && (this->band_height == 0))
+    {
+        this->stream_pixels(x, y, w, h, ptr + y_offset * source_stride + x_offset * bytes_per_pixel, source_stride);
+    }
+    else
+    {
+        // In band rendering mode, only the rows of the band are converted
+        uint16_t const first = std::max(y, this->band_y);
+        uint16_t const last = std::min<uint32_t>(y + h, this->band_y + this->band_height);
+        if (first >= last)
+        {
+            return true;
+        }
+
+        uint8_t const *source = ptr + (y_offset + first - y) * source_stride + x_offset * bytes_per_pixel;
+        uint8_t *line = this->buffer + (first - this->band_y) * stride;
+
+        for (uint16_t row = first; row < last; row++)
+        {
+            this->converter.convert_row(source, line, x, w);
+            source += source_stride;
+            line += stride;
+        }
+
+        this->dirty.mark(x, first, w, last - first);
+    }
+
+    this->loop_stats.fast_pixels += static_cast<uint32_t>(w) * h;
+    this->loop_stats.fast_pixels_us += micros() - start_time;
+    return true;
+}
+
+
+/**
+ * @brief Convert a block of source pixels and load it into the controller right away. Used for the pixels drawn
+ * outside of band rendering in band rendering mode, e.g. by LVGL.
+ *
+ * The block is converted through the strip, as many rows at a time as it holds. The controller loads whole groups
+ * of 4 pixels: if the block is not aligned to them, the missing pixels are loaded as background.
+ *
+ * @param x X coordinate of the top left corner
+ * @param y Y coordinate of the top left corner
+ * @param w Width of the block
+ * @param h Height of the block
+ * @param source First source pixel
+ * @param source_stride Bytes per source row
+ */
+void IT8951EDisplay::Impl::stream_pixels(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h, uint8_t const *source,
+                                         size_t const source_stride)
+{
+    size_t const stride = this->width >> 1;
+    uint16_t const x_start = x & 0xFFFC;
+    uint16_t const x_end = std::min<uint32_t>((x + w + 3) & 0xFFFC, this->width);
+    bool const aligned = (x_start == x) && (x_end == x + w);
+
+    for (uint16_t row = 0; row < h; row += this->buffer_rows)
+    {
+        uint16_t const rows = std::min<uint16_t>(this->buffer_rows, h - row);
+        uint8_t *line = this->buffer;
+
+        for (uint16_t i = 0; i < rows; i++)
+        {
+            if (!aligned)
+            {
+                memset(line + (x_start >> 1), this->reversed ? 0x00 : 0xFF, (x_end - x_start) >> 1);
+            }
+            this->converter.convert_row(source, line, x, w);
+            source += source_stride;
+            line += stride;
+        }
+
+        Area const area{x_start, static_cast<uint16_t>(y + row), static_cast<uint16_t>(x_end - x_start), rows};
+        this->frame_levels |= scan_levels(this->buffer, stride, Area{x_start, 0, area.w, rows});
+        this->load_strip(area, this->buffer, this->get_image_address());
+    }
+
+    this->dirty.mark(x, y, w, h);
+}
+
+
+/**
+ * @brief Render the display in bands of the strip height: run the writer once per band, and load each band into
+ * the controller as soon as it is rendered. The EPD is refreshed afterwards, like for the full frame buffer.
+ *
+ * @param page Page to render into a page slot, nullptr to render the display
+ * @param address Controller memory address to load the bands to, 0 for the image buffer
+ */
+void IT8951EDisplay::Impl::render_bands(display::DisplayPage * const page, uint32_t const address)
+{
+    size_t const stride = this->width >> 1;
+    uint32_t const target = address ? address : this->get_image_address();
+
+    for (uint16_t y = 0; y < this->height; y += this->buffer_rows)
+    {
+        this->band_y = y;
+        this->band_height = std::min<uint16_t>(this->buffer_rows, this->height - y);
+
+        if (page == nullptr)
+        {
+            this->parent->do_update_();
+            this->frame_levels |= scan_levels(this->buffer, stride, Area{0, 0, this->width, this->band_height});
+        }
+        else
+        {
+            if (this->parent->auto_clear_enabled_)
+            {
+                this->parent->fill(display::COLOR_OFF);
+            }
+            page->get_writer()(*this->parent);
+        }
+
+        this->load_strip(Area{0, y, this->width, this->band_height}, this->buffer, target);
+    }
+
+    this->band_y = 0;
+    this->band_height = 0;
+}
+
+
+/**
+ * @brief Load the rows held by a buffer into the controller memory, without refreshing the EPD
+ * @param area Display area, whose first row is the first row of the buffer
+ * @param source Buffer: the strip, or the snapshot holding a page
+ * @param address Controller memory address of the frame to load into
+ */
+void IT8951EDisplay::Impl::load_strip(Area const &area, uint8_t const * const source, uint32_t const address) const
+{
+    this->wait_area_ready(area);
+    uint32_t const transfer_start = micros();
+
+    CommandSequence sequence;
+    this->set_target_memory_addr(sequence, address >> 16, address & 0xFFFF);
+    this->set_area(sequence, area.x, area.y, area.w, area.h);
+    this->send_sequence(sequence);
+    this->set_bus_rate(this->write_rate);
+
+    uint32_t const load_start = micros();
+    uint32_t const bytes_start = this->stats.bytes_written;
+    {
+        SelectDevice display(this->cs_pin, this->stats.cs_toggles);
+        this->bus_write16(PREAMBLE_WRITE_DATA);
+        this->stream_rows(source, area.x >> 1, area.w >> 1, area.h);
+    }
+    this->stats.image_bytes_written += this->stats.bytes_written - bytes_start;
+    this->stats.image_write_us += micros() - load_start;
+
+    this->send_command(Command::TCON_LD_IMG_END);
+    this->last_transfer_us += micros() - transfer_start;
+}
+
+
+/**
+ * @brief Account pixels drawn through the generic, pixel by pixel, path
+ * @param pixels Number of pixels drawn
+ * @param duration Time spent drawing them, in us
+ */
+void IT8951EDisplay::Impl::record_generic_draw(uint32_t const pixels, uint32_t const duration) const
+{
+    this->loop_stats.generic_pixels += pixels;
+    this->loop_stats.generic_pixels_us += duration;
+}
+
+
+/**
+ * @brief Notify the display that the buffer has been updated
+ * @param x X coordinate of the updated image region
+ * @param y Y coordinate of the updated image region
+ * @param w Width of the updated area
+ * @param h Height of the updated area
+ */
+void IT8951EDisplay::Impl::notify_update(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h)
+{
+    IT8951E_LOGD(TAG, "Notify update: %d, %d, %d, %d", x, y, w, h);
+    this->dirty.mark(x, y, w, h);
+}
+
+
+/**
+ * @brief Add a region refreshed with a fixed update mode
+ * @return false if the region list is full
+ */
+bool IT8951EDisplay::Impl::add_mode_region(int const x, int const y, int const w, int const h, UpdateMode const mode)
+{
+    if (this->mode_region_count >= MAX_MODE_REGIONS)
+    {
+        return false;
+    }
+
+    ModeRegion &region = this->mode_regions[this->mode_region_count++];
+    region.x = x;
+    region.y = y;
+    region.w = w;
+    region.h = h;
+    region.area = Area{0, 0, 0, 0};
+    region.mode = mode;
+    return true;
+}
+
+
+/**
+ * @brief Convert the mode regions to frame buffer coordinates
+ *
+ * The regions are clipped to the display, and widened to the 4 pixel granularity of the controller.
+ *
+ * @param rotation Display rotation
+ */
+void IT8951EDisplay::Impl::map_mode_regions(display::DisplayRotation const rotation)
+{
+    bool const swap = (rotation == display::DISPLAY_ROTATION_90_DEGREES) || (rotation == display::DISPLAY_ROTATION_270_DEGREES);
+    int const logical_width = swap ? this->height : this->width;
+    int const logical_height = swap ? this->width : this->height;
+
+    for (size_t i = 0; i < this->mode_region_count; i++)
+    {
+        ModeRegion &region = this->mode_regions[i];
+
+        int const x1 = std::max(region.x, 0);
+        int const y1 = std::max(region.y, 0);
+        int const x2 = std::min(region.x + region.w, logical_width);
+        int const y2 = std::min(region.y + region.h, logical_height);
+        if ((x2 <= x1) || (y2 <= y1))
+        {
+            region.area = Area{0, 0, 0, 0};
+            continue;
+        }
+
+        Area area = to_physical(rotation, this->width, this->height, x1, y1, x2, y2);
+        uint16_t const x_end = std::min<uint32_t>((area.x + area.w + 3) & 0xFFFC, this->width);
+        area.x &= 0xFFFC;
+        area.w = x_end - area.x;
+        region.area = area;
+    }
+}
+
+
+/**
+ * @brief Queue the transfer of the dirty areas of the local frame buffer, and the periodic display cleaning.
+ *
+ * The caller must check can_submit() first.
+ */
+void IT8951EDisplay::Impl::do_update()
+{
+    if (!this->dirty.empty())
+    {
+        FlushJob job;
+        job.type = FlushJobType::Update;
+        job.count = this->dirty.extract(job.areas, DirtyTracker::MAX_AREAS, AREA_OVERHEAD_BYTES);
+        job.reload = this->reload_pending;
+        this->reload_pending = false;
+        this->submit(job);
+        this->last_update_time = millis();
+        this->schedule_clean = true;
+    }
+
+    if ((this->schedule_clean) && (millis() - this->last_update_time > this->idle_time))
+    {
+        // The completion of the job schedules the next idle window, if tiles are left
+        this->last_update_time = millis();
+        this->schedule_clean = false;
+
+        FlushJob job;
+        job.type = FlushJobType::Clean;
+        job.count = 0;
+        this->submit(job);
+    }
+}
+
+
+/**
+ * @brief Clear the display, as soon as the frame buffer is not in use by the flush task
+ */
+void IT8951EDisplay::Impl::request_clear()
+{
+    if (this->can_submit())
+    {
+        if (this->snapshot)
+        {
+            // The flush task clears its copy
+            memset(this->buffer, this->reversed ? 0x00 : 0xFF, this->get_buffer_size());
+        }
+
+        FlushJob job;
+        job.type = FlushJobType::Clear;
+        job.count = 0;
+        this->submit(job);
+    }
+    else
+    {
+        this->clear_pending = true;
+    }
+}
+
+
+/**
+ * @brief Process the jobs completed by the flush task, pick up its statistics, lower the bus rates after HRDY
+ * timeouts, and submit the postponed clear. Without flush task, run the display busy state machine. Called in the
+ * main loop.
+ */
+void IT8951EDisplay::Impl::poll()
+{
+    FlushCompletion completion;
+    while (this->flush_completions.pop(completion))
+    {
+        this->complete(completion);
+    }
+
+    if (this->flush_task.is_running())
+    {
+        {
+            LockGuard guard(this->stats_lock);
+            this->task_stats = this->published_stats;
+            this->tiles_over_budget = this->published_tiles_over_budget;
+        }
+
+        RefreshSample sample;
+        while (this->refresh_samples.pop(sample))
+        {
+            this->telemetry.add(sample);
+        }
+    }
+    else
+    {
+        this->service_refreshes();
+    }
+
+    this->publish_latency();
+
+    if (this->bus_errors.load(std::memory_order_acquire) && this->can_submit())
+    {
+        this->lower_bus_rates(this->bus_errors.exchange(0, std::memory_order_acquire));
+    }
+
+    if (this->clear_pending && this->can_submit())
+    {
+        this->clear_pending = false;
+        this->request_clear();
+    }
+
+    if (this->power_idle_time && !this->sleep_requested && (millis() - this->last_activity >= this->power_idle_time) &&
+        this->dirty.empty() && this->can_submit())
+    {
+        this->sleep_requested = true;
+        FlushJob job;
+        job.type = FlushJobType::Sleep;
+        job.count = 0;
+        this->submit(job);
+    }
+
+    if ((this->preload_pending >= 0) && this->can_submit())
+    {
+        uint8_t const slot = this->preload_pending;
+        this->preload_pending = -1;
+        this->request_preload(slot, this->preload_pending_page);
+    }
+
+    if ((this->show_pending >= 0) && this->can_submit())
+    {
+        uint8_t const slot = this->show_pending;
+        this->show_pending = -1;
+        this->request_show(slot, this->show_pending_mode);
+    }
+}
+
+
+/**
+ * @brief Account a completed job. Called in the main loop.
+ * @param completion Completed job
+ */
+void IT8951EDisplay::Impl::complete(FlushCompletion const &completion)
+{
+    this->loop_stats.flushes++;
+    this->loop_stats.flush_us += completion.duration;
+    IT8951E_LOGD(TAG, "Flush job %d done in %" PRIu32 " us", static_cast<int>(completion.type), completion.duration);
+
+    if ((completion.type == FlushJobType::Clean) && completion.more)
+    {
+        this->schedule_clean = true;
+    }
+}
+
+
+/**
+ * @brief Get the statistics, merged from the counters of the main loop and of the task driving the bus
+ *
+ * With a flush task, the bus counters are the copy handed over by the task at its last run, picked up by poll().
+ */
+Statistics IT8951EDisplay::Impl::get_statistics() const
+{
+    Statistics merged = this->flush_task.is_running() ? this->task_stats : this->stats;
+    merged.merge_loop_counters(this->loop_stats);
+    return merged;
+}
+
+
+/**
+ * @brief Set how many refreshes in an update mode a tile can take before it needs cleaning
+ *
+ * The ghosting tracker belongs to the task driving the bus, so the budgets can only change before the flush task
+ * starts.
+ *
+ * @param mode Update mode
+ * @param refreshes Number of refreshes, 0 to never clean because of this mode
+ */
+void IT8951EDisplay::Impl::set_ghosting_budget(UpdateMode const mode, uint16_t const refreshes)
+{
+    if (this->flush_task.is_running())
+    {
+        ESP_LOGW(TAG, "Ghosting budgets cannot change while the flush task runs");
+        return;
+    }
+    this->ghosting.set_budget(mode, refreshes);
+}
+
+
+/**
+ * @brief Get the number of display tiles over their ghosting budget
+ *
+ * With a flush task, the count handed over by the task after its last jobs, picked up by poll().
+ */
+uint16_t IT8951EDisplay::Impl::get_tiles_over_budget() const
+{
+    return this->flush_task.is_running() ? this->tiles_over_budget : this->ghosting.get_tiles_over_budget();
+}
+
+
+/**
+ * @brief Check if a job using the frame buffer can be submitted
+ *
+ * @return true without a flush task. With a flush task, true if the task does not read the snapshot and the job
+ * queue has room.
+ */
+bool IT8951EDisplay::Impl::can_submit() const
+{
+    if (!this->flush_task.is_running())
+    {
+        return true;
+    }
+    return !this->buffer_busy.load(std::memory_order_acquire) && !this->flush_jobs.full();
+}
+
+
+/**
+ * @brief Run a job, in the flush task if there is one, or immediately otherwise
+ * @param job Job to run
+ */
+void IT8951EDisplay::Impl::submit(FlushJob const &job)
+{
+    if (job.type != FlushJobType::Sleep)
+    {
+        this->last_activity = millis();
+        this->sleep_requested = false;
+    }
+
+    if (!this->flush_task.is_running())
+    {
+        uint32_t const start_time = micros();
+        bool const more = this->run_job(job);
+        this->check_bus_errors();
+        this->complete(FlushCompletion{job.type, micros() - start_time, more});
+        return;
+    }
+
+    // Clean jobs may restore the controller image buffer from the snapshot too
+    this->copy_to_snapshot(job);
+    this->buffer_busy.store(true, std::memory_order_release);
+
+    if (!this->flush_jobs.push(job))
+    {
+        // Should not happen, the caller checks can_submit(). Keep the areas for the next update.
+        ESP_LOGW(TAG, "Flush queue full, job postponed");
+        this->buffer_busy.store(false, std::memory_order_release);
+        for (size_t i = 0; i < job.count; i++)
+        {
+            this->dirty.mark(job.areas[i].x, job.areas[i].y, job.areas[i].w, job.areas[i].h);
+        }
+        this->clear_pending |= (job.type == FlushJobType::Clear);
+        return;
+    }
+
+    this->flush_task.notify();
+}
+
+
+/**
+ * @brief Copy the frame buffer areas of a job to the snapshot read by the flush task. Called in the main loop,
+ * while the task does not use the snapshot.
+ * @param job Job about to be submitted
+ */
+void IT8951EDisplay::Impl::copy_to_snapshot(FlushJob const &job)
+{
+    if (job.type == FlushJobType::Preload)
+    {
+        // The snapshot holds the page: the next job copies all of the frame buffer again
+        this->snapshot_valid = false;
+        return;
+    }
+
+    if (!this->snapshot_valid)
+    {
+        memcpy(this->snapshot, this->buffer, this->get_buffer_size());
+        this->snapshot_valid = true;
+        return;
+    }
+
+    size_t const stride = this->width >> 1;
+    for (size_t i = 0; i < job.count; i++)
+    {
+        Area const &area = job.areas[i];
+        size_t const begin = area.x >> 1;
+        size_t const length = std::min<size_t>((area.x + area.w + 1) >> 1, stride) - begin;
+        for (uint16_t row = area.y; row < area.y + area.h; row++)
+        {
+            memcpy(this->snapshot + row * stride + begin, this->buffer + row * stride + begin, length);
+        }
+    }
+}
+
+
+/**
+ * @brief Transfer the frame buffer areas of a job to the display and update the EPD, or clean/clear the display
+ * @param job Job to run
+ * @return true if a clean job left tiles over their ghosting budget, to clean in the next idle window
+ */
+bool IT8951EDisplay::Impl::run_job(FlushJob const &job)
+{
+    switch (job.type)
+    {
+        case FlushJobType::Update:
+        {
+            Statistics const start = this->stats;
+            uint32_t const start_time = micros();
+
+            for (size_t i = 0; i < job.count; i++)
+            {
+                Area area = job.areas[i];
+                if (this->sent_buffer && !job.reload && !this->clip_to_changes(area))
+                {
+                    IT8951E_LOGD(TAG, "Area (%d, %d) --> (%d, %d) unchanged", area.x, area.y, area.x + area.w, area.y + area.h);
+                    continue;
+                }
+                this->write_area(area, 0);
+            }
+            this->frame_levels = 0;
+            this->stats.log_operation("Update", start, micros() - start_time);
+            break;
+        }
+
+        case FlushJobType::Clean:
+        {
+            // Display data is already transferred, the IT8951E must only refresh the EPD
+            this->restore_stale_areas();
+            bool const more = this->ghosting.select(this->cleaning, this->max_clean_area);
+
+            Area areas[DirtyTracker::MAX_AREAS];
+            size_t const count = this->cleaning.extract(areas, DirtyTracker::MAX_AREAS, AREA_OVERHEAD_BYTES);
+            for (size_t i = 0; i < count; i++)
+            {
+                IT8951E_LOGD(TAG, "Inactivity - cleaning area (%d, %d) --> (%d, %d)",
+                    areas[i].x, areas[i].y, areas[i].x + areas[i].w, areas[i].y + areas[i].h);
+                this->update_area(areas[i].x, areas[i].y, areas[i].w, areas[i].h, UpdateMode::GC16);
+            }
+            return more;
+        }
+
+        case FlushJobType::Clear:
+            this->clear(true);
+            break;
+
+        case FlushJobType::Preload:
+            IT8951E_LOGD(TAG, "Preloading page slot %u", job.slot);
+            this->load_strip(Area{0, 0, this->width, this->height}, this->snapshot, this->get_frame_address(FRAME_PAGES + job.slot));
+            this->last_transfer_us = 0;
+            break;
+
+        case FlushJobType::Show:
+            IT8951E_LOGD(TAG, "Showing page slot %u", job.slot);
+            this->update_area(0, 0, this->width, this->height, job.mode, this->get_frame_address(FRAME_PAGES + job.slot));
+            break;
+
+        case FlushJobType::Sync:
+            // A controller in power saving has no refresh in progress, and is not woken for nothing
+            this->panel_idle = this->asleep.load(std::memory_order_relaxed) || this->wait_display_ready();
+            break;
+
+        case FlushJobType::Sleep:
+            this->enter_power_saving();
+            break;
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief Flush task callback: run all queued jobs, report their completion to the main loop, and run the display
+ * busy state machine
+ *
+ * @param arg The Impl
+ * @return Time in ms until the next LUT status poll, 0 if no refresh is in progress
+ */
+uint32_t IT8951EDisplay::Impl::drain_jobs(void *arg)
+{
+    Impl * const impl = static_cast<Impl *>(arg);
+    LockGuard bus_guard(impl->bus_lock);
+
+    FlushJob job;
+    bool ran = false;
+    while (impl->flush_jobs.pop(job))
+    {
+        ran = true;
+        uint32_t const start_time = micros();
+        bool const more = impl->run_job(job);
+        impl->check_bus_errors();
+        impl->buffer_busy.store(false, std::memory_order_release);
+
+        // If the main loop does not keep up, completions are dropped: the statistics miss the job, and the
+        // remaining ghosting is cleaned after the next update
+        impl->flush_completions.push(FlushCompletion{job.type, micros() - start_time, more});
+    }
+
+    uint32_t const next_poll = impl->service_refreshes();
+
+    {
+        LockGuard guard(impl->stats_lock);
+        impl->published_stats = impl->stats;
+        if (ran)
+        {
+            impl->published_tiles_over_budget = impl->ghosting.get_tiles_over_budget();
+        }
+    }
+
+    return next_poll;
+}
+
+
+/**
+ * @brief Start the flush task, if configured. Until then, and if it cannot be started, updates run in the main loop.
+ */
+void IT8951EDisplay::Impl::start_flush_task()
+{
+    if (this->flush_queue_depth == 0)
+    {
+        return;
+    }
+
+    if (this->is_banded())
+    {
+        // Bands are loaded while the writer runs, in the main loop
+        ESP_LOGW(TAG, "The flush task is not available in band rendering mode");
+        return;
+    }
+
+    if (!this->flush_jobs.init(this->flush_queue_depth) || !this->flush_completions.init(this->flush_queue_depth) ||
+        !this->refresh_samples.init(RefreshScheduler::MAX_IN_FLIGHT))
+    {
+        ESP_LOGW(TAG, "Could not allocate the flush queues, updating from the main loop");
+        return;
+    }
+
+    if (!this->allocate_snapshot())
+    {
+        ESP_LOGW(TAG, "Could not allocate the flush task frame buffer, updating from the main loop");
+        return;
+    }
+    this->snapshot_valid = false;
+    this->tiles_over_budget = this->ghosting.get_tiles_over_budget();
+    this->published_tiles_over_budget = this->tiles_over_budget;
+
+    if (!this->flush_task.start(Impl::drain_jobs, this, this->flush_task_core))
+    {
+        ESP_LOGW(TAG, "Could not start the flush task, updating from the main loop");
+    }
+}
+
+
+/**
+ * @brief Main constructor
+ */
+IT8951EDisplay::IT8951EDisplay() :
+    display::DisplayBuffer(),
+    spi::SPIDevice<spi_bit_order, spi_clock_polarity, spi_clock_phase, spi_data_rate>()
+{
+    this->m = make_unique<Impl>(this);
+}
+
+
+/**
+ * @brief Get the loop priority. Defines when during the main loop() the display update is checked
+ * @return 0.0f, the loop priority
+ */
+float IT8951EDisplay::get_loop_priority() const
+{
+    return 0.0f;
+}
+
+
+/**
+ * @brief Get the setup priority. Should initialize the display before other components like lvgl
+ * @return HARDWARE, the setup priority
+ */
+float IT8951EDisplay::get_setup_priority() const
+{
+    return setup_priority::HARDWARE;
+}
+
+
+/**
+ * @brief Set the reset pin
+ * @param pin Reset pin
+ */
+void IT8951EDisplay::set_reset_pin(GPIOPin *pin)
+{
+    this->m->reset_pin = pin;
+}
+
+
+/*
+ * @brief Set the ready pin
+ * @param pin Ready pin
+ */
+void IT8951EDisplay::set_ready_pin(GPIOPin *pin)
+{
+    this->m->ready_pin = pin;
+}
+
+
+/**
+ * @brief Set the chip select pin
+ * @param pin Chip select pin
+ */
+void IT8951EDisplay::set_cs_pin(GPIOPin *pin)
+{
+    this->m->cs_pin = pin;
+}
+
+
+/**
+ * @brief Get the width of the display
+ * @return width of the display
+ */
+int IT8951EDisplay::get_width_internal()
+{
+    return this->m->width;
+}
+
+
+/**
+ * @brief Get the height of the display
+ * @return height of the display
+ */
+int IT8951EDisplay::get_height_internal()
+{
+    return this->m->height;
+}
+
+
+/**
+ * @brief Initialize the local display buffer
+ * @param buffer_length Length of the buffer
+ */
+void IT8951EDisplay::init_internal_(uint32_t buffer_length)
+{
+    this->m->init_buffer(buffer_length);
+}
+
+
+/**
+ * @brief Clear the display
+ */
+void IT8951EDisplay::clear()
+{
+    this->m->request_clear();
+}
+
+
+/**
+ * @brief Read back the gray levels of an area of the controller image buffer, e.g. to check the displayed content
+ *
+ * Fails while the flush task runs a job: call it again later.
+ *
+ * @param x X coordinate of the area, in panel coordinates
+ * @param y Y coordinate of the area, in panel coordinates
+ * @param w Area width
+ * @param h Area height
+ * @param levels Output: gray levels 0 (black) to 15 (white), one byte per pixel, w bytes per row
+ *
+ * @return true if the area was read
+ */
+bool IT8951EDisplay::read_area(int x, int y, int w, int h, uint8_t *levels)
+{
+    if ((x < 0) || (y < 0) || (w <= 0) || (h <= 0) || (levels == nullptr))
+    {
+        return false;
+    }
+    return this->m->read_area(Area{static_cast<uint16_t>(x), static_cast<uint16_t>(y), static_cast<uint16_t>(w), static_cast<uint16_t>(h)}, levels);
+}
+
+
+/**
+ * @brief Read back the whole controller image buffer, streamed row by row, in panel orientation
+ * @param callback Called for each row with the gray levels of its pixels, 0 (black) to 15 (white)
+ * @return true if all rows were read
+ */
+bool IT8951EDisplay::screenshot(std::function<void(uint16_t row, uint8_t const *levels, uint16_t width)> const &callback)
+{
+    return this->m->screenshot(callback);
+}
+
+
+/**
+ * @brief Setup the display
+ */
+void IT8951EDisplay::setup()
+{
+    IT8951E_LOGD(TAG, "Init Starting.");
+
+    this->spi_setup();
+
+    if (this->m->hardware_rotation)
+    {
+        // The frame buffer is kept in logical orientation, so DisplayBuffer must not rotate the pixels
+        this->m->rotation = this->rotation_;
+        this->rotation_ = display::DISPLAY_ROTATION_0_DEGREES;
+    }
+
+    this->m->setup();
+    if (this->is_failed())
+    {
+        return;
+    }
+    this->m->map_mode_regions(this->rotation_);
+
+    if (this->m->is_warm_booted())
+    {
+        IT8951E_LOGD(TAG, "Warm boot, keeping the panel image");
+        this->m->keep_panel();
+    }
+    else
+    {
+        IT8951E_LOGD(TAG, "Clearing display...");
+        this->m->clear(true);
+    }
+
+    this->m->start_flush_task();
 
-    this->update_area(x, y, w, h, UpdateMode::GLR16);
+    IT8951E_LOGD(TAG, "Init SUCCESS.");
 }
 
 
 /**
- * @brief Write a pixel in the internal frame buffer at the specified location with the mentioned RGB color
- * @param x X coordinate of the pixel
- * @param y Y coordinate of the pixel
- * @param Color color of the pixel
+ * @brief Main loop: pick up the work of the flush task, and run the updates postponed while it was busy
  */
-void HOT IT8951EDisplay::Impl::put_pixel(int const x, int const y, Color const color)
+void IT8951EDisplay::loop()
 {
-    // Validation happens outside this function
-    uint32_t internal_color = ((color.r*77) + (color.g*151) + (color.b*28)) >> 12;
-    int32_t index = y * (this->width >> 1) + (x >> 1);
+    this->m->poll();
 
-    if (this->reversed)
+    if (this->update_pending && this->m->can_submit())
     {
-        internal_color = (~internal_color) & 0xFu;
+        this->update_pending = false;
+        this->update();
+    }
+}
+
+
+/**
+ * @brief Update the display. Called in the main loop
+ */
+void IT8951EDisplay::update()
+{
+    if (!this->m->can_submit())
+    {
+        // The flush task still reads the snapshot. Render once it is done, from loop()
+        this->update_pending = true;
+        return;
     }
 
-    if (x & 0x1)
+    if (!this->m->is_banded())
     {
-        this->buffer[index] &= 0xF0;
-        this->buffer[index] |= internal_color;
+        this->do_update_();
     }
-    else
+    else if (this->auto_clear_enabled_ || this->writer_.has_value() || (this->page_ != nullptr))
     {
-        this->buffer[index] &= 0x0F;
-        this->buffer[index] |= internal_color << 4;
+        // Without anything to render (e.g. LVGL), the pixels were loaded as they were drawn
+        this->m->render_bands(nullptr, 0);
     }
+
+    this->m->do_update();
 }
 
 
 /**
- * @brief Notify the display that the buffer has been updated
- * @param x X coordinate of the updated image region
- * @param y Y coordinate of the updated image region
- * @param w Width of the updated area
- * @param h Height of the updated area
+ * @brief Draw pixels from a given input buffer to the specified location
+ *
+ * The function is overloaded to allow a more efficient scheduling of the display update and input parameter validation
+ *
+ * @param x_start X coordinate of the top left corner
+ * @param y_start Y coordinate of the top left corner
+ * @param w Width of the image
+ * @param h Height of the image
+ * @param ptr Pointer to the source image data
+ * @param order Color order
+ * @param bitness Color bitness
+ * @param big_endian Endianness
+ * @param x_offset X offset
+ * @param y_offset Y offset
+ * @param x_pad X padding
  */
-void IT8951EDisplay::Impl::notify_update(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h)
+void IT8951EDisplay::draw_pixels_at(int x_start, int y_start, int w, int h, const uint8_t *ptr, display::ColorOrder order,
+                             display::ColorBitness bitness, bool big_endian, int x_offset, int y_offset, int x_pad)
 {
-    IT8951E_LOGD(TAG, "Notify update: %d, %d, %d, %d", x, y, w, h);
-    // Check if two rectangles overlap
-    auto overlap = [](const Rect &a, const Rect &b)
-    {
-        return !(((a.x + a.w) <= b.x) || ((b.x + b.w) <= a.x) || ((a.y + a.h) <= b.y) || ((b.y + b.h) <= a.y));
-    };
 
-    // Merge two rectangles
-    auto merge = [](const Rect &a, const Rect &b)
+    if (ptr == nullptr)
     {
-        uint16_t x = std::min(a.x, b.x);
-        uint16_t y = std::min(a.y, b.y);
-        uint16_t w = std::max(a.x + a.w, b.x + b.w) - x;
-        uint16_t h = std::max(a.y + a.h, b.y + b.h) - y;
-        return Rect{x, y, w, h};
-    };
+        return;
+    }
 
-    Rect new_rect = {x, y, w, h};
+    int const width = this->get_width();
+    int const height = this->get_height();
+
+    if ((x_start >= width) || (y_start >= height) || (x_start < 0) || (y_start < 0) || (w <= 0) || (h <= 0))
+    {
+        return;
+    }
 
-    bool merged = false;
+    // Clipped source columns become padding, so the source stride is unchanged
+    if ((x_start + w) > width)
+    {
+        x_pad += x_start + w - width;
+        w = width - x_start;
+    }
 
-    for (auto &rect : this->update_areas)
+    if ((y_start + h) > height)
     {
-        if (overlap(rect, new_rect))
-        {
-            IT8951E_LOGD(TAG, "(%d, %d, %d, %d) overlaps (%d, %d, %d, %d)", rect.x, rect.y, rect.w, rect.h, new_rect.x, new_rect.y, new_rect.w, new_rect.h);
-            rect = merge(rect, new_rect);
-            IT8951E_LOGD(TAG, "Merged into (%d, %d, %d, %d)", rect.x, rect.y, rect.w, rect.h);
-            merged = true;
-            break;
-        }
+        h = height - y_start;
     }
 
-    if (!merged)
+    // Without rotation or clipping, logical and frame buffer coordinates are the same: convert whole rows at once
+    if ((this->rotation_ == display::DISPLAY_ROTATION_0_DEGREES) && !this->get_clipping().is_set() &&
+        this->m->draw_pixels(x_start, y_start, w, h, ptr, order, bitness, big_endian, x_offset, y_offset, x_pad))
     {
-        IT8951E_LOGD(TAG, "Pushing (%d, %d, %d, %d)", new_rect.x, new_rect.y, new_rect.w, new_rect.h);
-        this->update_areas.push_back(new_rect);
+        return;
     }
+
+    // Every pixel drawn is marked dirty in put_pixel
+    uint32_t const start_time = micros();
+    Display::draw_pixels_at(x_start, y_start, w, h, ptr, order, bitness, big_endian, x_offset, y_offset, x_pad);
+    this->m->record_generic_draw(static_cast<uint32_t>(w) * h, micros() - start_time);
 }
 
 
 /**
- * @brief Transfer the local frame buffer to the display, and update the EPD.
+ * @brief Set the size of the transfer buffer
+ *
+ * Image data is gathered from the PSRAM frame buffer into this internal RAM buffer, and sent to the
+ * display in transfers of this size.
+ *
+ * @param size Size of the buffer in bytes. 0 sends the image data row by row, straight from the frame buffer.
  */
-void IT8951EDisplay::Impl::do_update()
+void IT8951EDisplay::set_transfer_buffer_size(size_t size)
 {
-    if (this->update_areas.size())
-    {
-        for (auto &rect : this->update_areas)
-        {
-            IT8951E_LOGD(TAG, "Pushing area (%d, %d) --> (%d, %d) to display", rect.x, rect.y, rect.x + rect.w, rect.y + rect.h);
-            this->write_buffer_to_display(rect.x, rect.y, rect.w, rect.h);
-        }
-        this->update_areas.clear();
-        this->last_update_time = millis();
-        this->schedule_clean = true;
-    }
+    this->m->transfer_buffer_size = size;
+}
+
+
+/**
+ * @brief Enable the flush task, which transfers the updates to the display outside of the main loop
+ *
+ * The task sends a copy of the frame buffer, so drawing goes on while it transfers an update. The copy takes as much
+ * PSRAM as the frame buffer. The next update is postponed until the task is done with the copy. The task drives the
+ * SPI bus outside of the main loop: no other device may share it, which display.py checks.
+ *
+ * @param queue_depth Maximum number of queued jobs. 0 disables the task: updates block the main loop.
+ * @param core Core the task is pinned to (ESP32), or -1 for any core
+ */
+void IT8951EDisplay::set_flush_task(uint8_t queue_depth, int8_t core)
+{
+    this->m->flush_queue_depth = queue_depth;
+    this->m->flush_task_core = core;
+}
+
+
+/**
+ * @brief Set the update mode used to refresh the display
+ * @param mode Update mode. UpdateMode::Auto picks the fastest mode for the content of each updated area.
+ */
+void IT8951EDisplay::set_update_mode(UpdateMode mode)
+{
+    this->m->update_mode = mode;
+}
 
-    if ((this->schedule_clean) && (millis() - this->last_update_time > 20000))
+
+/**
+ * @brief Refresh a region of the display with a fixed update mode, instead of the default update mode
+ *
+ * If regions overlap, the region added first wins.
+ *
+ * @param x X coordinate of the region, in display (rotated) coordinates
+ * @param y Y coordinate of the region
+ * @param width Width of the region
+ * @param height Height of the region
+ * @param mode Update mode of the region. UpdateMode::None leaves the region untouched on the EPD.
+ *
+ * @return false if there are already too many regions
+ */
+bool IT8951EDisplay::add_update_mode_region(int x, int y, int width, int height, UpdateMode mode)
+{
+    if (!this->m->add_mode_region(x, y, width, height, mode))
     {
-        // Display data is already transferred, the IT8951E must only refresh the EPD
-        IT8951E_LOGD(TAG, "Inactivity - cleaning display.");
-        this->update_area(0, 0, this->width, this->height, UpdateMode::GC16);
-        this->last_update_time = millis();
-        this->schedule_clean = false;
+        ESP_LOGW(TAG, "Too many update mode regions");
+        return false;
     }
+    this->m->map_mode_regions(this->rotation_);
+    return true;
 }
 
 
+/**
+ * @brief Remove all update mode regions
+ */
+void IT8951EDisplay::clear_update_mode_regions()
+{
+    this->m->clear_mode_regions();
+}
+
 
 /**
- * @brief Main constructor
+ * @brief Set the inactivity time after which the tiles over their ghosting budget are cleaned
+ * @param idle_time Inactivity time in ms
  */
-IT8951EDisplay::IT8951EDisplay() :
-    display::DisplayBuffer(),
-    spi::SPIDevice<spi_bit_order, spi_clock_polarity, spi_clock_phase, spi_data_rate>()
+void IT8951EDisplay::set_ghosting_idle_time(uint32_t idle_time)
 {
-    this->m = make_unique<Impl>(this);
+    this->m->idle_time = idle_time;
 }
 
 
 /**
- * @brief Get the loop priority. Defines when during the main loop() the display update is checked
- * @return 0.0f, the loop priority
+ * @brief Set the number of refreshes in an update mode a display tile can take before it is cleaned with GC16
+ * @param mode Update mode
+ * @param refreshes Number of refreshes, 0 to never clean because of this mode
  */
-float IT8951EDisplay::get_loop_priority() const
+void IT8951EDisplay::set_ghosting_budget(UpdateMode mode, uint16_t refreshes)
 {
-    return 0.0f;
+    this->m->set_ghosting_budget(mode, refreshes);
 }
 
 
 /**
- * @brief Get the setup priority. Should initialize the display before other components like lvgl
- * @return HARDWARE, the setup priority
+ * @brief Set the largest area cleaned in one idle window. The remaining tiles are cleaned in the next windows.
+ * @param pixels Area in pixels, 0 for no limit
  */
-float IT8951EDisplay::get_setup_priority() const
+void IT8951EDisplay::set_max_clean_area(uint32_t pixels)
 {
-    return setup_priority::HARDWARE;
+    this->m->max_clean_area = pixels;
 }
 
 
 /**
- * @brief Set the reset pin
- * @param pin Reset pin
+ * @brief Set the number of page slots reserved in the controller memory, after the image buffer
+ *
+ * The slots must fit in the controller memory left after the image, scratch and back buffers, or setup fails. With
+ * a full frame buffer, pages are rendered into a second frame buffer in PSRAM.
+ *
+ * @param slots Number of slots, each one the size of the panel at 8 bits per pixel
  */
-void IT8951EDisplay::set_reset_pin(GPIOPin *pin)
+void IT8951EDisplay::set_page_slots(uint8_t slots)
 {
-    this->m->reset_pin = pin;
+    this->m->page_slots = std::min(slots, Impl::MAX_PAGE_SLOTS);
 }
 
 
-/*
- * @brief Set the ready pin
- * @param pin Ready pin
+/**
+ * The image, scratch and back buffers and the page slots are laid out from the image buffer address read from the
+ * controller up to this size. Setup fails if the page slots do not fit.
+ *
+ * @param size Size of the controller memory, in bytes. Defaults to 8 MB, the 64 Mbit SDRAM of the IT8951.
  */
-void IT8951EDisplay::set_ready_pin(GPIOPin *pin)
+void IT8951EDisplay::set_controller_memory(uint32_t size)
 {
-    this->m->ready_pin = pin;
+    this->m->controller_memory = size;
 }
 
 
 /**
- * @brief Set the chip select pin
- * @param pin Chip select pin
+ * @brief Render a page and load it into a page slot of the controller memory, to be shown later by show_page()
+ * @param slot Page slot
+ * @param page Page to render
  */
-void IT8951EDisplay::set_cs_pin(GPIOPin *pin)
+void IT8951EDisplay::preload_page(uint8_t slot, display::DisplayPage *page)
 {
-    this->m->cs_pin = pin;
+    this->m->request_preload(slot, page);
 }
 
 
 /**
- * @brief Get the width of the display
- * @return width of the display
+ * @brief Show a preloaded page slot, without transferring any image data
+ * @param slot Page slot
+ * @param mode Update mode of the refresh
  */
-int IT8951EDisplay::get_width_internal()
+void IT8951EDisplay::show_page(uint8_t slot, UpdateMode mode)
 {
-    return this->m->width;
+    this->m->request_show(slot, mode);
 }
 
 
 /**
- * @brief Get the height of the display
- * @return height of the display
+ * @brief Render the display in bands of rows, through a strip of internal RAM, instead of a full frame buffer
+ *
+ * The writer then runs once per band. Pixels drawn outside of the writer with draw_pixels_at (e.g. by LVGL) are
+ * loaded into the controller as they are drawn. Frame diff and the flush task are not available.
+ *
+ * @param rows Rows of the strip. 0 uses a full frame buffer in PSRAM, and falls back to 64 rows if it cannot be
+ * allocated.
  */
-int IT8951EDisplay::get_height_internal()
+void IT8951EDisplay::set_band_rows(uint16_t rows)
 {
-    return this->m->height;
+    this->m->band_rows = rows;
 }
 
 
 /**
- * @brief Initialize the local display buffer
- * @param buffer_length Length of the buffer
+ * @brief Let the controller rotate the image data while loading it, instead of rotating every pixel drawn
+ *
+ * The frame buffer is then kept in logical orientation, and the display rotation configured at setup is applied
+ * by the controller. Rotations set later with set_rotation() are still applied in software, on top of it.
+ *
+ * @param hardware true to rotate in the controller
  */
-void IT8951EDisplay::init_internal_(uint32_t buffer_length)
+void IT8951EDisplay::set_hardware_rotation(bool hardware)
 {
-    this->m->init_buffer(buffer_length);
+    this->m->hardware_rotation = hardware;
 }
 
 
 /**
- * @brief Clear the display
+ * @brief Put the controller in standby or sleep when the display is idle
+ *
+ * The controller is woken by the next command sent to it, e.g. for the next update. The wake latency is listed by
+ * dump_config().
+ *
+ * @param idle_time Idle time before entering power saving, in ms. 0 keeps the controller running.
+ * @param sleep true for sleep, false for standby
  */
-void IT8951EDisplay::clear()
+void IT8951EDisplay::set_power_saving(uint32_t idle_time, bool sleep)
 {
-    this->m->clear(true);
+    this->m->power_idle_time = idle_time;
+    this->m->power_command = sleep ? Command::TCON_SLEEP : Command::TCON_STANDBY;
 }
 
 
 /**
- * @brief Setup the display
+ * @brief Keep the panel image across deep sleep
+ *
+ * At shutdown, the driver waits for the refreshes to end and saves the device info in RTC memory. When waking from
+ * deep sleep, the device info is not read again and the display is not cleared with the Init waveform. The
+ * controller is still reset: it loses its power in deep sleep.
+ *
+ * @param enabled true to enable the warm boot
  */
-void IT8951EDisplay::setup()
+void IT8951EDisplay::set_warm_boot(bool enabled)
 {
-    IT8951E_LOGD(TAG, "Init Starting.");
+    this->m->warm_boot = enabled;
+}
 
-    this->spi_setup();
 
-    this->m->setup();
+/**
+ * @brief Wait for the display to be idle before deep sleep or a reboot, and save the warm boot state
+ */
+void IT8951EDisplay::on_shutdown()
+{
+    this->m->shutdown();
+}
 
-    IT8951E_LOGD(TAG, "Clearing display...");
-    this->m->clear(true);
 
-    IT8951E_LOGD(TAG, "Init SUCCESS.");
+/**
+ * @brief Probe the fastest SPI write and read rates at startup, instead of the fixed default rate
+ *
+ * The rates found are stored, verified again at the next boots, and lowered if the controller stops answering.
+ * Rates above 40 MHz are not probed.
+ *
+ * @param max_write_rate Highest write rate probed, in Hz
+ * @param max_read_rate Highest read rate probed, in Hz
+ */
+void IT8951EDisplay::set_spi_auto_tune(uint32_t max_write_rate, uint32_t max_read_rate)
+{
+    this->m->spi_auto_tune = true;
+    this->m->max_write_rate = max_write_rate;
+    this->m->max_read_rate = max_read_rate;
 }
 
 
 /**
- * @brief Update the display. Called in the main loop
+ * @brief Load the next image data into a second controller memory frame while a refresh displays the first one
+ *
+ * Hides the transfer of continuously updated areas behind the waveform time of their previous refresh. Only used
+ * without rotation in the controller, and with a full frame buffer.
+ *
+ * @param enabled true to use the back buffer
  */
-void IT8951EDisplay::update()
+void IT8951EDisplay::set_double_buffering(bool enabled)
 {
-    this->do_update_();
-    this->m->do_update();
+    this->m->double_buffering = enabled;
 }
 
 
 /**
- * @brief Draw pixels from a given input buffer to the specified location
+ * @brief Send the image data of black and white (or any two level) content in 1bpp, and of DU4 content in 2bpp
  *
- * The function is overloaded to allow a more efficient scheduling of the display update and input parameter validation
+ * Needs a transfer buffer. Areas are widened to 32 pixel boundaries so they can be sent in 1bpp.
  *
- * @param x_start X coordinate of the top left corner
- * @param y_start Y coordinate of the top left corner
- * @param w Width of the image
- * @param h Height of the image
- * @param ptr Pointer to the source image data
- * @param order Color order
- * @param bitness Color bitness
- * @param big_endian Endianness
- * @param x_offset X offset
- * @param y_offset Y offset
- * @param x_pad X padding
+ * @param packed true to pack the image data when the content permits
  */
-void IT8951EDisplay::draw_pixels_at(int x_start, int y_start, int w, int h, const uint8_t *ptr, display::ColorOrder order,
-                             display::ColorBitness bitness, bool big_endian, int x_offset, int y_offset, int x_pad)
+void IT8951EDisplay::set_packed_transfers(bool packed)
 {
+    this->m->packed_transfers = packed;
+}
 
-    if (ptr == nullptr)
-    {
-        return;
-    }
 
-    if ((x_start >= this->m->width) || (y_start >= this->m->height) || (x_start < 0) || (y_start < 0) || (w <= 0) || (h <= 0))
-    {
-        return;
-    }
+/**
+ * @brief Set the sensor publishing the median refresh latency, over the latest refreshes
+ * @param sensor Sensor, in ms
+ */
+void IT8951EDisplay::set_latency_p50_sensor(sensor::Sensor *sensor)
+{
+    this->m->latency_p50_sensor = sensor;
+}
+
+
+/**
+ * @brief Set the sensor publishing the 99th percentile of the refresh latency, over the latest refreshes
+ * @param sensor Sensor, in ms
+ */
+void IT8951EDisplay::set_latency_p99_sensor(sensor::Sensor *sensor)
+{
+    this->m->latency_p99_sensor = sensor;
+}
+
+
+/**
+ * @brief Fill the whole display (or the clipping rectangle) with a color
+ *
+ * Writes the frame buffer row by row instead of pixel by pixel. The other drawing primitives of Display (lines,
+ * rectangles, ...) are not virtual, and go through draw_absolute_pixel_internal.
+ *
+ * @param color Fill color
+ */
+void IT8951EDisplay::fill(Color color)
+{
+    int x1 = 0;
+    int y1 = 0;
+    int x2 = this->get_width();
+    int y2 = this->get_height();
 
-    if ((x_start + w) > this->m->width)
+    display::Rect const clip = this->get_clipping();
+    if (clip.is_set())
     {
-        w = this->m->width - x_start;
+        x1 = std::max<int>(x1, clip.x);
+        y1 = std::max<int>(y1, clip.y);
+        x2 = std::min<int>(x2, clip.x + clip.w);
+        y2 = std::min<int>(y2, clip.y + clip.h);
     }
 
-    if ((y_start + h) > this->m->height)
+    if ((x2 <= x1) || (y2 <= y1))
     {
-        h = this->m->height - y_start;
+        return;
     }
 
-    Display::draw_pixels_at(x_start, y_start, w, h, ptr, order, bitness, big_endian, x_offset, y_offset, x_pad);
+    Area const area = to_physical(this->rotation_, this->m->width, this->m->height, x1, y1, x2, y2);
+    this->m->fill_rect(area.x, area.y, area.w, area.h, color);
+}
 
-    this->m->notify_update(x_start, y_start, w, h);
+
+/**
+ * @brief Set the memory budget of the frame diff mode
+ *
+ * Frame diff mode keeps a copy of the data sent to the controller, the size of the local frame buffer, and
+ * only transfers and refreshes the pixels that actually changed. It is enabled if the copy fits the budget.
+ *
+ * @param budget Maximum number of bytes the copy may use. 0 disables frame diff mode.
+ */
+void IT8951EDisplay::set_frame_diff_memory_budget(uint32_t budget)
+{
+    this->m->frame_diff_budget = budget;
 }
 
 
@@ -871,6 +2890,11 @@ void IT8951EDisplay::set_reversed(bool reversed)
  */
 void HOT IT8951EDisplay::draw_absolute_pixel_internal(int x, int y, Color color)
 {
+    if ((x < 0) || (y < 0) || (x >= this->m->width) || (y >= this->m->height))
+    {
+        return;
+    }
+
     this->m->put_pixel(x, y, color);
 }
 
@@ -881,10 +2905,63 @@ void HOT IT8951EDisplay::draw_absolute_pixel_internal(int x, int y, Color color)
 void IT8951EDisplay::dump_config()
 {
     ESP_LOGCONFIG(TAG, "IT8951E:");
-    ESP_LOGCONFIG(TAG, "  Size: %dx%d (WxH)", this->m->width, this->m->height);
+    ESP_LOGCONFIG(TAG, "  Size: %dx%d (WxH)", this->m->panel_width, this->m->panel_height);
+    ESP_LOGCONFIG(TAG, "  Hardware rotation: %s", (this->m->hardware_rotation ? "yes" : "no"));
     ESP_LOGCONFIG(TAG, "  Reversed: %s", (this->m->reversed ? "yes" : "no"));
+    ESP_LOGCONFIG(TAG, "  Frame diff: %s", (this->m->has_frame_diff() ? "yes" : "no"));
+    ESP_LOGCONFIG(TAG, "  Transfer buffer: %zu bytes", this->m->get_transfer_buffer_size());
+    if (this->m->is_banded())
+    {
+        ESP_LOGCONFIG(TAG, "  Band rendering: %u rows", this->m->get_buffer_rows());
+    }
+    if (this->m->has_flush_task())
+    {
+        ESP_LOGCONFIG(TAG, "  Flush task: queue depth %u, core %d, %u bytes of stack never used",
+                      this->m->flush_queue_depth, this->m->flush_task_core,
+                      static_cast<unsigned>(this->m->get_flush_stack_free()));
+    }
+    else
+    {
+        ESP_LOGCONFIG(TAG, "  Flush task: no");
+    }
+    if (this->m->power_idle_time)
+    {
+        ESP_LOGCONFIG(TAG, "  Power saving: %s after %" PRIu32 " ms idle",
+            (this->m->power_command == Command::TCON_SLEEP) ? "sleep" : "standby", this->m->power_idle_time);
+    }
+    if (this->m->warm_boot)
+    {
+        ESP_LOGCONFIG(TAG, "  Warm boot: %s", (this->m->is_warm_booted() ? "yes" : "no, cold boot"));
+    }
+    ESP_LOGCONFIG(TAG, "  SPI rates: write %" PRIu32 " Hz, read %" PRIu32 " Hz (%s)", this->m->write_rate, this->m->read_rate, this->m->rate_source);
+    ESP_LOGCONFIG(TAG, "  Controller memory: %" PRIu32 " bytes", this->m->controller_memory);
+    if (this->m->page_slots)
+    {
+        ESP_LOGCONFIG(TAG, "  Page slots: %u", this->m->page_slots);
+    }
     ESP_LOGCONFIG(TAG, "  FW version:  '%s'", this->m->fw_version);
     ESP_LOGCONFIG(TAG, "  LUT version: '%s'", this->m->lut_version);
+
+    StatisticsFeatures features;
+    features.packed_transfers = this->m->packed_transfers;
+    features.power_saving = (this->m->power_idle_time != 0);
+    features.spi_auto_tune = this->m->spi_auto_tune;
+    features.double_buffering = this->m->double_buffering;
+    this->m->get_statistics().dump_config(features);
+    ESP_LOGCONFIG(TAG, "  Ghosting: %u px tiles, %u over budget, cleaned after %" PRIu32 " ms idle",
+        this->m->get_ghosting_tile_size(), this->m->get_tiles_over_budget(), this->m->idle_time);
+
+    LatencyTelemetry const &telemetry = this->m->get_telemetry();
+    ESP_LOGCONFIG(TAG, "  Refresh latency: p50 %" PRIu32 " ms, p99 %" PRIu32 " ms", telemetry.get_percentile(50), telemetry.get_percentile(99));
+    for (size_t mode = 0; mode < static_cast<size_t>(UpdateMode::None); mode++)
+    {
+        LatencyTelemetry::ModeTotals const &totals = telemetry.get_totals(static_cast<UpdateMode>(mode));
+        if (totals.count)
+        {
+            ESP_LOGCONFIG(TAG, "    %s: %" PRIu32 " refreshes, transfer avg %" PRIu32 " us, LUT busy avg %" PRIu32 " ms, max %" PRIu32 " ms", UPDATE_MODE_NAMES[mode],
+                totals.count, totals.transfer_us / totals.count, totals.busy_ms / totals.count, totals.max_busy_ms);
+        }
+    }
 }
 
 }  // namespace empty_spi_sensor
@@ -3,6 +3,10 @@
 
 #include "esphome/components/spi/spi.h"
 #include "esphome/components/display/display_buffer.h"
+#include "esphome/components/sensor/sensor.h"
+#include "it8951e_priv.h"
+
+#include <functional>
 
 namespace esphome {
 namespace it8951e {
@@ -25,16 +29,44 @@ class IT8951EDisplay: public display::DisplayBuffer,
     void set_ready_pin(GPIOPin *pin);
     void set_cs_pin(GPIOPin *pin);
     void set_reversed(bool reversed);
+    void set_frame_diff_memory_budget(uint32_t budget);
+    void set_transfer_buffer_size(size_t size);
+    void set_flush_task(uint8_t queue_depth, int8_t core);
+    void set_update_mode(UpdateMode mode);
+    bool add_update_mode_region(int x, int y, int width, int height, UpdateMode mode);
+    void clear_update_mode_regions();
+    void set_ghosting_idle_time(uint32_t idle_time);
+    void set_ghosting_budget(UpdateMode mode, uint16_t refreshes);
+    void set_max_clean_area(uint32_t pixels);
+    void set_packed_transfers(bool packed);
+    void set_double_buffering(bool enabled);
+    void set_spi_auto_tune(uint32_t max_write_rate, uint32_t max_read_rate);
+    void set_warm_boot(bool enabled);
+    void set_power_saving(uint32_t idle_time, bool sleep);
+    void set_hardware_rotation(bool hardware);
+    void set_band_rows(uint16_t rows);
+    void set_page_slots(uint8_t slots);
+    void set_controller_memory(uint32_t size);
+    void preload_page(uint8_t slot, display::DisplayPage *page);
+    void show_page(uint8_t slot, UpdateMode mode = UpdateMode::GC16);
+    void set_latency_p50_sensor(sensor::Sensor *sensor);
+    void set_latency_p99_sensor(sensor::Sensor *sensor);
 
     void setup() override;
+    void loop() override;
+    void on_shutdown() override;
     void update() override;
     void clear();
+    bool read_area(int x, int y, int w, int h, uint8_t *levels);
+    bool screenshot(std::function<void(uint16_t row, uint8_t const *levels, uint16_t width)> const &callback);
     void dump_config() override;
 
     display::DisplayType get_display_type() override { return display::DisplayType::DISPLAY_TYPE_GRAYSCALE; }
 
     void draw_pixels_at(int x_start, int y_start, int w, int h, const uint8_t *ptr, display::ColorOrder order,
                         display::ColorBitness bitness, bool big_endian, int x_offset, int y_offset, int x_pad);
+
+    void fill(Color color) override;
   protected:
     void init_internal_(uint32_t buffer_length);
     void draw_absolute_pixel_internal(int x, int y, Color color) override;
@@ -49,6 +81,8 @@ class IT8951EDisplay: public display::DisplayBuffer,
     uint32_t max_x = 0;
     uint32_t max_y = 0;
 
+    bool update_pending = false;
+
     void write_buffer_to_display(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *gram);
     void write_display();
 };
@@ -58,5 +92,23 @@ public:
 void play(Ts... x) override { this->parent_->clear(); }
 };
 
+template<typename... Ts> class PreloadPageAction : public Action<Ts...>, public Parented<IT8951EDisplay> {
+public:
+TEMPLATABLE_VALUE(uint8_t, slot)
+void set_page(display::DisplayPage *page) { this->page_ = page; }
+void play(Ts... x) override { this->parent_->preload_page(this->slot_.value(x...), this->page_); }
+protected:
+display::DisplayPage *page_{nullptr};
+};
+
+template<typename... Ts> class ShowPageAction : public Action<Ts...>, public Parented<IT8951EDisplay> {
+public:
+TEMPLATABLE_VALUE(uint8_t, slot)
+void set_update_mode(UpdateMode mode) { this->mode_ = mode; }
+void play(Ts... x) override { this->parent_->show_page(this->slot_.value(x...), this->mode_); }
+protected:
+UpdateMode mode_{UpdateMode::GC16};
+};
+
 }  // namespace empty_spi_sensor
 }  // namespace esphome
@@ -0,0 +1,767 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "it8951e_impl.h"
+#include "esphome/core/application.h"
+
+namespace esphome {
+namespace it8951e {
+
+// HRDY wait: poll without sleeping for the first few microseconds, then back off exponentially up to the cap
+static constexpr uint32_t HRDY_SPIN_US = 20;
+
+// SPI clock rates probed by the auto-tuning, in Hz: the 80 MHz SPI clock of the ESP32 divided by 5 to 2. The
+// IT8951 SPI interface is not specified beyond that.
+static constexpr uint32_t TUNE_RATES[] = {16000000, 20000000, 26666667, 40000000};
+
+// Verification rounds of each probed rate, and the register values written and read back in each round
+static constexpr uint8_t TUNE_ROUNDS = 8;
+static constexpr uint16_t TUNE_PATTERNS[] = {0x0000, 0xFFFF, 0x5AA5, 0xA55A, 0x0F0F};
+
+// Reports of HRDY timeouts at rates still passing their verification, after which the rates are lowered anyway
+static constexpr uint8_t RATE_FALLBACK_REPORTS = 3;
+
+
+/**
+ * @brief Block until the ready pin goes high
+ *
+ * The controller is usually ready within a few microseconds, so the pin is polled in a tight loop first and
+ * the polling interval then grows exponentially, up to HRDY_MAX_BACKOFF_US. The wait duration is recorded in
+ * the HRDY histogram.
+ *
+ * @param timeout Timeout in ms
+ *
+ * @return true if ready pin is high within the timeout, false otherwise
+ */
+bool IT8951EDisplay::Impl::wait_comms_ready(uint32_t const timeout) const
+{
+    if (this->ready_pin->digital_read())
+    {
+        this->stats.record_hrdy_wait(0);
+        return true;
+    }
+
+    uint32_t const start_time = micros();
+    uint32_t const timeout_us = timeout * 1000;
+    uint32_t backoff = 1;
+
+    while (true)
+    {
+        uint32_t const elapsed = micros() - start_time;
+
+        if (this->ready_pin->digital_read())
+        {
+            this->stats.record_hrdy_wait(elapsed);
+            return true;
+        }
+
+        if (elapsed >= timeout_us)
+        {
+            this->stats.record_hrdy_wait(elapsed);
+            this->stats.hrdy_timeouts++;
+            this->timeout_rates |= ((this->bus_rate == this->write_rate) ? RATE_WRITE : 0) |
+                                   ((this->bus_rate == this->get_read_rate()) ? RATE_READ : 0);
+            return false;
+        }
+
+        if (elapsed >= HRDY_SPIN_US)
+        {
+            delayMicroseconds(backoff);
+            backoff = std::min(backoff * 2, HRDY_MAX_BACKOFF_US);
+            if (backoff == HRDY_MAX_BACKOFF_US)
+            {
+                this->keep_alive();
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Called periodically during long waits for the controller
+ *
+ * On the main loop this feeds the watchdog. The flush task sleeps for at least a tick instead, so the lower
+ * priority tasks of its core (including the idle task watched by the task watchdog) still get to run.
+ *
+ * @param sleep_ms Time to sleep, in ms
+ */
+void IT8951EDisplay::Impl::keep_alive(uint32_t const sleep_ms) const
+{
+    if (this->flush_task.is_current())
+    {
+        delay(std::max<uint32_t>(sleep_ms, 1));
+    }
+    else
+    {
+        if (sleep_ms)
+        {
+            delay(sleep_ms);
+        }
+        App.feed_wdt();
+    }
+}
+
+
+/**
+ * @brief Write a single word on the bus, MSB first
+ * @param data Word to write
+ */
+void IT8951EDisplay::Impl::bus_write16(uint16_t const data) const
+{
+    this->stats.bytes_written += 2;
+    this->parent->write_byte16(data);
+}
+
+
+/**
+ * @brief Write a block of bytes on the bus
+ * @param data Bytes to write
+ * @param length Number of bytes
+ */
+void IT8951EDisplay::Impl::bus_write(uint8_t const * const data, size_t const length) const
+{
+    this->stats.bytes_written += length;
+    this->parent->write_array(data, length);
+}
+
+
+/**
+ * @brief Exchange a block of bytes on the bus. The received data overwrites the sent data.
+ * @param data Bytes to send, and buffer for the received bytes
+ * @param length Number of bytes
+ */
+void IT8951EDisplay::Impl::bus_transfer(uint8_t * const data, size_t const length) const
+{
+    this->stats.bytes_read += length;
+    this->parent->transfer_array(data, length);
+}
+
+
+/**
+ * @brief Write one CS-framed transaction: a preamble followed by a burst of data
+ *
+ * HRDY is checked before the preamble and before the data burst. The controller buffers a burst
+ * of data words, so HRDY is not checked in between words.
+ *
+ * @param preamble Preamble of the transaction
+ * @param data Data to write after the preamble, already big endian
+ * @param length Number of bytes of data
+ *
+ * @return true if the data was written, false if the display was not ready
+ */
+bool IT8951EDisplay::Impl::write_frame(uint16_t const preamble, uint8_t const * const data, size_t const length) const
+{
+    if (!this->wait_comms_ready())
+    {
+        ESP_LOGE(TAG, "Display busy trying to write preamble 0x%04x", preamble);
+        return false;
+    }
+
+    SelectDevice display(this->cs_pin, this->stats.cs_toggles);
+
+    this->bus_write16(preamble);
+
+    if (!this->wait_comms_ready())
+    {
+        ESP_LOGE(TAG, "Display busy trying to write data after preamble 0x%04x", preamble);
+        return false;
+    }
+
+    this->bus_write(data, length);
+    return true;
+}
+
+
+/**
+ * @brief Send a command to the display
+ * @param command Command to write
+ * @return true if the command was written, false if the display was not ready
+ */
+bool IT8951EDisplay::Impl::send_command(Command const command) const
+{
+    if ((command != Command::TCON_SYS_RUN) && this->asleep.load(std::memory_order_relaxed))
+    {
+        this->wake();
+    }
+
+    IT8951E_LOGD(TAG, "Write command 0x%02x", static_cast<uint16_t>(command));
+    uint8_t const data[2] = {static_cast<uint8_t>(static_cast<uint16_t>(command) >> 8), static_cast<uint8_t>(command)};
+
+    if (!this->write_frame(PREAMBLE_COMMAND, data, 2))
+    {
+        return false;
+    }
+
+    this->stats.commands++;
+    return true;
+}
+
+
+/**
+ * @brief Write a word (uint16_t) to the display
+ * @param data Data to write
+ */
+void IT8951EDisplay::Impl::write_word(uint16_t const data) const
+{
+    IT8951E_LOGD(TAG, "Write word 0x%04x", data);
+    uint8_t const bytes[2] = {static_cast<uint8_t>(data >> 8), static_cast<uint8_t>(data)};
+
+    this->write_frame(PREAMBLE_WRITE_DATA, bytes, 2);
+}
+
+
+/**
+ * @brief Send all commands of a sequence to the display
+ *
+ * Each command is sent as one command transaction, followed by one data transaction holding all its arguments.
+ *
+ * The register shadow was updated when the register writes were queued. If a transaction fails, the controller may
+ * not hold these values: the shadow is invalidated, so the next writes are sent whatever their value.
+ *
+ * @param sequence Commands to send
+ */
+void IT8951EDisplay::Impl::send_sequence(CommandSequence const &sequence) const
+{
+    for (size_t i = 0; i < sequence.size(); i++)
+    {
+        bool sent = this->send_command(sequence.command(i));
+        if (sent && sequence.arguments_length(i))
+        {
+            sent = this->write_frame(PREAMBLE_WRITE_DATA, sequence.arguments(i), sequence.arguments_length(i));
+        }
+
+        if (!sent)
+        {
+            this->shadow.invalidate();
+        }
+    }
+}
+
+
+/**
+ * @brief Read a multiple bytes from the display.
+ *
+ * Read multiple bytes from the display into the given address.
+ *
+ * A read shorter than 4 bytes will read 4 bytes from the device over SPI and return only
+ * the requested number of bytes.
+ *
+ * Chaining multiple read_bytes calls, with sizes less than 4 bytes may result in a
+ * misaligned read and data loss.
+ *
+ * This is confirmed on ESP32 when DMA is enabled (automatically usually)
+ *
+ * The bus is left at the read rate afterwards: the commands following a read are sent at it too.
+ *
+ * @arg buf Pointer to the buffer to read into
+ * @arg length Number of bytes to read
+ */
+void IT8951EDisplay::Impl::read_bytes(void * const buf, uint16_t const length) const
+{
+    if (!this->wait_comms_ready())
+    {
+        ESP_LOGE(TAG, "Display not ready to receive read data preamble");
+        return;
+    }
+
+    this->set_bus_rate(this->get_read_rate());
+    SelectDevice display(this->cs_pin, this->stats.cs_toggles);
+    if (this->start_read())
+    {
+        this->bus_transfer(reinterpret_cast<uint8_t *>(buf), length);
+    }
+}
+
+
+/**
+ * @brief Send the read preamble and the dummy word of a read transaction. The device must be selected.
+ * @return true if the display is ready to send the data
+ */
+bool IT8951EDisplay::Impl::start_read() const
+{
+    this->bus_write16(PREAMBLE_READ_DATA);
+
+    if (!this->wait_comms_ready())
+    {
+        ESP_LOGE(TAG, "Display not ready to receive read data dummy bytes");
+        return false;
+    }
+
+    this->bus_write16(PREAMBLE_WRITE_DATA);
+    if (!this->wait_comms_ready())
+    {
+        ESP_LOGE(TAG, "Display not ready to send data");
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Read the controller memory with a burst read
+ *
+ * The burst is widened to 4 byte boundaries, since reads over SPI are done in whole 4 byte words (see
+ * read_bytes()). The bytes outside of the requested range are read and dropped. The data is read in chunks
+ * through the transfer buffer, or through a small buffer on the stack without one.
+ *
+ * @param address Controller memory address of the first byte
+ * @param dest Output buffer, length bytes
+ * @param length Number of bytes to read
+ *
+ * @return true if the data was read, false if the display was not ready
+ */
+bool IT8951EDisplay::Impl::read_memory(uint32_t const address, uint8_t * const dest, size_t const length) const
+{
+    uint32_t const start = address & ~3u;
+    size_t const skip = address - start;
+    size_t const total = (skip + length + 3) & ~static_cast<size_t>(3);
+    uint32_t const read_start = micros();
+
+    // Burst length in 16 bit words
+    uint16_t const args[4] = {
+        static_cast<uint16_t>(start & 0xFFFF), static_cast<uint16_t>(start >> 16),
+        static_cast<uint16_t>((total >> 1) & 0xFFFF), static_cast<uint16_t>((total >> 1) >> 16)
+    };
+    CommandSequence sequence;
+    sequence.add(Command::TCON_MEM_BST_RD_T, args, 4);
+    sequence.add(Command::TCON_MEM_BST_RD_S);
+    this->send_sequence(sequence);
+
+    if (!this->wait_comms_ready())
+    {
+        ESP_LOGE(TAG, "Display not ready to receive read data preamble");
+        return false;
+    }
+
+    alignas(4) uint8_t stack_buffer[64];
+    uint8_t * const chunk_buffer = this->transfer_buffer ? this->transfer_buffer : stack_buffer;
+    size_t const chunk_size = this->transfer_buffer ? (this->transfer_buffer_size & ~static_cast<size_t>(3)) : sizeof(stack_buffer);
+
+    bool ready;
+    this->set_bus_rate(this->get_read_rate());
+    {
+        SelectDevice display(this->cs_pin, this->stats.cs_toggles);
+        ready = this->start_read();
+
+        for (size_t done = 0; ready && (done < total);)
+        {
+            size_t const chunk = std::min(total - done, chunk_size);
+            memset(chunk_buffer, 0, chunk);
+            this->bus_transfer(chunk_buffer, chunk);
+
+            // Words are sent most significant byte first, and the lower address is the low byte of a word
+            for (size_t i = 0; i < chunk; i++)
+            {
+                size_t const offset = done + (i ^ 1);
+                if ((offset >= skip) && (offset < skip + length))
+                {
+                    dest[offset - skip] = chunk_buffer[i];
+                }
+            }
+            done += chunk;
+        }
+    }
+
+    this->send_command(Command::TCON_MEM_BST_END);
+    this->stats.memory_bytes_read += total;
+    this->stats.memory_read_us += micros() - read_start;
+    return ready;
+}
+
+
+/**
+ * @brief Read a word (uint16_t) from the display
+ *
+ * @return uint16_t The word read from the display
+ */
+uint16_t IT8951EDisplay::Impl::read_word() const
+{
+    uint16_t read_data;
+    this->read_bytes(&read_data, 2);
+
+    // IT8951E is big-endian and ESP32 is little-endian
+    return ((read_data & 0xFF00) >> 8) | ((read_data & 0x00FF) << 8);
+}
+
+
+/**
+ * @brief Send to the display a command with arguments
+ *
+ * @param cmd Command to send
+ * @param args Arguments to send, uint16_t. Endianness conversion is done automatically.
+ * @param length Number of arguments
+ */
+void IT8951EDisplay::Impl::send_command_with_args(Command const cmd, uint16_t const * const args, uint16_t const length) const
+{
+    CommandSequence sequence;
+    sequence.add(cmd, args, length);
+    this->send_sequence(sequence);
+}
+
+
+/**
+ * @brief Read a display register
+ * @param address Register address
+ *
+ * @return Register value
+ */
+uint16_t IT8951EDisplay::Impl::read_register(Register const address) const
+{
+    this->send_command(Command::TCON_REG_RD);
+    this->write_word(static_cast<uint16_t>(address));
+    uint16_t word = this->read_word();
+    return word;
+}
+
+
+/**
+ * @brief Write a display register
+ * @param address Register address
+ * @param data Data to write to register
+ */
+void IT8951EDisplay::Impl::write_register(Register const address, uint16_t const data) const {
+    CommandSequence sequence;
+    this->queue_register_write(sequence, address, data);
+    this->send_sequence(sequence);
+}
+
+
+/**
+ * @brief Append a register write to a command sequence, unless the register already holds the value
+ * @param sequence Command sequence to append the write to
+ * @param address Register address
+ * @param data Data to write to register
+ */
+void IT8951EDisplay::Impl::queue_register_write(CommandSequence &sequence, Register const address, uint16_t const data) const
+{
+    if (!this->shadow.update(address, data))
+    {
+        this->stats.register_writes_skipped++;
+        return;
+    }
+
+    this->stats.register_writes++;
+    if (!sequence.write_register(address, data))
+    {
+        // The write is dropped, so the shadow cannot keep the value
+        this->shadow.invalidate();
+    }
+}
+
+
+/**
+ * @brief Set the VCOM voltage, unless already set
+ * @param vcom VCOM voltage in mV (absolute value, the voltage is negative)
+ */
+void IT8951EDisplay::Impl::set_vcom(uint16_t const vcom) const
+{
+    if (!this->shadow.update_vcom(vcom))
+    {
+        this->stats.register_writes_skipped++;
+        return;
+    }
+
+    IT8951E_LOGD(TAG, "Set VCOM");
+    this->stats.register_writes++;
+    uint16_t const args[2] = {0x0001, vcom};
+    this->send_command_with_args(Command::I80_CMD_VCOM, args, 2);
+}
+
+
+/**
+ * @brief Set up the SPI device for a clock rate, unless it already runs at it
+ *
+ * Setting up the SPI device again is expensive, so the bus only runs at the write rate for image data, and at the
+ * read rate for everything else (see get_read_rate()). Polling a register during a refresh then never switches.
+ *
+ * @param rate Clock rate, in Hz
+ */
+void IT8951EDisplay::Impl::set_bus_rate(uint32_t const rate) const
+{
+    if (rate == this->bus_rate)
+    {
+        return;
+    }
+
+    uint32_t const start_time = micros();
+    this->parent->spi_teardown();
+    this->parent->set_data_rate(rate);
+    this->parent->spi_setup();
+    this->bus_rate = rate;
+    this->stats.rate_switches++;
+    this->stats.rate_switch_us += micros() - start_time;
+}
+
+
+/**
+ * @brief Check that the controller is reliably reached at the current write and read rates
+ *
+ * Test values are written into LISAR and read back, and the device info must match the one read at the default
+ * rate. LISAR is set before each image load anyway.
+ *
+ * @param reference Device info read at the default rate, nullptr if it was not read (warm boot)
+ * @return true if all values were read back, without HRDY timeout
+ */
+bool IT8951EDisplay::Impl::verify_bus(uint8_t const * const reference) const
+{
+    uint32_t const timeouts = this->stats.hrdy_timeouts;
+    bool verified = true;
+
+    for (uint8_t round = 0; verified && (round < TUNE_ROUNDS); round++)
+    {
+        for (uint16_t const pattern : TUNE_PATTERNS)
+        {
+            // Bypasses the register shadow, which would skip writing the same value twice. The reads switch the bus
+            // to the read rate: the write rate is set again for each write.
+            this->set_bus_rate(this->write_rate);
+            uint16_t const args[2] = {static_cast<uint16_t>(Register::LISAR), pattern};
+            this->send_command_with_args(Command::TCON_REG_WR, args, 2);
+            if (this->read_register(Register::LISAR) != pattern)
+            {
+                verified = false;
+                break;
+            }
+        }
+
+        if (reference != nullptr)
+        {
+            uint8_t info[DEVICE_INFO_SIZE] = {};
+            this->read_device_info(info);
+            verified = verified && (memcmp(info, reference, DEVICE_INFO_SIZE) == 0);
+        }
+    }
+
+    this->shadow.invalidate();
+    return verified && (this->stats.hrdy_timeouts == timeouts);
+}
+
+
+/**
+ * @brief Find the fastest write and read rates the controller is reliably reached at
+ *
+ * The rates stored by a previous boot are verified and used if they still work. Otherwise the write rate is probed
+ * first, reading back at the default rate, then the read rate. Each probe stops at the first rate failing its
+ * verification, and the controller is reset after a failure. The rates found are stored.
+ */
+void IT8951EDisplay::Impl::tune_bus()
+{
+    uint8_t * const reference = this->bus_reference;
+    this->read_device_info(reference);
+    this->has_bus_reference = true;
+
+    BusRates stored;
+    if (this->rate_preference.load(&stored) && (stored.write_rate <= this->max_write_rate) &&
+        (stored.read_rate <= this->max_read_rate))
+    {
+        this->write_rate = stored.write_rate;
+        this->read_rate = stored.read_rate;
+        if (this->verify_bus(reference))
+        {
+            this->rate_source = "stored";
+            this->timeout_rates = 0;
+            return;
+        }
+
+        ESP_LOGW(TAG, "Stored SPI rates (write %" PRIu32 " Hz, read %" PRIu32 " Hz) failed, tuning again", stored.write_rate, stored.read_rate);
+        this->reset();
+    }
+
+    uint32_t * const rates[2] = {&this->write_rate, &this->read_rate};
+    uint32_t const limits[2] = {this->max_write_rate, this->max_read_rate};
+    this->write_rate = spi_data_rate;
+    this->read_rate = spi_data_rate;
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        for (uint32_t const rate : TUNE_RATES)
+        {
+            // Reads never run faster than writes
+            if ((rate > limits[i]) || ((i == 1) && (rate > this->write_rate)))
+            {
+                break;
+            }
+
+            uint32_t const verified_rate = *rates[i];
+            *rates[i] = rate;
+            if (!this->verify_bus(reference))
+            {
+                IT8951E_LOGD(TAG, "SPI %s rate %" PRIu32 " Hz failed", (i == 0) ? "write" : "read", rate);
+                *rates[i] = verified_rate;
+                this->set_bus_rate(this->write_rate);
+                this->reset();
+                break;
+            }
+        }
+    }
+
+    this->set_bus_rate(this->write_rate);
+    this->rate_source = "tuned";
+    this->timeout_rates = 0;
+    BusRates const tuned = {this->write_rate, this->read_rate};
+    this->rate_preference.save(&tuned);
+    ESP_LOGI(TAG, "SPI rates tuned: write %" PRIu32 " Hz, read %" PRIu32 " Hz", this->write_rate, this->read_rate);
+}
+
+
+/**
+ * @brief Report the rates HRDY timed out at since the last check to the main loop, see lower_bus_rates()
+ *
+ * Called after each job, by the flush task if it drives the bus. Setting up the SPI device again and storing the
+ * rates are left to the main loop.
+ */
+void IT8951EDisplay::Impl::check_bus_errors()
+{
+    if (!this->spi_auto_tune || (this->timeout_rates == 0))
+    {
+        return;
+    }
+    this->bus_errors.fetch_or(this->timeout_rates, std::memory_order_release);
+    this->timeout_rates = 0;
+}
+
+
+/**
+ * @brief Get the next probed rate below a rate
+ * @param rate Rate, in Hz
+ * @return Next lower rate, the default rate at the bottom
+ */
+static uint32_t lower_rate(uint32_t const rate)
+{
+    uint32_t lower = spi_data_rate;
+    for (uint32_t const candidate : TUNE_RATES)
+    {
+        if (candidate < rate)
+        {
+            lower = candidate;
+        }
+    }
+    return std::min(rate, lower);
+}
+
+
+/**
+ * @brief Step the tuned rates down after the HRDY timeouts reported by check_bus_errors()
+ *
+ * A timeout can come from a command the controller is slow to process rather than from the clock rate, so the
+ * rates are verified first. Only the rates HRDY timed out at are lowered, once they fail their verification or after
+ * RATE_FALLBACK_REPORTS reports. Called in the main loop while no job runs: the bus lock keeps the flush task off
+ * the bus. The lowered rates are stored.
+ *
+ * @param rates Rates HRDY timed out at: RATE_WRITE, RATE_READ or both
+ */
+void IT8951EDisplay::Impl::lower_bus_rates(uint8_t const rates)
+{
+    if ((this->write_rate == spi_data_rate) && (this->read_rate == spi_data_rate))
+    {
+        return;
+    }
+
+    LockGuard guard(this->bus_lock);
+    bool const verified = this->verify_bus(this->has_bus_reference ? this->bus_reference : nullptr);
+    this->timeout_rates = 0;
+    if (verified && (++this->bus_error_reports < RATE_FALLBACK_REPORTS))
+    {
+        ESP_LOGW(TAG, "HRDY timeouts, the SPI rates still verify (%u of %u reports)",
+                 this->bus_error_reports, RATE_FALLBACK_REPORTS);
+        return;
+    }
+    this->bus_error_reports = 0;
+
+    if (rates & RATE_WRITE)
+    {
+        this->write_rate = lower_rate(this->write_rate);
+    }
+    if (rates & RATE_READ)
+    {
+        this->read_rate = lower_rate(this->get_read_rate());
+    }
+
+    ESP_LOGW(TAG, "HRDY timeouts, lowering the SPI rates to write %" PRIu32 " Hz, read %" PRIu32 " Hz", this->write_rate, this->read_rate);
+    this->set_bus_rate(this->write_rate);
+    this->stats.rate_fallbacks++;
+    this->rate_source = "lowered";
+
+    BusRates const lowered = {this->write_rate, this->read_rate};
+    this->rate_preference.save(&lowered);
+}
+
+
+/**
+ * @brief Read back the gray levels of an area of the controller image buffer
+ *
+ * The image buffer holds the data last loaded for each pixel, in panel orientation, one byte per pixel. Areas
+ * last sent in 1bpp or into the back buffer are restored first. Not possible while the flush task runs a job. Between
+ * jobs, the flush task still polls the refreshes in progress: the bus lock keeps it off the bus during the read.
+ *
+ * @param area Area, in panel coordinates
+ * @param levels Output: gray levels 0 to 15, one byte per pixel, area.w bytes per row
+ *
+ * @return true if the area was read
+ */
+bool IT8951EDisplay::Impl::read_area(Area const &area, uint8_t * const levels) const
+{
+    if (!this->can_submit() || ((area.x + area.w) > this->panel_width) || ((area.y + area.h) > this->panel_height))
+    {
+        return false;
+    }
+
+    LockGuard guard(this->bus_lock);
+    this->restore_stale_areas();
+
+    size_t const length = static_cast<size_t>(area.w) * area.h;
+    uint32_t const address = this->get_image_address() + static_cast<uint32_t>(area.y) * this->panel_width + area.x;
+    if (area.w == this->panel_width)
+    {
+        // Consecutive rows: one burst
+        if (!this->read_memory(address, levels, length))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        for (uint16_t row = 0; row < area.h; row++)
+        {
+            if (!this->read_memory(address + static_cast<uint32_t>(row) * this->panel_width, levels + row * area.w, area.w))
+            {
+                return false;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < length; i++)
+    {
+        levels[i] >>= 4;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Read back the whole controller image buffer, row by row
+ * @param callback Called for each panel row with its gray levels, one byte per pixel
+ * @return true if all rows were read
+ */
+bool IT8951EDisplay::Impl::screenshot(std::function<void(uint16_t, uint8_t const *, uint16_t)> const &callback) const
+{
+    std::unique_ptr<uint8_t[]> const row(new (std::nothrow) uint8_t[this->panel_width]);
+    if (!row)
+    {
+        return false;
+    }
+
+    for (uint16_t y = 0; y < this->panel_height; y++)
+    {
+        if (!this->read_area(Area{0, y, this->panel_width, 1}, row.get()))
+        {
+            return false;
+        }
+        callback(y, row.get(), this->panel_width);
+    }
+
+    return true;
+}
+
+} // namespace it8951e
+} // namespace esphome
@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "it8951e_convert.h"
+#include "esphome/core/hal.h"
+
+namespace esphome {
+namespace it8951e {
+
+// Weights of the red, green and blue channels in the gray level, the sum being 256
+static constexpr uint16_t WEIGHT_RED = 77;
+static constexpr uint16_t WEIGHT_GREEN = 151;
+static constexpr uint16_t WEIGHT_BLUE = 28;
+
+
+/**
+ * @brief Convert a row of source pixels, writing two pixels per output byte
+ * @param source First source pixel
+ * @param line Frame buffer row
+ * @param x X coordinate of the first pixel in the row
+ * @param count Number of pixels to convert
+ * @param bytes_per_pixel Size of a source pixel
+ * @param level Function converting a source pixel to a gray level
+ */
+template<typename Level>
+static inline void convert(uint8_t const *source, uint8_t * const line, uint16_t const x, uint16_t const count,
+                           size_t const bytes_per_pixel, Level const &level)
+{
+    uint8_t *out = line + (x >> 1);
+    uint16_t remaining = count;
+
+    if ((x & 0x1) && remaining)
+    {
+        *out = (*out & 0xF0) | level(source);
+        out++;
+        source += bytes_per_pixel;
+        remaining--;
+    }
+
+    while (remaining >= 2)
+    {
+        *out++ = (level(source) << 4) | level(source + bytes_per_pixel);
+        source += 2 * bytes_per_pixel;
+        remaining -= 2;
+    }
+
+    if (remaining)
+    {
+        *out = (*out & 0x0F) | (level(source) << 4);
+    }
+}
+
+
+/**
+ * @brief Build the conversion tables for a source format, unless already built
+ * @param order Color order of the source pixels
+ * @param bitness Color bitness of the source pixels
+ * @param big_endian Endianness of the source pixels
+ * @param reversed Reverse the gray levels
+ */
+void PixelConverter::configure(display::ColorOrder const order, display::ColorBitness const bitness, bool const big_endian, bool const reversed)
+{
+    if (this->configured && (this->order == order) && (this->bitness == bitness) &&
+        (this->big_endian == big_endian) && (this->reversed == reversed))
+    {
+        return;
+    }
+
+    this->order = order;
+    this->bitness = bitness;
+    this->big_endian = big_endian;
+    this->reversed = reversed;
+    this->configured = true;
+
+    uint8_t bits[3];
+    switch (bitness)
+    {
+        case display::ColorBitness::COLOR_BITNESS_565:
+            bits[0] = 5; bits[1] = 6; bits[2] = 5;
+            this->bytes_per_pixel = 2;
+            break;
+        case display::ColorBitness::COLOR_BITNESS_332:
+            bits[0] = 3; bits[1] = 3; bits[2] = 2;
+            this->bytes_per_pixel = 1;
+            break;
+        default:
+            bits[0] = 8; bits[1] = 8; bits[2] = 8;
+            this->bytes_per_pixel = 3;
+            break;
+    }
+
+    uint16_t weight[3];
+    switch (order)
+    {
+        case display::ColorOrder::COLOR_ORDER_BGR:
+            weight[0] = WEIGHT_BLUE; weight[1] = WEIGHT_GREEN; weight[2] = WEIGHT_RED;
+            break;
+        case display::ColorOrder::COLOR_ORDER_GRB:
+            weight[0] = WEIGHT_GREEN; weight[1] = WEIGHT_RED; weight[2] = WEIGHT_BLUE;
+            break;
+        default:
+            weight[0] = WEIGHT_RED; weight[1] = WEIGHT_GREEN; weight[2] = WEIGHT_BLUE;
+            break;
+    }
+
+    // Scale the channels like ColorUtil::to_color does
+    for (size_t channel = 0; channel < 3; channel++)
+    {
+        uint8_t const max = (1u << bits[channel]) - 1;
+        for (uint16_t value = 0; value <= max; value++)
+        {
+            this->weights[channel][value] = weight[channel] * display::ColorUtil::esp_scale(value, max);
+        }
+    }
+
+    for (uint8_t level = 0; level < 16; level++)
+    {
+        this->levels[level] = reversed ? ((~level) & 0xFu) : level;
+    }
+
+    for (uint16_t value = 0; value < 256; value++)
+    {
+        uint32_t const sum = this->weights[0][value >> 5] + this->weights[1][(value >> 2) & 0x7] + this->weights[2][value & 0x3];
+        this->levels_332[value] = this->levels[sum >> 12];
+    }
+}
+
+
+/**
+ * @brief Convert a row of source pixels into the frame buffer
+ *
+ * configure() must have been called for the source format.
+ *
+ * @param source First source pixel
+ * @param line Frame buffer row
+ * @param x X coordinate of the first pixel in the row
+ * @param count Number of pixels to convert
+ */
+void HOT PixelConverter::convert_row(uint8_t const *source, uint8_t * const line, uint16_t const x, uint16_t const count) const
+{
+    auto const &w = this->weights;
+    auto const &levels = this->levels;
+
+    switch (this->bitness)
+    {
+        case display::ColorBitness::COLOR_BITNESS_565:
+            if (this->big_endian)
+            {
+                convert(source, line, x, count, 2, [&](uint8_t const *p) {
+                    uint16_t const v = (p[0] << 8) | p[1];
+                    return levels[(w[0][v >> 11] + w[1][(v >> 5) & 0x3F] + w[2][v & 0x1F]) >> 12];
+                });
+            }
+            else
+            {
+                convert(source, line, x, count, 2, [&](uint8_t const *p) {
+                    uint16_t const v = p[0] | (p[1] << 8);
+                    return levels[(w[0][v >> 11] + w[1][(v >> 5) & 0x3F] + w[2][v & 0x1F]) >> 12];
+                });
+            }
+            break;
+
+        case display::ColorBitness::COLOR_BITNESS_332:
+            convert(source, line, x, count, 1, [&](uint8_t const *p) {
+                return this->levels_332[*p];
+            });
+            break;
+
+        default:
+            if (this->big_endian)
+            {
+                convert(source, line, x, count, 3, [&](uint8_t const *p) {
+                    return levels[(w[0][p[0]] + w[1][p[1]] + w[2][p[2]]) >> 12];
+                });
+            }
+            else
+            {
+                convert(source, line, x, count, 3, [&](uint8_t const *p) {
+                    return levels[(w[0][p[2]] + w[1][p[1]] + w[2][p[0]]) >> 12];
+                });
+            }
+            break;
+    }
+}
+
+} // namespace it8951e
+} // namespace esphome
@@ -0,0 +1,53 @@
+#pragma once
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/**
+ * @file it8951e_convert.h
+ * @brief Bulk conversion of RGB pixel rows to the packed 4bpp frame buffer format of the IT8951 driver.
+ */
+
+#include "esphome/components/display/display_buffer.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace esphome {
+namespace it8951e {
+
+/**
+ * @brief Row converter from the source formats of Display::draw_pixels_at to packed 4bpp gray levels
+ *
+ * The conversion tables are built for one combination of color order, bitness, endianness and reversed flag,
+ * and rebuilt only when the combination changes. Converting a pixel is then a few table lookups and an add,
+ * with the same result as converting it with ColorUtil::to_color and the driver's RGB to gray weights.
+ */
+class PixelConverter
+{
+    public:
+        void configure(display::ColorOrder const order, display::ColorBitness const bitness, bool const big_endian, bool const reversed);
+
+        size_t get_bytes_per_pixel() const { return this->bytes_per_pixel; }
+
+        void convert_row(uint8_t const *source, uint8_t * const line, uint16_t const x, uint16_t const count) const;
+
+    private:
+        bool configured = false;
+        display::ColorOrder order = display::ColorOrder::COLOR_ORDER_RGB;
+        display::ColorBitness bitness = display::ColorBitness::COLOR_BITNESS_888;
+        bool big_endian = false;
+        bool reversed = false;
+
+        size_t bytes_per_pixel = 3;
+
+        // Weighted contribution of the first, second and third color channel to the gray sum
+        uint16_t weights[3][256] = {};
+
+        // Gray sum >> 12 to stored gray level, handles the reversed flag
+        uint8_t levels[16] = {};
+
+        // Direct lookup for 8 bit (332) source pixels
+        uint8_t levels_332[256] = {};
+};
+
+} // namespace it8951e
+} // namespace esphome
@@ -0,0 +1,326 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "it8951e_dirty.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace esphome {
+namespace it8951e {
+
+// Smallest tiles used. Smaller tiles track the dirty regions more precisely, but produce more areas to merge.
+static constexpr uint8_t MIN_TILE_WIDTH_SHIFT = 4;
+static constexpr uint8_t MIN_TILE_HEIGHT_SHIFT = 3;
+
+
+/**
+ * @brief Check if two areas overlap
+ */
+static bool intersects(Area const &a, Area const &b)
+{
+    return !(((a.x + a.w) <= b.x) || ((b.x + b.w) <= a.x) || ((a.y + a.h) <= b.y) || ((b.y + b.h) <= a.y));
+}
+
+
+/**
+ * @brief Get the bounding box of two areas
+ */
+static Area bounding_box(Area const &a, Area const &b)
+{
+    uint16_t x = std::min(a.x, b.x);
+    uint16_t y = std::min(a.y, b.y);
+    uint16_t w = std::max(a.x + a.w, b.x + b.w) - x;
+    uint16_t h = std::max(a.y + a.h, b.y + b.h) - y;
+    return Area{x, y, w, h};
+}
+
+
+/**
+ * @brief Cost of transferring an area: the bytes of image data (4bpp), plus a fixed overhead per area
+ */
+static uint32_t cost(Area const &area, uint32_t const area_overhead)
+{
+    return ((static_cast<uint32_t>(area.w) * area.h) >> 1) + area_overhead;
+}
+
+
+/**
+ * @brief Grow an area until it overlaps none of the areas of a list, removing the areas it swallows from the list
+ *
+ * @param areas List of areas
+ * @param count Number of areas in the list
+ * @param candidate Area to grow
+ * @param absorbed_cost Incremented by the cost of each swallowed area
+ * @param area_overhead Fixed cost of one area
+ *
+ * @return New number of areas in the list
+ */
+static size_t absorb(Area * const areas, size_t count, Area &candidate, uint32_t &absorbed_cost, uint32_t const area_overhead)
+{
+    bool grown = true;
+    while (grown)
+    {
+        grown = false;
+        for (size_t i = 0; i < count;)
+        {
+            if (intersects(areas[i], candidate))
+            {
+                absorbed_cost += cost(areas[i], area_overhead);
+                candidate = bounding_box(candidate, areas[i]);
+                areas[i] = areas[--count];
+                grown = true;
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief Setup the tile grid for a display size
+ *
+ * The tiles are chosen as small as possible, as long as the tile grid fits in the fixed size bitmap.
+ *
+ * @param width Display width in pixels
+ * @param height Display height in pixels
+ */
+void DirtyTracker::init(uint16_t const width, uint16_t const height)
+{
+    this->width = width;
+    this->height = height;
+
+    this->tile_width_shift = MIN_TILE_WIDTH_SHIFT;
+    while (((width + (1u << this->tile_width_shift) - 1) >> this->tile_width_shift) > MAX_COLUMNS)
+    {
+        this->tile_width_shift++;
+    }
+
+    this->tile_height_shift = MIN_TILE_HEIGHT_SHIFT;
+    while (((height + (1u << this->tile_height_shift) - 1) >> this->tile_height_shift) > MAX_ROWS)
+    {
+        this->tile_height_shift++;
+    }
+
+    this->row_count = (height + (1u << this->tile_height_shift) - 1) >> this->tile_height_shift;
+
+    this->clear();
+}
+
+
+/**
+ * @brief Mark a rectangle as dirty
+ *
+ * The rectangle is clipped to the display size.
+ *
+ * @param x X coordinate of the rectangle
+ * @param y Y coordinate of the rectangle
+ * @param w Width of the rectangle
+ * @param h Height of the rectangle
+ */
+void DirtyTracker::mark(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h)
+{
+    if ((w == 0) || (h == 0) || (x >= this->width) || (y >= this->height))
+    {
+        return;
+    }
+
+    uint16_t const last_x = std::min<uint32_t>(x + w, this->width) - 1;
+    uint16_t const last_y = std::min<uint32_t>(y + h, this->height) - 1;
+
+    uint16_t const first_column = x >> this->tile_width_shift;
+    uint16_t const last_column = last_x >> this->tile_width_shift;
+
+    uint64_t const mask = ((last_column - first_column == 63) ? ~0ull : ((1ull << (last_column - first_column + 1)) - 1)) << first_column;
+
+    for (uint16_t row = y >> this->tile_height_shift; row <= (last_y >> this->tile_height_shift); row++)
+    {
+        this->rows[row] |= mask;
+    }
+}
+
+
+/**
+ * @brief Check if there is anything to update
+ * @return true if no tile is dirty
+ */
+bool DirtyTracker::empty() const
+{
+    for (uint16_t row = 0; row < this->row_count; row++)
+    {
+        if (this->rows[row])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * @brief Mark all tiles as clean
+ */
+void DirtyTracker::clear()
+{
+    memset(this->rows, 0, sizeof(this->rows));
+}
+
+
+/**
+ * @brief Convert a tile rectangle to pixels, clipped to the display size
+ */
+Area DirtyTracker::to_pixels(uint16_t const column, uint16_t const row, uint16_t const columns, uint16_t const rows) const
+{
+    uint16_t const x = column << this->tile_width_shift;
+    uint16_t const y = row << this->tile_height_shift;
+    uint16_t const w = std::min<uint32_t>(columns << this->tile_width_shift, this->width - x);
+    uint16_t const h = std::min<uint32_t>(rows << this->tile_height_shift, this->height - y);
+    return Area{x, y, w, h};
+}
+
+
+/**
+ * @brief Mark the tiles an area covers as clean
+ */
+void DirtyTracker::clear_area(Area const &area)
+{
+    uint16_t const first_column = area.x >> this->tile_width_shift;
+    uint16_t const last_column = (area.x + area.w - 1) >> this->tile_width_shift;
+
+    uint64_t const mask = ((last_column - first_column == 63) ? ~0ull : ((1ull << (last_column - first_column + 1)) - 1)) << first_column;
+
+    for (uint16_t row = area.y >> this->tile_height_shift; row <= ((area.y + area.h - 1) >> this->tile_height_shift); row++)
+    {
+        this->rows[row] &= ~mask;
+    }
+}
+
+
+/**
+ * @brief Convert the dirty tiles into a list of non-overlapping areas to transfer, and mark all tiles clean
+ *
+ * The tiles are first split into maximal vertical stacks of identical horizontal runs. Areas are then merged
+ * whenever transferring their bounding box is cheaper than transferring them separately, absorbing any other
+ * area the bounding box overlaps. The work done is bounded by the size of the bitmap and max_areas.
+ *
+ * @param areas Output list of areas
+ * @param max_areas Capacity of the output list. At most MAX_AREAS are used.
+ * @param area_overhead Fixed cost of one area, in bytes of image data
+ *
+ * @return Number of areas written to the list
+ */
+size_t DirtyTracker::extract(Area * const areas, size_t const max_areas, uint32_t const area_overhead)
+{
+    size_t const capacity = std::min(max_areas, MAX_AREAS);
+    size_t count = 0;
+
+    if (capacity == 0)
+    {
+        this->clear();
+        return 0;
+    }
+
+    for (uint16_t row = 0; row < this->row_count; row++)
+    {
+        while (this->rows[row])
+        {
+            uint64_t const bits = this->rows[row];
+            uint16_t const first = __builtin_ctzll(bits);
+            uint64_t const run = ~(bits >> first);
+            uint16_t const length = run ? __builtin_ctzll(run) : (64 - first);
+            uint64_t const mask = ((length == 64) ? ~0ull : ((1ull << length) - 1)) << first;
+
+            uint16_t end_row = row + 1;
+            while ((end_row < this->row_count) && ((this->rows[end_row] & mask) == mask))
+            {
+                end_row++;
+            }
+
+            for (uint16_t clear_row = row; clear_row < end_row; clear_row++)
+            {
+                this->rows[clear_row] &= ~mask;
+            }
+
+            Area const area = this->to_pixels(first, row, length, end_row - row);
+
+            if (count < capacity)
+            {
+                areas[count++] = area;
+                continue;
+            }
+
+            // Out of space: merge with the area that grows the least
+            size_t best = 0;
+            uint32_t best_growth = UINT32_MAX;
+            for (size_t i = 0; i < count; i++)
+            {
+                uint32_t const growth = cost(bounding_box(areas[i], area), area_overhead) - cost(areas[i], area_overhead);
+                if (growth < best_growth)
+                {
+                    best = i;
+                    best_growth = growth;
+                }
+            }
+
+            Area merged = bounding_box(areas[best], area);
+            uint32_t absorbed_cost = 0;
+            areas[best] = areas[--count];
+            count = absorb(areas, count, merged, absorbed_cost, area_overhead);
+            areas[count++] = merged;
+
+            // The merged area may cover tiles not extracted yet, which would otherwise become overlapping areas
+            this->clear_area(merged);
+        }
+    }
+
+    // Merge areas while it reduces the total cost
+    bool merged = true;
+    while (merged && (count > 1))
+    {
+        merged = false;
+        for (size_t i = 0; (i < count) && !merged; i++)
+        {
+            for (size_t j = i + 1; (j < count) && !merged; j++)
+            {
+                Area const candidate = bounding_box(areas[i], areas[j]);
+                uint32_t const separate = cost(areas[i], area_overhead) + cost(areas[j], area_overhead);
+                if (cost(candidate, area_overhead) > separate)
+                {
+                    continue;
+                }
+
+                // The bounding box may overlap other areas, which then need to be merged as well
+                Area trial[MAX_AREAS];
+                size_t trial_count = 0;
+                for (size_t k = 0; k < count; k++)
+                {
+                    if ((k != i) && (k != j))
+                    {
+                        trial[trial_count++] = areas[k];
+                    }
+                }
+
+                Area grown = candidate;
+                uint32_t trial_separate = separate;
+                trial_count = absorb(trial, trial_count, grown, trial_separate, area_overhead);
+
+                if (cost(grown, area_overhead) <= trial_separate)
+                {
+                    memcpy(areas, trial, trial_count * sizeof(Area));
+                    areas[trial_count] = grown;
+                    count = trial_count + 1;
+                    merged = true;
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+} // namespace it8951e
+} // namespace esphome
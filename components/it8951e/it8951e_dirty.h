@@ -0,0 +1,77 @@
+#pragma once
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/**
+ * @file it8951e_dirty.h
+ * @brief Fixed-memory tracker of the display regions that need to be transferred to the IT8951 controller.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace esphome {
+namespace it8951e {
+
+/**
+ * @brief Rectangular display area, in pixels
+ */
+struct Area {
+    uint16_t x, y, w, h;
+};
+
+
+/**
+ * @brief Tile bitmap of the dirty display regions
+ *
+ * The display is split into tiles, whose width is a multiple of 4 pixels (the x granularity of the
+ * controller). Each tile row is a 64 bit mask, so marking a pixel or a rectangle dirty is a couple of
+ * bit operations and never allocates memory.
+ *
+ * When the display is updated, the dirty tiles are converted into a small set of non-overlapping areas,
+ * using a cost model that weighs the number of bytes to transfer against the fixed overhead of
+ * transferring one more area.
+ */
+class DirtyTracker
+{
+    public:
+        static constexpr uint16_t MAX_COLUMNS = 64;
+        static constexpr uint16_t MAX_ROWS = 128;
+        static constexpr size_t MAX_AREAS = 32;
+
+        void init(uint16_t const width, uint16_t const height);
+
+        void mark(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h);
+
+        /**
+         * @brief Mark a single pixel as dirty. Called for every pixel drawn, the coordinates are not checked.
+         * @param x X coordinate of the pixel
+         * @param y Y coordinate of the pixel
+         */
+        inline void mark_pixel(uint16_t const x, uint16_t const y)
+        {
+            this->rows[y >> this->tile_height_shift] |= 1ull << (x >> this->tile_width_shift);
+        }
+
+        bool empty() const;
+        void clear();
+
+        size_t extract(Area * const areas, size_t const max_areas, uint32_t const area_overhead);
+
+        uint16_t get_tile_width() const { return 1u << this->tile_width_shift; }
+        uint16_t get_tile_height() const { return 1u << this->tile_height_shift; }
+
+    private:
+        uint64_t rows[MAX_ROWS] = {0};
+
+        uint16_t width = 0;
+        uint16_t height = 0;
+        uint16_t row_count = 0;
+        uint8_t tile_width_shift = 2;
+        uint8_t tile_height_shift = 2;
+
+        Area to_pixels(uint16_t const column, uint16_t const row, uint16_t const columns, uint16_t const rows) const;
+        void clear_area(Area const &area);
+};
+
+} // namespace it8951e
+} // namespace esphome
@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "it8951e_flush.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace it8951e {
+
+// Stack of the task, in bytes. The deepest path (an update job through the mode regions down to a LUT status poll,
+// with debug logging) takes about 5.5 kB: the unused part is listed by dump_config().
+static constexpr uint32_t FLUSH_TASK_STACK_SIZE = 8192;
+static constexpr uint32_t FLUSH_TASK_PRIORITY = 1;
+
+
+/**
+ * @brief Start the task
+ *
+ * The task waits for a start notification, sent once its handle (thread id on the host) is set, so is_current() is
+ * valid in the task from its first callback run.
+ *
+ * @param callback Function run by the task each time it is notified
+ * @param arg Argument of the callback
+ * @param core Core to pin the task to (ESP32 only), or -1 for no affinity
+ *
+ * @return true if the task was started, false if the platform has no task support or the task could not be created
+ */
+bool FlushTask::start(Callback const callback, void * const arg, int const core)
+{
+    this->callback = callback;
+    this->arg = arg;
+
+#if defined(USE_ESP32)
+    BaseType_t const affinity = ((core < 0) || (core >= portNUM_PROCESSORS)) ? tskNO_AFFINITY : core;
+    if (xTaskCreatePinnedToCore(FlushTask::run, "it8951e", FLUSH_TASK_STACK_SIZE, this, FLUSH_TASK_PRIORITY,
+                                &this->handle, affinity) == pdPASS)
+    {
+        this->notify();
+        return true;
+    }
+#elif defined(USE_HOST)
+    std::thread thread(FlushTask::run, this);
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->thread_id = thread.get_id();
+    }
+    thread.detach();
+    this->notify();
+    return true;
+#endif
+
+    this->callback = nullptr;
+    return false;
+}
+
+
+/**
+ * @brief Wake up the task. Several notifications before the task runs result in a single callback run.
+ */
+void FlushTask::notify()
+{
+#if defined(USE_ESP32)
+    xTaskNotifyGive(this->handle);
+#elif defined(USE_HOST)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->notified = true;
+    }
+    this->condition.notify_one();
+#endif
+}
+
+
+/**
+ * @brief Check if the caller runs in the task
+ */
+bool FlushTask::is_current() const
+{
+#if defined(USE_ESP32)
+    return (this->handle != nullptr) && (xTaskGetCurrentTaskHandle() == this->handle);
+#elif defined(USE_HOST)
+    return this->is_running() && (std::this_thread::get_id() == this->thread_id);
+#else
+    return false;
+#endif
+}
+
+
+/**
+ * @brief Get the stack space the task never used so far
+ * @return Bytes of stack, 0 if unknown
+ */
+size_t FlushTask::get_stack_free() const
+{
+#if defined(USE_ESP32)
+    return (this->handle != nullptr) ? uxTaskGetStackHighWaterMark(this->handle) : 0;
+#else
+    return 0;
+#endif
+}
+
+
+/**
+ * @brief Block until notified
+ * @param timeout Maximum time to wait in ms, 0 for no limit
+ */
+void FlushTask::wait(uint32_t const timeout)
+{
+#if defined(USE_ESP32)
+    ulTaskNotifyTake(pdTRUE, timeout ? std::max<TickType_t>(pdMS_TO_TICKS(timeout), 1) : portMAX_DELAY);
+#elif defined(USE_HOST)
+    std::unique_lock<std::mutex> lock(this->mutex);
+    if (timeout)
+    {
+        this->condition.wait_for(lock, std::chrono::milliseconds(timeout), [this] { return this->notified; });
+    }
+    else
+    {
+        this->condition.wait(lock, [this] { return this->notified; });
+    }
+    this->notified = false;
+#endif
+}
+
+
+/**
+ * @brief Task body: wait for the start notification, then run the callback after every notification, or after the
+ * delay it asked for
+ * @param self The FlushTask
+ */
+void FlushTask::run(void *self)
+{
+    FlushTask * const task = static_cast<FlushTask *>(self);
+    task->wait(0);
+
+    for (;;)
+    {
+        uint32_t const timeout = task->callback(task->arg);
+        task->wait(timeout);
+    }
+}
+
+} // namespace it8951e
+} // namespace esphome
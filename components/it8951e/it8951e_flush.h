@@ -0,0 +1,139 @@
+#pragma once
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/**
+ * @file it8951e_flush.h
+ * @brief Background task and lock-free queues used to transfer display updates outside of the main loop.
+ */
+
+#include "esphome/core/defines.h"
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(USE_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#elif defined(USE_HOST)
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace esphome {
+namespace it8951e {
+
+/**
+ * @brief Fixed capacity, single producer, single consumer, lock-free queue
+ *
+ * One task may push and one (other) task may pop, without any locking. The storage is allocated once by init().
+ */
+template<typename T> class SpscQueue
+{
+    public:
+        /**
+         * @brief Allocate the queue storage
+         * @param depth Maximum number of queued items
+         * @return true if the storage could be allocated
+         */
+        bool init(size_t const depth)
+        {
+            this->items.reset(new (std::nothrow) T[depth + 1]);
+            this->size = this->items ? (depth + 1) : 0;
+            return this->items != nullptr;
+        }
+
+        /**
+         * @brief Add an item at the end of the queue. Producer side only.
+         * @return false if the queue is full
+         */
+        bool push(T const &item)
+        {
+            size_t const tail = this->tail.load(std::memory_order_relaxed);
+            size_t const next = this->next(tail);
+            if ((this->size == 0) || (next == this->head.load(std::memory_order_acquire)))
+            {
+                return false;
+            }
+            this->items[tail] = item;
+            this->tail.store(next, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Take the item at the front of the queue. Consumer side only.
+         * @return false if the queue is empty
+         */
+        bool pop(T &item)
+        {
+            size_t const head = this->head.load(std::memory_order_relaxed);
+            if (head == this->tail.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            item = this->items[head];
+            this->head.store(this->next(head), std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Check if an item can be pushed. Producer side only.
+         */
+        bool full() const
+        {
+            return (this->size == 0) ||
+                   (this->next(this->tail.load(std::memory_order_relaxed)) == this->head.load(std::memory_order_acquire));
+        }
+
+    private:
+        std::unique_ptr<T[]> items;
+        size_t size = 0;
+        std::atomic<size_t> head{0};
+        std::atomic<size_t> tail{0};
+
+        size_t next(size_t const index) const { return (index + 1 == this->size) ? 0 : (index + 1); }
+};
+
+
+/**
+ * @brief Worker task, which runs a callback each time it is notified, or when the delay the callback asked for
+ * has elapsed
+ *
+ * On ESP32 this is a FreeRTOS task, optionally pinned to a core. On the host platform it is a std::thread.
+ * On other platforms the task cannot be started, and the caller must do the work itself.
+ */
+class FlushTask
+{
+    public:
+        // Returns the delay in ms after which to run again without notification, 0 to wait for a notification
+        typedef uint32_t (*Callback)(void *arg);
+
+        bool start(Callback const callback, void * const arg, int const core);
+        void notify();
+        bool is_running() const { return this->callback != nullptr; }
+        bool is_current() const;
+        size_t get_stack_free() const;
+
+    private:
+        Callback callback = nullptr;
+        void *arg = nullptr;
+
+        void wait(uint32_t const timeout);
+        static void run(void *self);
+
+#if defined(USE_ESP32)
+        TaskHandle_t handle = nullptr;
+#elif defined(USE_HOST)
+        std::thread::id thread_id;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool notified = false;
+#endif
+};
+
+} // namespace it8951e
+} // namespace esphome
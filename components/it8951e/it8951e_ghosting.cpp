@@ -0,0 +1,193 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "it8951e_ghosting.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace esphome {
+namespace it8951e {
+
+// Smallest tiles used, in pixels (log2). Ghosting is cleaned per tile, so smaller tiles clean less of the display.
+static constexpr uint8_t MIN_TILE_SHIFT = 6;
+
+
+/**
+ * @brief Constructor, sets the default budgets
+ *
+ * The slower 16 level modes leave less ghosting than the fast black and white and 4 level modes.
+ */
+GhostingTracker::GhostingTracker()
+{
+    this->set_budget(UpdateMode::DU, 20);
+    this->set_budget(UpdateMode::DU4, 10);
+    this->set_budget(UpdateMode::A2, 10);
+    this->set_budget(UpdateMode::GL16, 30);
+    this->set_budget(UpdateMode::GLR16, 50);
+    this->set_budget(UpdateMode::GLD16, 50);
+}
+
+
+/**
+ * @brief Setup the tile grid for a display size, and forget all scores
+ * @param width Display width in pixels
+ * @param height Display height in pixels
+ */
+void GhostingTracker::init(uint16_t const width, uint16_t const height)
+{
+    this->width = width;
+    this->height = height;
+
+    this->tile_shift = MIN_TILE_SHIFT;
+    while ((((width + (1u << this->tile_shift) - 1) >> this->tile_shift) > MAX_COLUMNS) ||
+           (((height + (1u << this->tile_shift) - 1) >> this->tile_shift) > MAX_ROWS))
+    {
+        this->tile_shift++;
+    }
+
+    this->columns = (width + (1u << this->tile_shift) - 1) >> this->tile_shift;
+    this->rows = (height + (1u << this->tile_shift) - 1) >> this->tile_shift;
+
+    memset(this->scores, 0, sizeof(this->scores));
+}
+
+
+/**
+ * @brief Set how many refreshes in a mode a tile can take before it needs cleaning
+ * @param mode Update mode
+ * @param refreshes Number of refreshes. 0 ignores the refreshes in this mode.
+ */
+void GhostingTracker::set_budget(UpdateMode const mode, uint16_t const refreshes)
+{
+    if (mode >= UpdateMode::None)
+    {
+        return;
+    }
+
+    this->costs[static_cast<size_t>(mode)] = refreshes ? ((THRESHOLD + refreshes - 1) / refreshes) : 0;
+}
+
+
+/**
+ * @brief Account a refresh of the display
+ * @param area Refreshed area
+ * @param mode Update mode of the refresh
+ */
+void GhostingTracker::record(Area const &area, UpdateMode const mode)
+{
+    if ((mode >= UpdateMode::None) || (area.w == 0) || (area.h == 0) || (this->columns == 0))
+    {
+        return;
+    }
+
+    uint16_t const x_end = std::min<uint32_t>(area.x + area.w, this->width);
+    uint16_t const y_end = std::min<uint32_t>(area.y + area.h, this->height);
+    if ((area.x >= x_end) || (area.y >= y_end))
+    {
+        return;
+    }
+
+    uint16_t const first_column = area.x >> this->tile_shift;
+    uint16_t const last_column = (x_end - 1) >> this->tile_shift;
+    uint16_t const first_row = area.y >> this->tile_shift;
+    uint16_t const last_row = (y_end - 1) >> this->tile_shift;
+
+    if ((mode == UpdateMode::GC16) || (mode == UpdateMode::Init))
+    {
+        // Only the tiles fully covered are clean now. Tiles at the display edge are smaller.
+        uint16_t const tile = 1u << this->tile_shift;
+        for (uint16_t row = first_row; row <= last_row; row++)
+        {
+            uint16_t const tile_y = row << this->tile_shift;
+            if ((tile_y < area.y) || (std::min<uint32_t>(tile_y + tile, this->height) > y_end))
+            {
+                continue;
+            }
+            for (uint16_t column = first_column; column <= last_column; column++)
+            {
+                uint16_t const tile_x = column << this->tile_shift;
+                if ((tile_x >= area.x) && (std::min<uint32_t>(tile_x + tile, this->width) <= x_end))
+                {
+                    this->scores[row][column] = 0;
+                }
+            }
+        }
+        return;
+    }
+
+    uint16_t const cost = this->costs[static_cast<size_t>(mode)];
+    if (cost == 0)
+    {
+        return;
+    }
+
+    for (uint16_t row = first_row; row <= last_row; row++)
+    {
+        for (uint16_t column = first_column; column <= last_column; column++)
+        {
+            this->scores[row][column] = std::min<uint32_t>(this->scores[row][column] + cost, UINT16_MAX);
+        }
+    }
+}
+
+
+/**
+ * @brief Mark the tiles over budget in a dirty tracker, in scan order, up to a total area
+ *
+ * The tiles are not reset: this happens when their GC16 refresh is recorded.
+ *
+ * @param tiles Tracker the tiles to clean are marked in
+ * @param max_pixels Maximum number of pixels to mark, 0 for no limit. At least one tile is always marked.
+ *
+ * @return true if tiles over budget were left out because of the limit
+ */
+bool GhostingTracker::select(DirtyTracker &tiles, uint32_t const max_pixels) const
+{
+    uint32_t pixels = 0;
+
+    for (uint16_t row = 0; row < this->rows; row++)
+    {
+        for (uint16_t column = 0; column < this->columns; column++)
+        {
+            if (this->scores[row][column] < THRESHOLD)
+            {
+                continue;
+            }
+
+            uint16_t const x = column << this->tile_shift;
+            uint16_t const y = row << this->tile_shift;
+            uint16_t const w = std::min<uint32_t>(1u << this->tile_shift, this->width - x);
+            uint16_t const h = std::min<uint32_t>(1u << this->tile_shift, this->height - y);
+
+            if (max_pixels && pixels && (pixels + static_cast<uint32_t>(w) * h > max_pixels))
+            {
+                return true;
+            }
+
+            tiles.mark(x, y, w, h);
+            pixels += static_cast<uint32_t>(w) * h;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief Count the tiles that need cleaning
+ */
+uint16_t GhostingTracker::get_tiles_over_budget() const
+{
+    uint16_t count = 0;
+    for (uint16_t row = 0; row < this->rows; row++)
+    {
+        for (uint16_t column = 0; column < this->columns; column++)
+        {
+            count += (this->scores[row][column] >= THRESHOLD) ? 1 : 0;
+        }
+    }
+    return count;
+}
+
+} // namespace it8951e
+} // namespace esphome
@@ -0,0 +1,59 @@
+#pragma once
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/**
+ * @file it8951e_ghosting.h
+ * @brief Per-tile accounting of the ghosting left by the fast update modes of the IT8951 driver.
+ */
+
+#include "it8951e_dirty.h"
+#include "it8951e_priv.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace esphome {
+namespace it8951e {
+
+/**
+ * @brief Ghosting score of each display tile
+ *
+ * Every refresh adds the cost of its update mode to the tiles it touches. The cost of a mode is set from its
+ * budget: the number of refreshes in that mode a tile can take before it needs cleaning. A GC16 or Init refresh
+ * resets the tiles it fully covers.
+ */
+class GhostingTracker
+{
+    public:
+        static constexpr uint16_t MAX_COLUMNS = 32;
+        static constexpr uint16_t MAX_ROWS = 32;
+
+        GhostingTracker();
+
+        void init(uint16_t const width, uint16_t const height);
+
+        void set_budget(UpdateMode const mode, uint16_t const refreshes);
+
+        void record(Area const &area, UpdateMode const mode);
+
+        bool select(DirtyTracker &tiles, uint32_t const max_pixels) const;
+
+        uint16_t get_tile_size() const { return 1u << this->tile_shift; }
+        uint16_t get_tiles_over_budget() const;
+
+    private:
+        // Score at which a tile needs cleaning
+        static constexpr uint16_t THRESHOLD = 10000;
+
+        uint16_t scores[MAX_ROWS][MAX_COLUMNS] = {};
+        uint16_t costs[static_cast<size_t>(UpdateMode::None)] = {};
+
+        uint16_t width = 0;
+        uint16_t height = 0;
+        uint16_t columns = 0;
+        uint16_t rows = 0;
+        uint8_t tile_shift = 6;
+};
+
+} // namespace it8951e
+} // namespace esphome
@@ -0,0 +1,590 @@
+#pragma once
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/**
+ * @file it8951e_impl.h
+ * @brief Private implementation of the IT8951E display, shared by the translation units of the driver.
+ *
+ * it8951e.cpp holds the frame buffer, the image data transfers and the refresh scheduling, it8951e_bus.cpp the
+ * SPI protocol, bus rate tuning and reads, it8951e_pages.cpp the controller memory layout and the page slots, and
+ * it8951e_power.cpp the power saving and the warm boot.
+ */
+
+#include "esphome/core/log.h"
+#include "it8951e.h"
+#include "it8951e_priv.h"
+#include "it8951e_dirty.h"
+#include "it8951e_convert.h"
+#include "it8951e_flush.h"
+#include "it8951e_ghosting.h"
+#include "it8951e_levels.h"
+#include "it8951e_refresh.h"
+#include "it8951e_stats.h"
+#include "it8951e_telemetry.h"
+#include "esphome/core/gpio.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/preferences.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+
+namespace esphome {
+namespace it8951e {
+
+static const char *const TAG = "it8951e.display";
+
+static constexpr uint16_t PREAMBLE_COMMAND = 0x6000;
+static constexpr uint16_t PREAMBLE_WRITE_DATA = 0x0000;
+static constexpr uint16_t PREAMBLE_READ_DATA = 0x1000;
+
+// Longest sleep between two HRDY polls, in us
+static constexpr uint32_t HRDY_MAX_BACKOFF_US = 1000;
+
+// Size of the device info returned by I80_CMD_GET_DEV_INFO
+static constexpr size_t DEVICE_INFO_SIZE = 40;
+
+// Layout of the controller memory, in frames of width * height bytes (8bpp) from the image buffer
+static constexpr uint32_t FRAME_IMAGE = 0;    // Image buffer
+static constexpr uint32_t FRAME_SCRATCH = 1;  // 1bpp image data of the packed transfers
+static constexpr uint32_t FRAME_BACK = 2;     // Back buffer of double buffering
+static constexpr uint32_t FRAME_PAGES = 3;    // Preloaded pages, one frame per slot
+
+
+#if defined(IT8951E_ENABLE_DEBUG_LOGGING) && (IT8951E_ENABLE_DEBUG_LOGGING==1)
+#define IT8951E_LOGD ESP_LOGD
+#else
+#define IT8951E_LOGD(...)
+#endif
+
+
+class CommandSequence;
+
+
+/**
+ * @brief Write-through copy of the controller registers programmed by the driver
+ *
+ * Only registers that the controller itself never modifies are shadowed. A write of the value the register
+ * already holds can then be skipped.
+ */
+class RegisterShadow
+{
+    public:
+        /**
+         * @brief Check a register write against the shadow, and update the shadow
+         * @param address Register address
+         * @param value Value to be written
+         * @return true if the write must be sent to the controller, false if the register already holds the value
+         */
+        bool update(Register const address, uint16_t const value)
+        {
+            for (auto &entry : this->entries)
+            {
+                if (entry.address == address)
+                {
+                    return update_entry(entry, value);
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Check a VCOM write against the shadow, and update the shadow
+         * @param value VCOM value, in mV
+         * @return true if the VCOM command must be sent to the controller
+         */
+        bool update_vcom(uint16_t const value) { return update_entry(this->vcom, value); }
+
+        /**
+         * @brief Forget all shadowed values, e.g. after the controller has been reset
+         */
+        void invalidate()
+        {
+            for (auto &entry : this->entries)
+            {
+                entry.valid = false;
+            }
+            this->vcom.valid = false;
+        }
+
+    private:
+        struct Entry {
+            Register address;
+            uint16_t value;
+            bool valid;
+        };
+
+        static bool update_entry(Entry &entry, uint16_t const value)
+        {
+            if (entry.valid && (entry.value == value))
+            {
+                return false;
+            }
+            entry.value = value;
+            entry.valid = true;
+            return true;
+        }
+
+        Entry entries[3] = {
+            {Register::I80PCR, 0, false},
+            {Register::LISAR, 0, false},
+            {Register::LISARH, 0, false},
+        };
+
+        Entry vcom = {Register::SYS_REG_BASE, 0, false};
+};
+
+
+class IT8951EDisplay::Impl
+{
+  public:
+    Impl(IT8951EDisplay *parent) : parent(parent) {}
+
+    void setup();
+    void clear(bool const init) const;
+    void write_buffer_to_display(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h, UpdateMode const mode,
+                                 uint16_t const levels = 0) const;
+    void notify_update(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h);
+    size_t get_transfer_buffer_size() const { return this->transfer_buffer ? this->transfer_buffer_size : 0; }
+    bool has_frame_diff() const { return this->sent_buffer != nullptr; }
+
+    size_t get_buffer_size() const;
+    void init_buffer(size_t buffer_size);
+    void put_pixel(int const x, int const y, Color const color);
+    void fill_rect(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h, Color const color);
+    bool draw_pixels(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h, uint8_t const * const ptr,
+                     display::ColorOrder const order, display::ColorBitness const bitness, bool const big_endian,
+                     uint16_t const x_offset, uint16_t const y_offset, uint16_t const x_pad);
+    void record_generic_draw(uint32_t const pixels, uint32_t const duration) const;
+    void stream_pixels(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h, uint8_t const *source,
+                       size_t const source_stride);
+    void do_update();
+    void request_clear();
+    void poll();
+    bool can_submit() const;
+    void start_flush_task();
+    bool has_flush_task() const { return this->flush_task.is_running(); }
+    size_t get_flush_stack_free() const { return this->flush_task.get_stack_free(); }
+    bool is_banded() const { return this->buffer_rows < this->height; }
+    uint16_t get_buffer_rows() const { return this->buffer_rows; }
+    void render_bands(display::DisplayPage * const page, uint32_t const address);
+    void request_preload(uint8_t const slot, display::DisplayPage * const page);
+    void request_show(uint8_t const slot, UpdateMode const mode);
+    bool read_area(Area const &area, uint8_t * const levels) const;
+    bool screenshot(std::function<void(uint16_t, uint8_t const *, uint16_t)> const &callback) const;
+
+    char lut_version[17] = {0};
+    char fw_version[17] = {0};
+
+    // Frame buffer size. With hardware rotation, in logical (rotated) orientation.
+    uint16_t width = 960;
+    uint16_t height = 540;
+
+    // Panel size, as reported by the controller
+    uint16_t panel_width = 960;
+    uint16_t panel_height = 540;
+
+    // Rotation applied by the controller when loading image data. The frame buffer is then in logical orientation.
+    bool hardware_rotation = false;
+    display::DisplayRotation rotation = display::DISPLAY_ROTATION_0_DEGREES;
+
+    bool reversed = false;
+    uint32_t frame_diff_budget = 0;
+    size_t transfer_buffer_size = 4092;
+    uint8_t flush_queue_depth = 0;
+    int8_t flush_task_core = 0;
+    UpdateMode update_mode = UpdateMode::Auto;
+    uint32_t idle_time = 20000;
+    uint32_t max_clean_area = 0;
+    bool packed_transfers = false;
+    bool double_buffering = false;
+    uint16_t band_rows = 0;
+
+    static constexpr uint8_t MAX_PAGE_SLOTS = 8;
+    uint8_t page_slots = 0;
+
+    // Size of the controller memory, from address 0: the 64 Mbit SDRAM of the IT8951 by default. The frames must fit
+    // between the image buffer and its end.
+    static constexpr uint32_t DEFAULT_CONTROLLER_MEMORY = 8 * 1024 * 1024;
+    uint32_t controller_memory = DEFAULT_CONTROLLER_MEMORY;
+
+    // Put the controller in standby or sleep after this idle time, in ms. 0 keeps it running.
+    uint32_t power_idle_time = 0;
+    Command power_command = Command::TCON_SLEEP;
+
+    // Skip the device info and the initial Init refresh when waking from deep sleep with a complete panel image
+    bool warm_boot = false;
+    bool is_warm_booted() const { return this->warm_booted; }
+    bool restore_warm_boot();
+    void keep_panel();
+    void shutdown();
+
+    // SPI clock rates, in Hz. When they differ, the bus only runs at the write rate while image data is written.
+    bool spi_auto_tune = false;
+    uint32_t max_write_rate = 40000000;
+    uint32_t max_read_rate = 20000000;
+    uint32_t write_rate = spi_data_rate;
+    uint32_t read_rate = spi_data_rate;
+    char const *rate_source = "fixed";
+
+    static constexpr size_t MAX_MODE_REGIONS = 8;
+    bool add_mode_region(int const x, int const y, int const w, int const h, UpdateMode const mode);
+    void clear_mode_regions() { this->mode_region_count = 0; }
+    void map_mode_regions(display::DisplayRotation const rotation);
+
+    GPIOPin *reset_pin = nullptr;
+    GPIOPin *ready_pin = nullptr;
+    GPIOPin *cs_pin = nullptr;
+
+    Statistics get_statistics() const;
+    LatencyTelemetry const &get_telemetry() const { return this->telemetry; }
+
+    sensor::Sensor *latency_p50_sensor = nullptr;
+    sensor::Sensor *latency_p99_sensor = nullptr;
+
+    void set_ghosting_budget(UpdateMode const mode, uint16_t const refreshes);
+    uint16_t get_ghosting_tile_size() const { return this->ghosting.get_tile_size(); }
+    uint16_t get_tiles_over_budget() const;
+
+  private:
+    IT8951EDisplay *parent;
+
+    // Counters of the task driving the bus: the flush task once started, the main loop before. The flush task hands
+    // a copy over to the main loop through published_stats, guarded by stats_lock.
+    mutable Statistics stats;
+    Statistics published_stats;
+    Statistics task_stats;
+    Mutex stats_lock;
+
+    // Counters of the main loop: drawing and completed jobs
+    mutable Statistics loop_stats;
+
+    mutable RegisterShadow shadow;
+
+    // Rate the SPI device is currently set up with
+    mutable uint32_t bus_rate = spi_data_rate;
+
+    /**
+     * @brief SPI clock rates kept in the preferences, so the auto-tuning only probes on the first boot
+     */
+    struct BusRates {
+        uint32_t write_rate;
+        uint32_t read_rate;
+    };
+    ESPPreferenceObject rate_preference;
+
+    bool warm_booted = false;
+
+    // Controller in standby or sleep: woken by the next command. Set and cleared by the task driving the bus.
+    mutable std::atomic<bool> asleep{false};
+
+    // Main loop: time of the last submitted job, and power saving job submitted since
+    uint32_t last_activity = 0;
+    bool sleep_requested = false;
+
+    // Set by the Sync job: no refresh was in progress when it ended
+    bool panel_idle = false;
+
+    // Rates HRDY timed out at since the last check, by the task driving the bus. It then reports them through
+    // bus_errors, and the main loop lowers the rates.
+    static constexpr uint8_t RATE_WRITE = 1u << 0;
+    static constexpr uint8_t RATE_READ = 1u << 1;
+    mutable uint8_t timeout_rates = 0;
+    std::atomic<uint8_t> bus_errors{0};
+    uint8_t bus_error_reports = 0;
+
+    // Device info read at the default rate when tuning, to verify the rates against. Not read on a warm boot.
+    uint8_t bus_reference[DEVICE_INFO_SIZE] = {};
+    bool has_bus_reference = false;
+    mutable RefreshScheduler scheduler;
+
+    // Refresh timings. Recorded in the main loop; the flush task hands its samples over through the queue.
+    mutable LatencyTelemetry telemetry;
+    mutable SpscQueue<RefreshSample> refresh_samples;
+    uint32_t published_samples = 0;
+
+    mutable uint32_t next_busy_poll = 0;
+    mutable uint32_t last_transfer_us = 0;
+
+    DirtyTracker dirty;
+    PixelConverter converter;
+
+    // Frame buffer, or the strip of rows of the current band in band rendering mode
+    uint8_t *buffer = nullptr;
+    uint16_t buffer_rows = 0;
+
+    // Copy of the frame buffer read by the flush task, so the main loop can draw while a job runs. The areas of each
+    // job are copied when it is submitted, all of the frame buffer if the copy is not valid. Pages are rendered into
+    // it before being preloaded, with or without flush task.
+    uint8_t *snapshot = nullptr;
+    bool snapshot_valid = false;
+
+    // Rows of the display the buffer currently holds. Outside of band rendering, a banded buffer holds none.
+    uint16_t band_y = 0;
+    uint16_t band_height = 0;
+
+    // Gray levels of the image data loaded band by band since the last update
+    uint16_t frame_levels = 0;
+
+    // Copy of the image data last transferred to the controller, for frame diff mode
+    uint8_t *sent_buffer = nullptr;
+
+    // Internal, DMA capable, RAM used to gather image data from the PSRAM frame buffer into large SPI transfers
+    uint8_t *transfer_buffer = nullptr;
+
+    uint32_t last_update_time = 0;
+    bool schedule_clean = false;
+
+    enum class FlushJobType : uint8_t
+    {
+        Update,
+        Clean,
+        Clear,
+        Preload,
+        Show,
+        Sync,
+        Sleep,
+    };
+
+    struct FlushJob {
+        FlushJobType type;
+        uint8_t count;
+        Area areas[DirtyTracker::MAX_AREAS];
+        bool reload = false;                   // Update: transfer the areas even if frame diff finds them unchanged
+        uint8_t slot = 0;                      // Preload, Show: page slot
+        UpdateMode mode = UpdateMode::GC16;    // Show: update mode of the refresh
+    };
+
+    struct FlushCompletion {
+        FlushJobType type;
+        uint32_t duration;
+        bool more;  // Clean job: tiles are left to clean in the next idle window
+    };
+
+    // Background transfer of the updates. The snapshot is read by the flush task while buffer_busy is set.
+    FlushTask flush_task;
+    SpscQueue<FlushJob> flush_jobs;
+    SpscQueue<FlushCompletion> flush_completions;
+    std::atomic<bool> buffer_busy{false};
+    bool clear_pending = false;
+
+    // Held by the flush task while it drives the bus, and by the main loop to read back the controller memory
+    mutable Mutex bus_lock;
+
+    // Page slot requests postponed while the flush task used the frame buffer, -1 if none
+    int16_t preload_pending = -1;
+    display::DisplayPage *preload_pending_page = nullptr;
+    int16_t show_pending = -1;
+    UpdateMode show_pending_mode = UpdateMode::GC16;
+
+    // After showing a page, the image buffer and the frame diff copy no longer match the EPD
+    bool reload_pending = false;
+
+    // Ghosting scores of the display tiles. Owned by the task driving the bus: the flush task once started, the
+    // main loop before. The flush task hands the number of tiles over budget over with its statistics.
+    mutable GhostingTracker ghosting;
+    uint16_t published_tiles_over_budget = 0;
+    uint16_t tiles_over_budget = 0;
+
+    // Tiles selected for cleaning, merged into areas. Only used by the flush task.
+    DirtyTracker cleaning;
+
+    // Areas last loaded in 1bpp into the scratch buffer, or into the back buffer: the image buffer of the controller
+    // still holds older data there. Only used by the flush task.
+    mutable DirtyTracker stale;
+
+    // 1bpp display mode state, and the UP1SR2 bits not owned by the driver, read by configure()
+    mutable bool one_bpp_display = false;
+    mutable uint16_t color_table = 0;
+    mutable uint16_t up1sr2 = 0;
+
+    /**
+     * @brief Display region refreshed with a fixed update mode
+     */
+    struct ModeRegion {
+        int x, y, w, h;  // Logical (rotated) coordinates, as configured
+        Area area;       // Frame buffer coordinates
+        UpdateMode mode;
+    };
+
+    ModeRegion mode_regions[MAX_MODE_REGIONS];
+    size_t mode_region_count = 0;
+
+    uint16_t image_buffer_address_high = 0x0012;
+    uint16_t image_buffer_address_low = 0x36e0;
+
+    Rotation get_load_rotation() const;
+
+    uint32_t get_image_address() const { return (static_cast<uint32_t>(this->image_buffer_address_high) << 16) | this->image_buffer_address_low; }
+
+    uint32_t get_frame_address(uint32_t const frame) const
+    {
+        return this->get_image_address() + frame * this->width * this->height;
+    }
+
+    void reset();
+    void check_memory_layout();
+    bool allocate_snapshot();
+    void keep_alive(uint32_t const sleep_ms = 0) const;
+
+    // Image data read by the jobs: the snapshot with a flush task, the frame buffer otherwise
+    uint8_t *get_source() const { return this->flush_task.is_running() ? this->snapshot : this->buffer; }
+    void copy_to_snapshot(FlushJob const &job);
+
+    void submit(FlushJob const &job);
+    bool run_job(FlushJob const &job);
+    void complete(FlushCompletion const &completion);
+    static uint32_t drain_jobs(void *arg);
+
+    bool wait_comms_ready(uint32_t const timeout = 3000) const;
+    bool wait_display_ready(uint32_t const timeout = 3000) const;
+    bool wait_area_ready(Area const &area, uint32_t const timeout = 3000) const;
+    uint32_t wait_load_ready(Area const &area, uint32_t const timeout = 3000) const;
+    uint16_t poll_busy_luts() const;
+    uint32_t service_refreshes() const;
+    void record_sample(RefreshSample const &sample) const;
+    void publish_latency();
+
+    bool send_command(Command const command) const;
+    void send_command_with_args(Command const cmd, uint16_t const * const args, uint16_t const length) const;
+    void send_sequence(CommandSequence const &sequence) const;
+    bool write_frame(uint16_t const preamble, uint8_t const * const data, size_t const length) const;
+    void write_word(uint16_t const data) const;
+    void bus_write16(uint16_t const data) const;
+    void bus_write(uint8_t const * const data, size_t const length) const;
+    void bus_transfer(uint8_t * const data, size_t const length) const;
+    uint16_t read_word() const;
+    void read_bytes(void * const buf, uint16_t const length) const;
+    bool start_read() const;
+    bool read_memory(uint32_t const address, uint8_t * const dest, size_t const length) const;
+    void update_device_info();
+    void read_device_info(uint8_t * const info) const;
+    void set_bus_rate(uint32_t const rate) const;
+    // Rate of the reads, and of the commands following them: the read rate, unless the write rate is lower
+    uint32_t get_read_rate() const { return std::min(this->read_rate, this->write_rate); }
+    bool verify_bus(uint8_t const * const reference) const;
+    void tune_bus();
+    void check_bus_errors();
+    void lower_bus_rates(uint8_t const rates);
+    void configure() const;
+    void enter_power_saving() const;
+    void wake() const;
+
+    uint16_t read_register(Register const address) const;
+    void write_register(Register const address, uint16_t const data) const;
+    void queue_register_write(CommandSequence &sequence, Register const address, uint16_t const data) const;
+    void set_vcom(uint16_t const vcom) const;
+    void set_area(CommandSequence &sequence, uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h,
+                  PixelMode const pixel_mode = PixelMode::BPP_4) const;
+    void update_area(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h, UpdateMode const mode,
+                     uint32_t const address = 0, bool const one_bpp = false, uint16_t const color_table = 0) const;
+    void set_display_depth(bool const one_bpp, uint16_t const color_table) const;
+    bool depth_switch_blocks(bool const one_bpp, uint16_t const color_table) const;
+    void set_target_memory_addr(CommandSequence &sequence, uint16_t const address_high, uint16_t const address_low) const;
+    bool clip_to_changes(Area &area) const;
+    void write_area(Area const &area, size_t const first_region) const;
+    uint16_t get_levels(Area const &area) const;
+    uint8_t select_packing(Area const &area, uint16_t const levels, bool const allow_one_bpp = true) const;
+    void fill_area(Area const &area, uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h,
+                   UpdateMode const mode, uint8_t const level) const;
+    void load_area(Area const &area, uint8_t const * const source, uint8_t const bits, uint8_t const foreground,
+                   uint32_t const frame = FRAME_IMAGE) const;
+    void restore_stale_areas() const;
+    void load_strip(Area const &area, uint8_t const * const source, uint32_t const address) const;
+    void stream_rows(uint8_t const * const source, size_t offset, size_t row_bytes, uint16_t rows) const;
+    void stream_packed(uint8_t const * const source, Area const &area, uint8_t const bits, uint8_t const foreground) const;
+    uint8_t gray_level(Color const color) const;
+
+};
+
+
+/**
+ * @brief Guard class to allow the CS pin to be automatically deactivated
+ */
+class SelectDevice
+{
+    public:
+        SelectDevice(GPIOPin *pin, uint32_t &toggles) : cs_pin(pin) { this->cs_pin->digital_write(false); toggles++; }
+        ~SelectDevice() { this->cs_pin->digital_write(true); }
+
+    private:
+        GPIOPin *cs_pin;
+};
+
+
+/**
+ * @brief Sequence of commands, with their arguments, to be sent to the display in one go
+ *
+ * Arguments are stored already serialized (big endian), so each command costs exactly two CS-framed
+ * transactions when sent: the command preamble and code, then the argument preamble and all arguments
+ * as a single burst.
+ */
+class CommandSequence
+{
+    public:
+        static constexpr size_t MAX_COMMANDS = 8;
+        static constexpr size_t MAX_ARGS = 32;
+
+        /**
+         * @brief Append a command and its arguments to the sequence
+         * @param cmd Command to append
+         * @param args Command arguments
+         * @param length Number of arguments
+         * @return false if the sequence is full
+         */
+        bool add(Command const cmd, uint16_t const * const args = nullptr, size_t const length = 0)
+        {
+            if ((this->count >= MAX_COMMANDS) || (this->args_used + length > MAX_ARGS))
+            {
+                ESP_LOGE(TAG, "Command sequence full, dropping command 0x%04x", static_cast<uint16_t>(cmd));
+                return false;
+            }
+
+            Entry &entry = this->entries[this->count++];
+            entry.command = cmd;
+            entry.offset = this->args_used * 2;
+            entry.length = length * 2;
+
+            for (size_t i = 0; i < length; i++)
+            {
+                this->args[this->args_used * 2] = args[i] >> 8;
+                this->args[this->args_used * 2 + 1] = args[i] & 0xFF;
+                this->args_used++;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Append a register write to the sequence
+         * @param address Register address
+         * @param data Value to write
+         * @return false if the sequence is full
+         */
+        bool write_register(Register const address, uint16_t const data)
+        {
+            uint16_t const args[2] = {static_cast<uint16_t>(address), data};
+            return this->add(Command::TCON_REG_WR, args, 2);
+        }
+
+        size_t size() const { return this->count; }
+        Command command(size_t const index) const { return this->entries[index].command; }
+        uint8_t const *arguments(size_t const index) const { return this->args + this->entries[index].offset; }
+        size_t arguments_length(size_t const index) const { return this->entries[index].length; }
+
+    private:
+        struct Entry {
+            Command command;
+            uint16_t offset;
+            uint16_t length;
+        };
+
+        Entry entries[MAX_COMMANDS];
+        uint8_t args[MAX_ARGS * 2];
+        size_t count = 0;
+        size_t args_used = 0;
+};
+
+
+} // namespace it8951e
+} // namespace esphome
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "it8951e_levels.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace it8951e {
+
+/**
+ * @brief Get the gray levels present in an area of 4bpp image data
+ *
+ * The scan stops early once the content can neither use a fast update mode nor be packed.
+ *
+ * @param buffer Image data
+ * @param stride Bytes per row of the image data
+ * @param area Area to check
+ * @return Gray levels, bit n for level n
+ */
+uint16_t scan_levels(uint8_t const * const buffer, size_t const stride, Area const &area)
+{
+    size_t const begin = area.x >> 1;
+    size_t const end = std::min<size_t>((area.x + area.w + 1) >> 1, stride);
+
+    uint16_t levels = 0;
+    for (uint16_t row = area.y; row < area.y + area.h; row++)
+    {
+        uint8_t const * const line = buffer + row * stride;
+        for (size_t i = begin; i < end; i++)
+        {
+            levels |= (1u << (line[i] >> 4)) | (1u << (line[i] & 0x0F));
+        }
+
+        if ((levels & ~LEVELS_DU4) && (__builtin_popcount(levels) > 2))
+        {
+            break;
+        }
+    }
+
+    return levels;
+}
+
+
+/**
+ * @brief Pick the fastest update mode that renders all gray levels present in an area
+ *
+ * Black and white only content uses DU rather than the faster DU4, for its full contrast. The level sets are
+ * symmetric, so the reversed flag does not matter.
+ *
+ * @param levels Gray levels of the area, bit n for level n
+ * @return DU, DU4 or GLR16
+ */
+UpdateMode select_update_mode(uint16_t const levels)
+{
+    if (levels & ~LEVELS_DU4)
+    {
+        return UpdateMode::GLR16;
+    }
+    return (levels & ~LEVELS_DU) ? UpdateMode::DU4 : UpdateMode::DU;
+}
+
+
+/**
+ * @brief Pick the smallest pixel format an area can be transferred in
+ *
+ * Content of at most two gray levels is sent in 1bpp, mapped back to the levels by the BGVR color table. Content
+ * of the DU4 levels is sent in 2bpp. The area must be aligned to the granularity of the format, and a packed row
+ * must fit the transfer buffer.
+ *
+ * Solid content needs no image data at all, even without packed transfers: both entries of the color table are
+ * set to its level, and the area is refreshed in 1bpp from whatever the scratch buffer holds.
+ *
+ * @param area Area to transfer, aligned to 4 pixels
+ * @param levels Gray levels of the area, 0 if unknown
+ * @param allow_one_bpp false to rule out the solid fill and 1bpp, which refresh in the 1bpp display mode
+ * @param packed_row_bytes Largest packed row, in bytes: the transfer buffer size. 0 without packed transfers.
+ * @return Bits per pixel: 0 (solid fill), 1, 2 or 4
+ */
+uint8_t select_packing(Area const &area, uint16_t const levels, bool const allow_one_bpp, size_t const packed_row_bytes)
+{
+    if (levels == 0)
+    {
+        return 4;
+    }
+
+    bool const one_bpp_area = allow_one_bpp && ((area.x % ALIGN_1BPP) == 0) && ((area.w % ALIGN_1BPP) == 0);
+    if (one_bpp_area && (__builtin_popcount(levels) == 1))
+    {
+        return 0;
+    }
+
+    if (packed_row_bytes == 0)
+    {
+        return 4;
+    }
+
+    if (one_bpp_area && (__builtin_popcount(levels) <= 2) && (area.w / 8u <= packed_row_bytes))
+    {
+        return 1;
+    }
+
+    if (((levels & ~LEVELS_DU4) == 0) && ((area.x % ALIGN_2BPP) == 0) && ((area.w % ALIGN_2BPP) == 0) &&
+        (area.w / 4u <= packed_row_bytes))
+    {
+        return 2;
+    }
+
+    return 4;
+}
+
+} // namespace it8951e
+} // namespace esphome
@@ -0,0 +1,31 @@
+#pragma once
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/**
+ * @file it8951e_levels.h
+ * @brief Gray level analysis of the image data: update mode and pixel format selection of the IT8951 driver.
+ */
+
+#include "it8951e_dirty.h"
+#include "it8951e_priv.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace esphome {
+namespace it8951e {
+
+// Sets of gray levels (bit n for level n) the fast update modes can render
+static constexpr uint16_t LEVELS_DU = (1u << 0) | (1u << 15);
+static constexpr uint16_t LEVELS_DU4 = (1u << 0) | (1u << 5) | (1u << 10) | (1u << 15);
+
+// X granularity, in pixels, of the packed transfers. 1bpp data is loaded as 8bpp data, 8 pixels per byte.
+static constexpr uint16_t ALIGN_1BPP = 32;
+static constexpr uint16_t ALIGN_2BPP = 8;
+
+uint16_t scan_levels(uint8_t const * const buffer, size_t const stride, Area const &area);
+UpdateMode select_update_mode(uint16_t const levels);
+uint8_t select_packing(Area const &area, uint16_t const levels, bool const allow_one_bpp, size_t const packed_row_bytes);
+
+} // namespace it8951e
+} // namespace esphome
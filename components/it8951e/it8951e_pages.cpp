@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "it8951e_impl.h"
+
+namespace esphome {
+namespace it8951e {
+
+/**
+ * @brief Check that the frames used by the configured features fit the controller memory
+ *
+ * The image buffer and the scratch buffer are always used. The back buffer and the page slots follow them. Double
+ * buffering is dropped if the back buffer does not fit, and the display is marked as failed if the page slots do not:
+ * the pages would be lost.
+ */
+void IT8951EDisplay::Impl::check_memory_layout()
+{
+    uint32_t const frame_size = static_cast<uint32_t>(this->width) * this->height;
+    uint32_t const image_address = this->get_image_address();
+    uint32_t const frames = (image_address < this->controller_memory) ? (this->controller_memory - image_address) / frame_size : 0;
+
+    if (frames <= FRAME_SCRATCH)
+    {
+        ESP_LOGE(TAG, "Controller memory too small for the scratch buffer (image buffer at 0x%06" PRIx32 ")", image_address);
+    }
+
+    if (this->double_buffering && (frames <= FRAME_BACK))
+    {
+        ESP_LOGE(TAG, "Controller memory too small for the back buffer, double buffering disabled");
+        this->double_buffering = false;
+    }
+
+    uint32_t const max_slots = (frames > FRAME_PAGES) ? (frames - FRAME_PAGES) : 0;
+    if (this->page_slots > max_slots)
+    {
+        ESP_LOGE(TAG, "Controller memory (%" PRIu32 " bytes) too small for %u page slots, %" PRIu32 " fit. Check page_slots and controller_memory",
+                 this->controller_memory, this->page_slots, max_slots);
+        this->parent->mark_failed();
+    }
+}
+
+
+/**
+ * @brief Render a page and load it into a page slot of the controller memory, without refreshing the EPD
+ *
+ * With a full frame buffer, the page is rendered into the snapshot: the frame buffer keeps the content of the
+ * display, for clients drawing incrementally (e.g. LVGL). In band rendering mode, the page is rendered band by band
+ * through the strip.
+ *
+ * @param slot Page slot
+ * @param page Page to render
+ */
+void IT8951EDisplay::Impl::request_preload(uint8_t const slot, display::DisplayPage * const page)
+{
+    if ((slot >= this->page_slots) || (page == nullptr) || (this->buffer == nullptr) ||
+        (!this->is_banded() && (this->snapshot == nullptr)))
+    {
+        ESP_LOGW(TAG, "Cannot preload page slot %u", slot);
+        return;
+    }
+
+    if (!this->can_submit())
+    {
+        this->preload_pending = slot;
+        this->preload_pending_page = page;
+        return;
+    }
+
+    // The page is not the content of the display: keep the dirty areas of the display
+    DirtyTracker const dirty = this->dirty;
+
+    if (this->is_banded())
+    {
+        uint16_t const levels = this->frame_levels;
+        this->render_bands(page, this->get_frame_address(FRAME_PAGES + slot));
+        this->frame_levels = levels;
+        this->last_transfer_us = 0;
+        this->dirty = dirty;
+        return;
+    }
+
+    // The drawing functions write the frame buffer: swap it with the snapshot while the page is rendered
+    std::swap(this->buffer, this->snapshot);
+    if (this->parent->auto_clear_enabled_)
+    {
+        this->parent->fill(display::COLOR_OFF);
+    }
+    page->get_writer()(*this->parent);
+    std::swap(this->buffer, this->snapshot);
+    this->dirty = dirty;
+
+    FlushJob job;
+    job.type = FlushJobType::Preload;
+    job.count = 0;
+    job.slot = slot;
+    this->submit(job);
+}
+
+
+/**
+ * @brief Refresh the whole EPD from a page slot, without transferring any image data
+ *
+ * The image buffer of the controller and the frame diff copy then no longer match the EPD: the next update
+ * transfers and refreshes all of the frame buffer, and cleaning waits for it.
+ *
+ * @param slot Page slot, preloaded before
+ * @param mode Update mode of the refresh. UpdateMode::Auto uses GC16.
+ */
+void IT8951EDisplay::Impl::request_show(uint8_t const slot, UpdateMode const mode)
+{
+    if (slot >= this->page_slots)
+    {
+        ESP_LOGW(TAG, "Cannot show page slot %u", slot);
+        return;
+    }
+
+    if (!this->can_submit())
+    {
+        this->show_pending = slot;
+        this->show_pending_mode = mode;
+        return;
+    }
+
+    this->dirty.mark(0, 0, this->width, this->height);
+    this->reload_pending = true;
+    this->schedule_clean = false;
+
+    FlushJob job;
+    job.type = FlushJobType::Show;
+    job.count = 0;
+    job.slot = slot;
+    job.mode = (mode == UpdateMode::Auto) ? UpdateMode::GC16 : mode;
+    this->submit(job);
+}
+
+} // namespace it8951e
+} // namespace esphome
@@ -0,0 +1,199 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "it8951e_impl.h"
+
+#ifdef USE_ESP32
+#include <esp_attr.h>
+#include <esp_system.h>
+#endif
+
+
+namespace esphome {
+namespace it8951e {
+
+// Marks a valid warm boot state: "IT51"
+static constexpr uint32_t WARM_BOOT_MAGIC = 0x49543531;
+
+// Longest wait for the flush task to finish its jobs at shutdown, in ms
+static constexpr uint32_t SHUTDOWN_TIMEOUT_MS = 5000;
+
+
+/**
+ * @brief Controller state kept across deep sleep, for the warm boot
+ */
+struct WarmBootState {
+    uint32_t magic;
+    uint16_t width;
+    uint16_t height;
+    uint16_t image_buffer_address_high;
+    uint16_t image_buffer_address_low;
+    uint32_t write_rate;
+    uint32_t read_rate;
+    char lut_version[17];
+    char fw_version[17];
+};
+
+
+#ifdef USE_ESP32
+static RTC_DATA_ATTR WarmBootState warm_boot_state;
+#else
+static WarmBootState warm_boot_state;
+#endif
+
+
+/**
+ * @brief Check if the device just woke from deep sleep
+ */
+static bool woke_from_deep_sleep()
+{
+#ifdef USE_ESP32
+    return esp_reset_reason() == ESP_RST_DEEPSLEEP;
+#else
+    return false;
+#endif
+}
+
+
+/**
+ * @brief Put the controller in standby or sleep, once the refreshes in progress are over
+ *
+ * The 1bpp display mode is turned off first, so the register shadow can be invalidated on wake whether or not
+ * the controller keeps its registers.
+ */
+void IT8951EDisplay::Impl::enter_power_saving() const
+{
+    if (this->asleep.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    this->wait_display_ready();
+    this->set_display_depth(false, 0);
+    IT8951E_LOGD(TAG, "Controller %s", (this->power_command == Command::TCON_SLEEP) ? "sleeping" : "in standby");
+    this->send_command(this->power_command);
+    this->asleep.store(true, std::memory_order_relaxed);
+    this->stats.sleeps++;
+}
+
+
+/**
+ * @brief Bring the controller back to run mode before a command, and account the latency this adds
+ */
+void IT8951EDisplay::Impl::wake() const
+{
+    this->asleep.store(false, std::memory_order_relaxed);
+    uint32_t const start_time = micros();
+
+    this->send_command(Command::TCON_SYS_RUN);
+    this->wait_comms_ready();
+    this->shadow.invalidate();
+    this->configure();
+
+    uint32_t const duration = micros() - start_time;
+    this->stats.wakes++;
+    this->stats.wake_us += duration;
+    this->stats.max_wake_us = std::max(this->stats.max_wake_us, duration);
+    IT8951E_LOGD(TAG, "Controller woken in %" PRIu32 " us", duration);
+}
+
+
+/**
+ * @brief Restore the device info and the SPI rates saved at the last shutdown, when waking from deep sleep
+ *
+ * The state is only valid if the shutdown waited for all refreshes to end. It is invalidated right away, so a
+ * crash before the next shutdown leads to a cold boot.
+ *
+ * @return true if the state was restored, and the panel still shows a complete image
+ */
+bool IT8951EDisplay::Impl::restore_warm_boot()
+{
+    bool const valid = woke_from_deep_sleep() && (warm_boot_state.magic == WARM_BOOT_MAGIC);
+    warm_boot_state.magic = 0;
+    if (!valid)
+    {
+        return false;
+    }
+
+    this->width = warm_boot_state.width;
+    this->height = warm_boot_state.height;
+    this->image_buffer_address_high = warm_boot_state.image_buffer_address_high;
+    this->image_buffer_address_low = warm_boot_state.image_buffer_address_low;
+    memcpy(this->lut_version, warm_boot_state.lut_version, sizeof(this->lut_version));
+    memcpy(this->fw_version, warm_boot_state.fw_version, sizeof(this->fw_version));
+
+    if (this->spi_auto_tune)
+    {
+        this->write_rate = warm_boot_state.write_rate;
+        this->read_rate = warm_boot_state.read_rate;
+        this->set_bus_rate(this->write_rate);
+        this->rate_source = "warm boot";
+    }
+
+    this->warm_booted = true;
+    return true;
+}
+
+
+/**
+ * @brief Start from the image the panel still shows, instead of clearing it
+ *
+ * The frame buffer starts blank without refreshing the EPD. The image buffer of the controller was lost with its
+ * power, so the first update transfers and refreshes the whole frame buffer.
+ */
+void IT8951EDisplay::Impl::keep_panel()
+{
+    this->clear(false);
+    this->dirty.mark(0, 0, this->width, this->height);
+    this->reload_pending = true;
+}
+
+
+/**
+ * @brief Wait for the jobs and refreshes in progress to end, then save the state used by the next warm boot
+ *
+ * The state is only saved if the panel image is complete, i.e. no refresh was interrupted.
+ */
+void IT8951EDisplay::Impl::shutdown()
+{
+    if (!this->warm_boot || this->parent->is_failed())
+    {
+        return;
+    }
+
+    uint32_t const start_time = millis();
+    while (!this->can_submit() && (millis() - start_time < SHUTDOWN_TIMEOUT_MS))
+    {
+        delay(1);
+    }
+
+    this->panel_idle = false;
+    FlushJob job;
+    job.type = FlushJobType::Sync;
+    job.count = 0;
+    this->submit(job);
+
+    while (this->flush_task.is_running() && this->buffer_busy.load(std::memory_order_acquire) &&
+           (millis() - start_time < SHUTDOWN_TIMEOUT_MS))
+    {
+        delay(1);
+    }
+
+    if (this->buffer_busy.load(std::memory_order_acquire) || !this->panel_idle)
+    {
+        ESP_LOGW(TAG, "Display still busy at shutdown, the next boot clears it");
+        return;
+    }
+
+    warm_boot_state.width = this->panel_width;
+    warm_boot_state.height = this->panel_height;
+    warm_boot_state.image_buffer_address_high = this->image_buffer_address_high;
+    warm_boot_state.image_buffer_address_low = this->image_buffer_address_low;
+    warm_boot_state.write_rate = this->write_rate;
+    warm_boot_state.read_rate = this->read_rate;
+    memcpy(warm_boot_state.lut_version, this->lut_version, sizeof(warm_boot_state.lut_version));
+    memcpy(warm_boot_state.fw_version, this->fw_version, sizeof(warm_boot_state.fw_version));
+    warm_boot_state.magic = WARM_BOOT_MAGIC;
+}
+
+} // namespace it8951e
+} // namespace esphome
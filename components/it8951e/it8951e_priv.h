@@ -125,7 +125,13 @@ enum class UpdateMode : uint16_t
     /**
      * @brief no update
      */
-    None  = 8
+    None  = 8,
+
+    /**
+     * @brief Driver only, never sent to the controller: use the fastest mode that can render the gray levels
+     * of the updated area (DU for black and white only, DU4 for the levels 0, 5, 10 and 15, GLR16 otherwise)
+     */
+    Auto  = 0xFF
 };
 
 /**
@@ -318,6 +324,11 @@ enum class Register : uint16_t
      */
     UP1SR           = DISPLAY_BASE + 0x138,
 
+    /**
+     * @brief Address of the high word of the Update Parameter1 Setting Register. Bit 2 enables the 1bpp display mode.
+     */
+    UP1SR2          = DISPLAY_BASE + 0x13A,
+
     /**
      * @brief Address of LUT0 Alpha blend and Fill rectangle Value Register.
      */
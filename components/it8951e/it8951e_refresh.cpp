@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "it8951e_refresh.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace it8951e {
+
+// Number of LUT engines reported in LUTAFSR
+static constexpr uint8_t LUT_ENGINES = 16;
+
+// Typical refresh duration of each update mode, in ms, from the waveform descriptions
+static constexpr uint16_t REFRESH_DURATION_MS[] = {
+    2000,  // Init
+    260,   // DU
+    450,   // GC16
+    450,   // GL16
+    450,   // GLR16
+    450,   // GLD16
+    120,   // DU4
+    290,   // A2
+};
+
+
+/**
+ * @brief Check if two areas overlap
+ */
+static bool intersects(Area const &a, Area const &b)
+{
+    return !(((a.x + a.w) <= b.x) || ((b.x + b.w) <= a.x) || ((a.y + a.h) <= b.y) || ((b.y + b.h) <= a.y));
+}
+
+
+/**
+ * @brief Forget the refreshes that are over, based on the busy LUT engines
+ * @param busy_luts Value of the LUTAFSR register, one bit per busy engine
+ * @param now Current time, in ms
+ * @param done Output: timing of the refreshes that are over. Room for MAX_IN_FLIGHT samples.
+ * @return Number of refreshes that are over
+ */
+size_t RefreshScheduler::update(uint16_t const busy_luts, uint32_t const now, RefreshSample * const done)
+{
+    size_t const busy = __builtin_popcount(busy_luts);
+    size_t finished = 0;
+
+    while (this->count > busy)
+    {
+        // Remove the refresh expected to end first
+        size_t first = 0;
+        for (size_t i = 1; i < this->count; i++)
+        {
+            if (static_cast<int32_t>(this->refreshes[i].end - this->refreshes[first].end) < 0)
+            {
+                first = i;
+            }
+        }
+
+        Refresh const &refresh = this->refreshes[first];
+        done[finished++] = RefreshSample{refresh.mode, refresh.transfer_us, now - refresh.start};
+        this->refreshes[first] = this->refreshes[--this->count];
+    }
+
+    return finished;
+}
+
+
+/**
+ * @brief Get the time until the first refresh in progress is expected to end
+ * @param now Current time, in ms
+ * @return Time in ms, 0 if a refresh is already overdue or none is in progress
+ */
+uint32_t RefreshScheduler::get_next_end(uint32_t const now) const
+{
+    int32_t next = INT32_MAX;
+    for (size_t i = 0; i < this->count; i++)
+    {
+        next = std::min(next, static_cast<int32_t>(this->refreshes[i].end - now));
+    }
+    return ((this->count == 0) || (next < 0)) ? 0 : next;
+}
+
+
+/**
+ * @brief Check if a new refresh of an area can start
+ * @param area Area to refresh, or to load new image data into
+ * @param busy_luts Value of the LUTAFSR register
+ * @return true if a LUT engine is free and the area does not overlap a refresh in progress
+ */
+bool RefreshScheduler::can_start(Area const &area, uint16_t const busy_luts) const
+{
+    if ((__builtin_popcount(busy_luts) >= LUT_ENGINES) || (this->count >= MAX_IN_FLIGHT))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < this->count; i++)
+    {
+        if (intersects(this->refreshes[i].area, area))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Check if new image data can be loaded into an area of a controller memory frame
+ * @param area Area to load
+ * @param address Controller memory address of the frame
+ * @return true if no refresh in progress displays an overlapping area from the same frame
+ */
+bool RefreshScheduler::can_load(Area const &area, uint32_t const address) const
+{
+    for (size_t i = 0; i < this->count; i++)
+    {
+        if ((this->refreshes[i].address == address) && intersects(this->refreshes[i].area, area))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Track a refresh that was just started
+ * @param area Refreshed area
+ * @param mode Update mode of the refresh
+ * @param now Current time, in ms
+ * @param transfer_us Time spent transferring the image data of the refresh, for the statistics
+ * @param address Controller memory address of the displayed image data
+ */
+void RefreshScheduler::start(Area const &area, UpdateMode const mode, uint32_t const now, uint32_t const transfer_us,
+                             uint32_t const address)
+{
+    if ((this->count >= MAX_IN_FLIGHT) || (mode >= UpdateMode::None))
+    {
+        return;
+    }
+
+    this->refreshes[this->count++] = Refresh{area, mode, now, now + REFRESH_DURATION_MS[static_cast<size_t>(mode)], transfer_us, address};
+}
+
+} // namespace it8951e
+} // namespace esphome
@@ -0,0 +1,65 @@
+#pragma once
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/**
+ * @file it8951e_refresh.h
+ * @brief Tracking of the display refreshes in progress on the LUT engines of the IT8951 controller.
+ */
+
+#include "it8951e_dirty.h"
+#include "it8951e_priv.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace esphome {
+namespace it8951e {
+
+/**
+ * @brief Timing of one display refresh
+ */
+struct RefreshSample {
+    UpdateMode mode;
+    uint32_t transfer_us;  // Transfer of the image data to the controller
+    uint32_t busy_ms;      // LUT engine busy, from the refresh command to the first status poll reporting it done
+};
+
+
+/**
+ * @brief Areas of the panel being refreshed
+ *
+ * Each refresh runs on one of the LUT engines of the controller, and refreshes of disjoint areas can run at the
+ * same time. The controller only reports which engines are busy (LUTAFSR), not which area each engine refreshes.
+ * When fewer engines are busy than refreshes are tracked, the refreshes expected to end first are assumed done.
+ */
+class RefreshScheduler
+{
+    public:
+        static constexpr size_t MAX_IN_FLIGHT = 16;
+
+        size_t update(uint16_t const busy_luts, uint32_t const now, RefreshSample * const done);
+        bool can_start(Area const &area, uint16_t const busy_luts) const;
+        bool can_load(Area const &area, uint32_t const address) const;
+        void start(Area const &area, UpdateMode const mode, uint32_t const now, uint32_t const transfer_us,
+                   uint32_t const address);
+        void clear() { this->count = 0; }
+
+        size_t get_in_flight() const { return this->count; }
+        uint32_t get_next_end(uint32_t const now) const;
+
+    private:
+        struct Refresh {
+            Area area;
+            UpdateMode mode;
+            uint32_t start;  // Start time, in ms
+            uint32_t end;    // Estimated end time, in ms
+            uint32_t transfer_us;
+            uint32_t address;  // Controller memory address of the image data being displayed
+        };
+
+        Refresh refreshes[MAX_IN_FLIGHT];
+        size_t count = 0;
+};
+
+} // namespace it8951e
+} // namespace esphome
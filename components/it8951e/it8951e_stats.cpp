@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "it8951e_stats.h"
+#include "it8951e_impl.h"
+
+namespace esphome {
+namespace it8951e {
+
+// Upper bounds (exclusive, in us) of the HRDY wait histogram buckets. The last bucket collects everything above.
+static constexpr uint32_t HRDY_HISTOGRAM_LIMITS[] = {1, 10, 100, 1000, 10000, 100000};
+static_assert(sizeof(HRDY_HISTOGRAM_LIMITS) / sizeof(HRDY_HISTOGRAM_LIMITS[0]) + 1 == Statistics::HRDY_HISTOGRAM_BUCKETS,
+              "HRDY histogram log messages expect 7 buckets");
+
+
+/**
+ * @brief Compute a transfer rate
+ * @param bytes Bytes transferred
+ * @param us Duration of the transfers, in us
+ * @return Rate in kB/s, 0 if nothing was transferred
+ */
+static uint32_t throughput_kbps(uint32_t const bytes, uint32_t const us)
+{
+    return us ? static_cast<uint32_t>(static_cast<uint64_t>(bytes) * 1000 / us) : 0;
+}
+
+
+/**
+ * @brief Account a HRDY wait
+ * @param duration Wait duration in us
+ */
+void Statistics::record_hrdy_wait(uint32_t const duration)
+{
+    size_t bucket = 0;
+    while ((bucket < HRDY_HISTOGRAM_BUCKETS - 1) && (duration >= HRDY_HISTOGRAM_LIMITS[bucket]))
+    {
+        bucket++;
+    }
+
+    this->hrdy_histogram[bucket]++;
+    this->hrdy_wait_us += duration;
+}
+
+
+/**
+ * @brief Take over the counters kept by the main loop: drawing and completed jobs
+ * @param loop Counters of the main loop
+ */
+void Statistics::merge_loop_counters(Statistics const &loop)
+{
+    this->fast_pixels = loop.fast_pixels;
+    this->fast_pixels_us = loop.fast_pixels_us;
+    this->generic_pixels = loop.generic_pixels;
+    this->generic_pixels_us = loop.generic_pixels_us;
+    this->flushes = loop.flushes;
+    this->flush_us = loop.flush_us;
+}
+
+
+/**
+ * @brief Log the bus traffic generated by an operation
+ * @param operation Name of the operation, for the log
+ * @param start Counters when the operation started
+ * @param duration Duration of the operation, in us
+ */
+void Statistics::log_operation(char const * const operation, Statistics const &start, uint32_t const duration) const
+{
+    IT8951E_LOGD(TAG, "%s: %" PRIu32 " us, %" PRIu32 " bytes written, %" PRIu32 " bytes read, %" PRIu32 " commands, %" PRIu32 " CS, %" PRIu32 " us waiting for HRDY",
+        operation,
+        duration,
+        this->bytes_written - start.bytes_written,
+        this->bytes_read - start.bytes_read,
+        this->commands - start.commands,
+        this->cs_toggles - start.cs_toggles,
+        this->hrdy_wait_us - start.hrdy_wait_us
+    );
+    IT8951E_LOGD(TAG, "%s: %" PRIu32 " register writes, %" PRIu32 " skipped",
+        operation,
+        this->register_writes - start.register_writes,
+        this->register_writes_skipped - start.register_writes_skipped
+    );
+    IT8951E_LOGD(TAG, "%s: frame diff dropped %" PRIu32 " areas, saved %" PRIu32 " bytes",
+        operation,
+        this->diff_areas_dropped - start.diff_areas_dropped,
+        this->diff_bytes_saved - start.diff_bytes_saved
+    );
+    IT8951E_LOGD(TAG, "%s: HRDY waits <1us: %" PRIu32 ", <10us: %" PRIu32 ", <100us: %" PRIu32 ", <1ms: %" PRIu32 ", <10ms: %" PRIu32 ", <100ms: %" PRIu32 ", more: %" PRIu32,
+        operation,
+        this->hrdy_histogram[0] - start.hrdy_histogram[0],
+        this->hrdy_histogram[1] - start.hrdy_histogram[1],
+        this->hrdy_histogram[2] - start.hrdy_histogram[2],
+        this->hrdy_histogram[3] - start.hrdy_histogram[3],
+        this->hrdy_histogram[4] - start.hrdy_histogram[4],
+        this->hrdy_histogram[5] - start.hrdy_histogram[5],
+        this->hrdy_histogram[6] - start.hrdy_histogram[6]
+    );
+}
+
+
+/**
+ * @brief Log the counters, as part of the display configuration
+ * @param features Enabled optional features: the counters of the others are left out
+ */
+void Statistics::dump_config(StatisticsFeatures const &features) const
+{
+    ESP_LOGCONFIG(TAG, "  Bus traffic: %" PRIu32 " bytes written, %" PRIu32 " bytes read, %" PRIu32 " commands, %" PRIu32 " CS",
+        this->bytes_written, this->bytes_read, this->commands, this->cs_toggles);
+    ESP_LOGCONFIG(TAG, "  HRDY waits: <1us: %" PRIu32 ", <10us: %" PRIu32 ", <100us: %" PRIu32 ", <1ms: %" PRIu32 ", <10ms: %" PRIu32 ", <100ms: %" PRIu32 ", more: %" PRIu32 ", timeouts: %" PRIu32,
+        this->hrdy_histogram[0], this->hrdy_histogram[1], this->hrdy_histogram[2], this->hrdy_histogram[3],
+        this->hrdy_histogram[4], this->hrdy_histogram[5], this->hrdy_histogram[6], this->hrdy_timeouts);
+    ESP_LOGCONFIG(TAG, "  Register writes: %" PRIu32 " sent, %" PRIu32 " skipped (unchanged)",
+        this->register_writes, this->register_writes_skipped);
+    ESP_LOGCONFIG(TAG, "  Frame diff: %" PRIu32 " areas dropped, %" PRIu32 " bytes saved",
+        this->diff_areas_dropped, this->diff_bytes_saved);
+    ESP_LOGCONFIG(TAG, "  Pixels drawn: %" PRIu32 " in %" PRIu32 " us by rows, %" PRIu32 " in %" PRIu32 " us by pixel",
+        this->fast_pixels, this->fast_pixels_us, this->generic_pixels, this->generic_pixels_us);
+    ESP_LOGCONFIG(TAG, "  Flushes: %" PRIu32 " in %" PRIu32 " us", this->flushes, this->flush_us);
+    ESP_LOGCONFIG(TAG, "  Refresh scheduling: %" PRIu32 " started concurrently, %" PRIu32 " waits, %" PRIu32 " us waited",
+        this->concurrent_refreshes, this->refresh_waits, this->refresh_wait_us);
+    ESP_LOGCONFIG(TAG, "  Display depth: %" PRIu32 " switches waited %" PRIu32 " us for the refreshes in progress, %" PRIu32 " areas not packed to avoid it",
+        this->depth_switch_waits, this->depth_switch_wait_us, this->depth_fallbacks);
+    if (features.packed_transfers)
+    {
+        ESP_LOGCONFIG(TAG, "  Packed transfers: %" PRIu32 " areas in 1bpp, %" PRIu32 " areas in 2bpp, %" PRIu32 " bytes saved",
+            this->packed_1bpp_areas, this->packed_2bpp_areas, this->packed_bytes_saved);
+    }
+    if (features.power_saving)
+    {
+        ESP_LOGCONFIG(TAG, "  Power saving: %" PRIu32 " sleeps, %" PRIu32 " wakes, %" PRIu32 " us waking (max %" PRIu32 " us)",
+            this->sleeps, this->wakes, this->wake_us, this->max_wake_us);
+    }
+    ESP_LOGCONFIG(TAG, "  Solid fills: %" PRIu32 " areas refreshed without image data, %" PRIu32 " bytes saved",
+        this->filled_areas, this->fill_bytes_saved);
+    if (features.spi_auto_tune)
+    {
+        ESP_LOGCONFIG(TAG, "  SPI rate switches: %" PRIu32 " in %" PRIu32 " us, fallbacks: %" PRIu32, this->rate_switches, this->rate_switch_us,
+            this->rate_fallbacks);
+    }
+    ESP_LOGCONFIG(TAG, "  Image data: %" PRIu32 " bytes written in %" PRIu32 " us (%" PRIu32 " kB/s), %" PRIu32 " bytes read in %" PRIu32 " us (%" PRIu32 " kB/s)",
+        this->image_bytes_written, this->image_write_us, throughput_kbps(this->image_bytes_written, this->image_write_us),
+        this->memory_bytes_read, this->memory_read_us, throughput_kbps(this->memory_bytes_read, this->memory_read_us));
+    if (features.double_buffering)
+    {
+        ESP_LOGCONFIG(TAG, "  Double buffering: %" PRIu32 " areas loaded during a refresh, %" PRIu32 " into the back buffer",
+            this->overlapped_loads, this->back_buffer_loads);
+    }
+    ESP_LOGCONFIG(TAG, "  Refreshes: INIT %" PRIu32 ", DU %" PRIu32 ", GC16 %" PRIu32 ", GL16 %" PRIu32 ", GLR16 %" PRIu32 ", GLD16 %" PRIu32 ", DU4 %" PRIu32 ", A2 %" PRIu32,
+        this->refreshes[0], this->refreshes[1], this->refreshes[2], this->refreshes[3],
+        this->refreshes[4], this->refreshes[5], this->refreshes[6], this->refreshes[7]);
+}
+
+} // namespace it8951e
+} // namespace esphome
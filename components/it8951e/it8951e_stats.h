@@ -0,0 +1,83 @@
+#pragma once
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/**
+ * @file it8951e_stats.h
+ * @brief Bus traffic and feature counters of the IT8951 driver.
+ */
+
+#include "it8951e_priv.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace esphome {
+namespace it8951e {
+
+/**
+ * @brief Optional features of the driver, whose counters are only listed when enabled
+ */
+struct StatisticsFeatures {
+    bool packed_transfers;
+    bool power_saving;
+    bool spi_auto_tune;
+    bool double_buffering;
+};
+
+/**
+ * @brief Bus traffic counters, used to measure the cost of display operations
+ */
+struct Statistics {
+    static constexpr size_t HRDY_HISTOGRAM_BUCKETS = 7;
+
+    uint32_t bytes_written = 0;
+    uint32_t bytes_read = 0;
+    uint32_t cs_toggles = 0;
+    uint32_t commands = 0;
+    uint32_t hrdy_wait_us = 0;
+    uint32_t hrdy_timeouts = 0;
+    uint32_t register_writes = 0;
+    uint32_t register_writes_skipped = 0;
+    uint32_t diff_areas_dropped = 0;
+    uint32_t diff_bytes_saved = 0;
+    uint32_t fast_pixels = 0;
+    uint32_t fast_pixels_us = 0;
+    uint32_t generic_pixels = 0;
+    uint32_t generic_pixels_us = 0;
+    uint32_t flushes = 0;
+    uint32_t flush_us = 0;
+    uint32_t refreshes[static_cast<size_t>(UpdateMode::None)] = {0};
+    uint32_t concurrent_refreshes = 0;
+    uint32_t refresh_waits = 0;
+    uint32_t refresh_wait_us = 0;
+    uint32_t packed_1bpp_areas = 0;
+    uint32_t packed_2bpp_areas = 0;
+    uint32_t packed_bytes_saved = 0;
+    uint32_t back_buffer_loads = 0;
+    uint32_t overlapped_loads = 0;
+    uint32_t filled_areas = 0;
+    uint32_t fill_bytes_saved = 0;
+    uint32_t image_bytes_written = 0;
+    uint32_t image_write_us = 0;
+    uint32_t memory_bytes_read = 0;
+    uint32_t memory_read_us = 0;
+    uint32_t rate_switches = 0;
+    uint32_t rate_switch_us = 0;
+    uint32_t sleeps = 0;
+    uint32_t wakes = 0;
+    uint32_t wake_us = 0;
+    uint32_t max_wake_us = 0;
+    uint32_t rate_fallbacks = 0;
+    uint32_t depth_switch_waits = 0;
+    uint32_t depth_switch_wait_us = 0;
+    uint32_t depth_fallbacks = 0;
+    uint32_t hrdy_histogram[HRDY_HISTOGRAM_BUCKETS] = {0};
+
+    void record_hrdy_wait(uint32_t const duration);
+    void merge_loop_counters(Statistics const &loop);
+    void log_operation(char const * const operation, Statistics const &start, uint32_t const duration) const;
+    void dump_config(StatisticsFeatures const &features) const;
+};
+
+} // namespace it8951e
+} // namespace esphome
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "it8951e_telemetry.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace esphome {
+namespace it8951e {
+
+/**
+ * @brief Account a finished refresh
+ * @param sample Timing of the refresh
+ */
+void LatencyTelemetry::add(RefreshSample const &sample)
+{
+    if (sample.mode >= UpdateMode::None)
+    {
+        return;
+    }
+
+    ModeTotals &totals = this->totals[static_cast<size_t>(sample.mode)];
+    totals.count++;
+    totals.transfer_us += sample.transfer_us;
+    totals.busy_ms += sample.busy_ms;
+    totals.max_busy_ms = std::max(totals.max_busy_ms, sample.busy_ms);
+
+    this->latencies[this->samples % WINDOW] = (sample.transfer_us + 500) / 1000 + sample.busy_ms;
+    this->samples++;
+}
+
+
+/**
+ * @brief Get a percentile of the latencies of the latest refreshes
+ * @param percent Percentile, 0 to 100
+ * @return Latency in ms, 0 if no refresh finished yet
+ */
+uint32_t LatencyTelemetry::get_percentile(uint8_t const percent) const
+{
+    size_t const count = std::min<size_t>(this->samples, WINDOW);
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    uint32_t sorted[WINDOW];
+    memcpy(sorted, this->latencies, count * sizeof(sorted[0]));
+
+    size_t const index = ((count - 1) * std::min<uint8_t>(percent, 100) + 50) / 100;
+    std::nth_element(sorted, sorted + index, sorted + count);
+    return sorted[index];
+}
+
+} // namespace it8951e
+} // namespace esphome
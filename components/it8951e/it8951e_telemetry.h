@@ -0,0 +1,52 @@
+#pragma once
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/**
+ * @file it8951e_telemetry.h
+ * @brief Refresh latency statistics of the IT8951 driver.
+ */
+
+#include "it8951e_priv.h"
+#include "it8951e_refresh.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace esphome {
+namespace it8951e {
+
+/**
+ * @brief Totals per update mode, and a rolling window of the latest refresh latencies
+ *
+ * The latency of a refresh is the transfer time of its image data plus the time its LUT engine was busy.
+ */
+class LatencyTelemetry
+{
+    public:
+        static constexpr size_t WINDOW = 64;
+
+        /**
+         * @brief Totals of the refreshes in one update mode
+         */
+        struct ModeTotals {
+            uint32_t count = 0;
+            uint32_t transfer_us = 0;
+            uint32_t busy_ms = 0;
+            uint32_t max_busy_ms = 0;
+        };
+
+        void add(RefreshSample const &sample);
+
+        uint32_t get_percentile(uint8_t const percent) const;
+        uint32_t get_sample_count() const { return this->samples; }
+        ModeTotals const &get_totals(UpdateMode const mode) const { return this->totals[static_cast<size_t>(mode)]; }
+
+    private:
+        ModeTotals totals[static_cast<size_t>(UpdateMode::None)];
+
+        uint32_t latencies[WINDOW] = {0};
+        uint32_t samples = 0;
+};
+
+} // namespace it8951e
+} // namespace esphome
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Cost of the main display operations against the simulated controller: bytes moved on the bus, chip select
+// toggles, and the virtual time the caller is blocked for. Protocol violations make the benchmark fail.
+
+#include "it8951e.h"
+#include "it8951e_simulator.h"
+
+#include "esphome/core/hal.h"
+
+#include <stdio.h>
+
+#include <functional>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::it8951e;
+
+static constexpr uint32_t REFRESH_TIME_MS = 450;
+
+/**
+ * @brief Run the main loop for two seconds of virtual time, so each operation starts with an idle controller
+ */
+static void idle(IT8951EDisplay &display)
+{
+    for (int i = 0; i < 400; i++)
+    {
+        display.loop();
+        host::advance_us(5000);
+    }
+}
+
+static void measure(testing::Simulator &sim, char const * const name, std::function<void()> const &operation)
+{
+    sim.clear_log();
+    uint64_t const start = host::now_ns();
+    operation();
+    uint64_t const elapsed = host::now_ns() - start;
+
+    printf("%-34s %10zu %8zu %10u %10u %12.1f\n", name, sim.get_bytes_written(), sim.get_bytes_read(),
+           static_cast<unsigned>(sim.get_cs_toggles()), static_cast<unsigned>(sim.get_refreshes().size()),
+           elapsed / 1000.0);
+}
+
+int main()
+{
+    testing::Simulator sim;
+    sim.set_refresh_time(REFRESH_TIME_MS);
+
+    // Like on the device, the display is never destroyed
+    IT8951EDisplay &display = *new IT8951EDisplay();
+    display.set_auto_clear(false);
+    display.set_reset_pin(sim.get_reset_pin());
+    display.set_ready_pin(sim.get_ready_pin());
+    display.set_cs_pin(sim.get_cs_pin());
+
+    printf("Simulated %ux%u panel, HRDY latency %u us, refresh time %u ms\n\n", sim.get_width(), sim.get_height(),
+           static_cast<unsigned>(testing::Simulator::DEFAULT_HRDY_LATENCY_US), static_cast<unsigned>(REFRESH_TIME_MS));
+    printf("%-34s %10s %8s %10s %10s %12s\n", "operation", "written", "read", "CS toggles", "refreshes", "time (us)");
+
+    measure(sim, "setup", [&]() { display.setup(); });
+    idle(display);
+
+    measure(sim, "clear", [&]() { display.clear(); });
+    idle(display);
+
+    // Every pixel changes: write_buffer_to_display of the whole frame
+    std::vector<uint8_t> frame(static_cast<size_t>(sim.get_width()) * sim.get_height());
+    for (size_t i = 0; i < frame.size(); i++)
+    {
+        frame[i] = ((i % sim.get_width()) & 0x08) ? 0xFF : 0x00;
+    }
+    display.set_writer([&frame, &sim](display::Display &it) {
+        it.draw_pixels_at(0, 0, sim.get_width(), sim.get_height(), frame.data(), display::COLOR_ORDER_RGB,
+                          display::COLOR_BITNESS_332, true, 0, 0, 0);
+    });
+    measure(sim, "do_update, full frame", [&]() { display.update(); });
+    idle(display);
+
+    // A small area changes
+    std::vector<uint8_t> const area(40 * 40, 0xFF);
+    display.set_writer([&area](display::Display &it) {
+        it.draw_pixels_at(100, 100, 40, 40, area.data(), display::COLOR_ORDER_RGB, display::COLOR_BITNESS_332, true, 0, 0, 0);
+    });
+    measure(sim, "do_update, 40x40 area", [&]() { display.update(); });
+    idle(display);
+
+    // Nothing changes
+    measure(sim, "do_update, unchanged area", [&]() { display.update(); });
+    idle(display);
+
+    if (!sim.get_errors().empty())
+    {
+        for (auto const &error : sim.get_errors())
+        {
+            fprintf(stderr, "Simulator error: %s\n", error.c_str());
+        }
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,846 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "it8951e_simulator.h"
+
+#include "esphome/core/hal.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace esphome {
+namespace it8951e {
+namespace testing {
+
+// Preambles of the host interface transactions
+static constexpr uint16_t PREAMBLE_COMMAND = 0x6000;
+static constexpr uint16_t PREAMBLE_WRITE_DATA = 0x0000;
+static constexpr uint16_t PREAMBLE_READ_DATA = 0x1000;
+
+// Commands
+static constexpr uint16_t SYS_RUN = 0x0001;
+static constexpr uint16_t STANDBY = 0x0002;
+static constexpr uint16_t SLEEP = 0x0003;
+static constexpr uint16_t REG_RD = 0x0010;
+static constexpr uint16_t REG_WR = 0x0011;
+static constexpr uint16_t MEM_BST_RD_T = 0x0012;
+static constexpr uint16_t MEM_BST_RD_S = 0x0013;
+static constexpr uint16_t MEM_BST_WR = 0x0014;
+static constexpr uint16_t MEM_BST_END = 0x0015;
+static constexpr uint16_t LD_IMG = 0x0020;
+static constexpr uint16_t LD_IMG_AREA = 0x0021;
+static constexpr uint16_t LD_IMG_END = 0x0022;
+static constexpr uint16_t DPY_AREA = 0x0034;
+static constexpr uint16_t DPY_BUF_AREA = 0x0037;
+static constexpr uint16_t VCOM = 0x0039;
+static constexpr uint16_t GET_DEV_INFO = 0x0302;
+
+// Registers with a behaviour
+static constexpr uint16_t LUTAFSR = 0x1224;
+static constexpr uint16_t UP1SR2 = 0x113A;
+static constexpr uint16_t BGVR = 0x1250;
+static constexpr uint16_t LISAR = 0x0208;
+static constexpr uint16_t LISARH = 0x020C;
+
+// UP1SR2 bit of the 1bpp display mode
+static constexpr uint16_t UP1SR2_1BPP = 1u << 2;
+
+// Pixel modes of the load commands, and the bits per pixel of each
+static constexpr uint8_t PIXEL_MODE_BITS[] = {2, 3, 4, 8};
+
+static constexpr char const LUT_VERSION[] = "M841_TFA2812";
+static constexpr char const FW_VERSION[] = "SWv_0.1.1";
+
+
+bool SimulatedPin::digital_read()
+{
+    host::advance_ns(Simulator::PIN_ACCESS_NS);
+    return this->read ? this->read() : false;
+}
+
+
+void SimulatedPin::digital_write(bool const value)
+{
+    host::advance_ns(Simulator::PIN_ACCESS_NS);
+    bool const changed = value != this->level;
+    this->level = value;
+    if (changed && this->write)
+    {
+        this->write(value);
+    }
+}
+
+
+Simulator::Simulator(uint16_t const width, uint16_t const height, uint32_t const image_address) :
+    width(width),
+    height(height),
+    image_address(image_address),
+    cs_pin(nullptr, [this](bool const level) { this->select(!level); }),
+    ready_pin([this]() { return this->ready(); }, nullptr),
+    reset_pin(nullptr, [this](bool const level) { if (level) this->reset(); }),
+    memory(MEMORY_SIZE, 0),
+    panel(static_cast<size_t>(width) * height, 0)
+{
+    this->registers.emplace_back(UP1SR2, DEFAULT_UP1SR2);
+    spi::set_host_bus(this);
+}
+
+
+Simulator::~Simulator()
+{
+    if (spi::get_host_bus() == this)
+    {
+        spi::set_host_bus(nullptr);
+    }
+}
+
+
+void Simulator::error(char const * const format, ...)
+{
+    char message[160];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    this->errors.emplace_back(message);
+}
+
+
+/**
+ * @brief Controller reset, on the rising edge of the reset pin: the registers and the LUT engines are reset, the
+ * memory and the panel keep their content
+ */
+void Simulator::reset()
+{
+    this->registers.clear();
+    this->registers.emplace_back(UP1SR2, DEFAULT_UP1SR2);
+    this->vcom = 0;
+    this->asleep = false;
+    this->frame = Frame::Idle;
+    this->command_active = false;
+    this->image_active = false;
+    this->burst_words = 0;
+    this->read_queue.clear();
+    this->lut_busy = 0;
+    this->hrdy_low_until_ns = 0;
+    this->resets++;
+}
+
+
+void Simulator::set_max_rates(uint32_t const write_rate, uint32_t const read_rate)
+{
+    this->max_write_rate = write_rate;
+    this->max_read_rate = read_rate;
+}
+
+
+uint8_t Simulator::get_image_level(uint16_t const x, uint16_t const y) const
+{
+    return this->memory[this->image_address + static_cast<uint32_t>(y) * this->width + x] >> 4;
+}
+
+
+uint16_t Simulator::get_register(uint16_t const address) const
+{
+    if (address == LUTAFSR)
+    {
+        return this->get_busy_luts();
+    }
+
+    for (auto const &reg : this->registers)
+    {
+        if (reg.first == address)
+        {
+            return reg.second;
+        }
+    }
+    return 0;
+}
+
+
+void Simulator::set_register(uint16_t const address, uint16_t const value)
+{
+    for (auto &reg : this->registers)
+    {
+        if (reg.first == address)
+        {
+            reg.second = value;
+            return;
+        }
+    }
+    this->registers.emplace_back(address, value);
+}
+
+
+uint16_t Simulator::get_busy_luts() const
+{
+    uint16_t busy = 0;
+    uint32_t const now = host::now_us();
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        if ((this->lut_busy & (1u << i)) && (static_cast<int32_t>(this->luts[i].end_us - now) > 0))
+        {
+            busy |= 1u << i;
+        }
+    }
+    return busy;
+}
+
+
+void Simulator::update_luts()
+{
+    this->lut_busy = this->get_busy_luts();
+}
+
+
+uint32_t Simulator::get_command_count(uint16_t const command) const
+{
+    for (auto const &count : this->command_counts)
+    {
+        if (count.first == command)
+        {
+            return count.second;
+        }
+    }
+    return 0;
+}
+
+
+void Simulator::clear_log()
+{
+    this->loads.clear();
+    this->refreshes.clear();
+    this->command_counts.clear();
+    this->resets = 0;
+    this->bytes_written = 0;
+    this->bytes_read = 0;
+    this->cs_toggles = 0;
+}
+
+
+/**
+ * @brief HRDY: low while a command is being processed, for the HRDY latency after each command
+ */
+bool Simulator::ready() const
+{
+    return host::now_ns() >= this->hrdy_low_until_ns;
+}
+
+
+/**
+ * @brief Advance the virtual clock by the time of an SPI call transferring the given number of bytes
+ */
+void Simulator::advance_bus(size_t const length) const
+{
+    uint64_t const bits_ns = static_cast<uint64_t>(length) * 8 * 1000000000ull;
+    host::advance_ns(SPI_CALL_NS + (this->data_rate ? (bits_ns / this->data_rate) : 0));
+}
+
+
+void Simulator::select(bool const selected)
+{
+    if (selected)
+    {
+        if (this->frame != Frame::Idle)
+        {
+            this->error("CS asserted twice");
+        }
+        this->cs_toggles++;
+        this->frame = Frame::Preamble;
+        this->partial_length = 0;
+        return;
+    }
+
+    if (this->frame == Frame::Idle)
+    {
+        this->error("CS released while not selected");
+    }
+    else if (this->partial_length)
+    {
+        this->error("Transaction ended in the middle of a word");
+    }
+    else if ((this->frame == Frame::Preamble) || (this->frame == Frame::Command) || (this->frame == Frame::ReadDummy))
+    {
+        this->error("Transaction ended before its preamble, command or dummy word");
+    }
+    this->frame = Frame::Idle;
+}
+
+
+void Simulator::write(uint8_t const * const data, size_t const length)
+{
+    if (this->frame == Frame::Idle)
+    {
+        this->error("Write of %zu bytes without chip select", length);
+        return;
+    }
+
+    this->advance_bus(length);
+    this->bytes_written += length;
+    bool const corrupt = this->data_rate > this->max_write_rate;
+    for (size_t i = 0; i < length; i++)
+    {
+        // Above the maximum rate, the data words get corrupted. The preambles still go through.
+        this->on_byte((corrupt && (this->frame == Frame::Data)) ? (data[i] ^ 0x01) : data[i]);
+    }
+}
+
+
+void Simulator::transfer(uint8_t * const data, size_t const length)
+{
+    this->advance_bus(length);
+    this->bytes_read += length;
+    if (this->frame == Frame::Read)
+    {
+        bool const corrupt = this->data_rate > this->max_read_rate;
+        for (size_t i = 0; i < length; i++)
+        {
+            if (this->read_position < this->read_queue.size())
+            {
+                data[i] = this->read_queue[this->read_position++] ^ (corrupt ? 0x01 : 0x00);
+            }
+            else
+            {
+                data[i] = 0;
+                this->error("Read of %zu bytes beyond the data available", length);
+                break;
+            }
+        }
+        return;
+    }
+
+    this->error("Transfer of %zu bytes outside of a read transaction", length);
+    memset(data, 0, length);
+}
+
+
+void Simulator::on_byte(uint8_t const byte)
+{
+    if (this->frame == Frame::Data)
+    {
+        if (this->image_active)
+        {
+            this->on_image_byte(byte);
+            return;
+        }
+    }
+    else if ((this->frame == Frame::Read) || (this->frame == Frame::Done))
+    {
+        this->error("Unexpected write in a transaction already complete");
+        return;
+    }
+
+    this->partial[this->partial_length++] = byte;
+    if (this->partial_length == 2)
+    {
+        this->partial_length = 0;
+        this->on_word((this->partial[0] << 8) | this->partial[1]);
+    }
+}
+
+
+void Simulator::on_word(uint16_t const word)
+{
+    switch (this->frame)
+    {
+        case Frame::Preamble:
+            if (word == PREAMBLE_COMMAND)
+            {
+                this->frame = Frame::Command;
+            }
+            else if (word == PREAMBLE_WRITE_DATA)
+            {
+                this->frame = Frame::Data;
+            }
+            else if (word == PREAMBLE_READ_DATA)
+            {
+                this->frame = Frame::ReadDummy;
+            }
+            else
+            {
+                this->error("Unknown preamble 0x%04x", word);
+                this->frame = Frame::Done;
+            }
+            break;
+
+        case Frame::Command:
+            this->frame = Frame::Done;
+            this->start_command(word);
+            break;
+
+        case Frame::ReadDummy:
+            this->frame = Frame::Read;
+            this->read_position = 0;
+            break;
+
+        case Frame::Data:
+            if (this->burst_words)
+            {
+                // Burst write: the lower address is the low byte of the word
+                this->burst_words--;
+                if (this->burst_address + 1 < MEMORY_SIZE)
+                {
+                    this->memory[this->burst_address] = word & 0xFF;
+                    this->memory[this->burst_address + 1] = word >> 8;
+                }
+                this->burst_address += 2;
+            }
+            else
+            {
+                this->on_argument(word);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+void Simulator::start_command(uint16_t const command)
+{
+    if (this->command_active)
+    {
+        this->error("Command 0x%04x sent with %zu of the %zu arguments of command 0x%04x", command,
+                    this->arguments.size(), this->expected_arguments, this->command);
+    }
+    if (this->image_active && (command != LD_IMG_END))
+    {
+        this->error("Command 0x%04x sent during an image load", command);
+        this->image_active = false;
+    }
+    if (this->asleep && (command != SYS_RUN))
+    {
+        this->error("Command 0x%04x sent while the controller sleeps", command);
+    }
+
+    bool counted = false;
+    for (auto &count : this->command_counts)
+    {
+        if (count.first == command)
+        {
+            count.second++;
+            counted = true;
+        }
+    }
+    if (!counted)
+    {
+        this->command_counts.emplace_back(command, 1);
+    }
+
+    this->command = command;
+    this->command_active = true;
+    this->arguments.clear();
+    this->read_queue.clear();
+
+    switch (command)
+    {
+        case SYS_RUN:
+        case STANDBY:
+        case SLEEP:
+        case MEM_BST_RD_S:
+        case MEM_BST_END:
+        case LD_IMG_END:
+        case GET_DEV_INFO:
+            this->expected_arguments = 0;
+            break;
+        case REG_RD:
+        case LD_IMG:
+        case VCOM:
+            this->expected_arguments = 1;
+            break;
+        case REG_WR:
+            this->expected_arguments = 2;
+            break;
+        case MEM_BST_RD_T:
+        case MEM_BST_WR:
+            this->expected_arguments = 4;
+            break;
+        case LD_IMG_AREA:
+        case DPY_AREA:
+            this->expected_arguments = 5;
+            break;
+        case DPY_BUF_AREA:
+            this->expected_arguments = 7;
+            break;
+        default:
+            this->error("Unknown command 0x%04x", command);
+            this->command_active = false;
+            return;
+    }
+
+    if (this->expected_arguments == 0)
+    {
+        this->execute();
+    }
+}
+
+
+void Simulator::on_argument(uint16_t const argument)
+{
+    if (!this->command_active)
+    {
+        this->error("Data word 0x%04x without a command expecting it", argument);
+        return;
+    }
+
+    this->arguments.push_back(argument);
+
+    // Writing VCOM takes the value as a second argument
+    if ((this->command == VCOM) && (this->arguments.size() == 1) && (argument == 1))
+    {
+        this->expected_arguments = 2;
+    }
+
+    if (this->arguments.size() == this->expected_arguments)
+    {
+        this->execute();
+    }
+}
+
+
+void Simulator::queue_word(uint16_t const word)
+{
+    this->read_queue.push_back(word >> 8);
+    this->read_queue.push_back(word & 0xFF);
+}
+
+
+void Simulator::execute()
+{
+    auto const &a = this->arguments;
+    this->command_active = false;
+    this->hrdy_low_until_ns = host::now_ns() + static_cast<uint64_t>(this->hrdy_latency_us) * 1000;
+
+    switch (this->command)
+    {
+        case SYS_RUN:
+            this->asleep = false;
+            break;
+
+        case STANDBY:
+        case SLEEP:
+            this->asleep = true;
+            break;
+
+        case REG_RD:
+            this->queue_word(this->get_register(a[0]));
+            break;
+
+        case REG_WR:
+            this->set_register(a[0], a[1]);
+            break;
+
+        case MEM_BST_RD_T:
+        case MEM_BST_WR:
+            this->burst_address = a[0] | (static_cast<uint32_t>(a[1]) << 16);
+            this->burst_words = (this->command == MEM_BST_WR) ? (a[2] | (static_cast<uint32_t>(a[3]) << 16)) : 0;
+            this->burst_read_bytes = (this->command == MEM_BST_RD_T) ? (a[2] | (static_cast<uint32_t>(a[3]) << 16)) * 2 : 0;
+            break;
+
+        case MEM_BST_RD_S:
+            if (this->burst_address + this->burst_read_bytes > MEMORY_SIZE)
+            {
+                this->error("Burst read of %zu bytes at 0x%06x beyond the memory", this->burst_read_bytes, this->burst_address);
+                break;
+            }
+            // Words are sent most significant byte first, and the lower address is the low byte of a word
+            for (size_t i = 0; i < this->burst_read_bytes; i += 2)
+            {
+                this->read_queue.push_back(this->memory[this->burst_address + i + 1]);
+                this->read_queue.push_back(this->memory[this->burst_address + i]);
+            }
+            break;
+
+        case MEM_BST_END:
+            if (this->burst_words)
+            {
+                this->error("Burst write ended %u words short", this->burst_words);
+                this->burst_words = 0;
+            }
+            break;
+
+        case LD_IMG:
+        {
+            bool const rotated = (a[0] & 0x1) != 0;
+            this->start_load(this->get_register(LISAR) | (static_cast<uint32_t>(this->get_register(LISARH)) << 16), a[0],
+                             0, 0, rotated ? this->height : this->width, rotated ? this->width : this->height);
+            break;
+        }
+
+        case LD_IMG_AREA:
+            this->start_load(this->get_register(LISAR) | (static_cast<uint32_t>(this->get_register(LISARH)) << 16), a[0],
+                             a[1], a[2], a[3], a[4]);
+            break;
+
+        case LD_IMG_END:
+            this->end_image();
+            break;
+
+        case DPY_AREA:
+            this->refresh(a[0], a[1], a[2], a[3], a[4], this->image_address);
+            break;
+
+        case DPY_BUF_AREA:
+            this->refresh(a[0], a[1], a[2], a[3], a[4], a[5] | (static_cast<uint32_t>(a[6]) << 16));
+            break;
+
+        case VCOM:
+            if (a[0] == 0)
+            {
+                this->queue_word(this->vcom);
+            }
+            else
+            {
+                this->vcom = a[1];
+            }
+            break;
+
+        case GET_DEV_INFO:
+        {
+            uint8_t info[40] = {};
+            info[0] = this->width >> 8;
+            info[1] = this->width & 0xFF;
+            info[2] = this->height >> 8;
+            info[3] = this->height & 0xFF;
+            info[4] = (this->image_address >> 8) & 0xFF;
+            info[5] = this->image_address & 0xFF;
+            info[6] = (this->image_address >> 24) & 0xFF;
+            info[7] = (this->image_address >> 16) & 0xFF;
+            memcpy(info + 8, LUT_VERSION, sizeof(LUT_VERSION));
+            memcpy(info + 24, FW_VERSION, sizeof(FW_VERSION));
+            this->read_queue.assign(info, info + sizeof(info));
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+
+/**
+ * @brief Map a pixel of a load area to the panel, for the rotation of the load
+ */
+bool Simulator::to_panel(uint8_t const rotation, uint16_t const fx, uint16_t const fy, uint16_t &px, uint16_t &py) const
+{
+    switch (rotation)
+    {
+        case 1:
+            px = this->width - 1 - fy;
+            py = fx;
+            break;
+        case 2:
+            px = this->width - 1 - fx;
+            py = this->height - 1 - fy;
+            break;
+        case 3:
+            px = fy;
+            py = this->height - 1 - fx;
+            break;
+        default:
+            px = fx;
+            py = fy;
+            break;
+    }
+    return (px < this->width) && (py < this->height);
+}
+
+
+void Simulator::start_load(uint32_t const address, uint16_t const mode, uint16_t const x, uint16_t const y, uint16_t const w,
+                           uint16_t const h)
+{
+    Load load{address, x, y, w, h, static_cast<uint8_t>((mode >> 4) & 0x3), static_cast<uint8_t>(mode & 0x3), 0};
+    uint8_t const bits = PIXEL_MODE_BITS[load.pixel_mode];
+
+    if (((mode >> 8) & 0x1) == 0)
+    {
+        this->error("Little endian image load, not simulated");
+    }
+    if (bits == 3)
+    {
+        this->error("3bpp image load, not simulated");
+    }
+    if ((static_cast<uint32_t>(w) * bits) % 16)
+    {
+        this->error("Image load rows of %u pixels at %u bpp are not whole words", w, bits);
+    }
+    if ((address < this->image_address) || (address + static_cast<uint32_t>(this->width) * this->height > MEMORY_SIZE))
+    {
+        this->error("Image load into 0x%06x, outside of the frames", address);
+        return;
+    }
+
+    // A refresh in progress from the same frame would display the new data mid-waveform
+    this->update_luts();
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        if (!(this->lut_busy & (1u << i)) || (this->luts[i].refresh.address != address) || (load.rotation != 0))
+        {
+            continue;
+        }
+        Refresh const &r = this->luts[i].refresh;
+        uint32_t const lx = (bits == 8) ? 0 : x;
+        uint32_t const lw = (bits == 8) ? this->width : w;
+        if (!((lx + lw <= r.x) || (r.x + r.w <= lx) || (y + h <= r.y) || (r.y + r.h <= y)))
+        {
+            this->error("Image load of (%u, %u) %ux%u overlaps a refresh in progress", x, y, w, h);
+        }
+    }
+
+    this->image = load;
+    this->image_expected = (static_cast<size_t>(w) * h * bits) / 8;
+    this->image_active = true;
+}
+
+
+void Simulator::on_image_byte(uint8_t const byte)
+{
+    Load &load = this->image;
+    uint8_t const bits = PIXEL_MODE_BITS[load.pixel_mode];
+    if ((bits == 3) || (load.bytes >= this->image_expected))
+    {
+        if (load.bytes++ == this->image_expected)
+        {
+            this->error("Image data beyond the load area");
+        }
+        return;
+    }
+
+    size_t const row_bytes = (static_cast<size_t>(load.w) * bits) / 8;
+    uint16_t const row = load.bytes / row_bytes;
+    uint16_t const first = (load.bytes % row_bytes) * 8 / bits;
+    load.bytes++;
+
+    uint8_t const pixels = 8 / bits;
+    for (uint8_t i = 0; i < pixels; i++)
+    {
+        uint8_t const value = (byte >> (8 - bits * (i + 1))) & ((1u << bits) - 1);
+        uint8_t stored;
+        switch (bits)
+        {
+            case 2:
+                stored = (value * 5) * 0x11;
+                break;
+            case 4:
+                stored = value * 0x11;
+                break;
+            default:
+                stored = value;
+                break;
+        }
+
+        uint16_t px, py;
+        if (!this->to_panel(load.rotation, load.x + first + i, load.y + row, px, py))
+        {
+            this->error("Image pixel (%u, %u) outside of the panel", load.x + first + i, load.y + row);
+            continue;
+        }
+        this->memory[load.address + static_cast<uint32_t>(py) * this->width + px] = stored;
+    }
+}
+
+
+void Simulator::end_image()
+{
+    if (!this->image_active)
+    {
+        this->error("LD_IMG_END without an image load");
+        return;
+    }
+
+    this->image_active = false;
+    if (this->image.bytes != this->image_expected)
+    {
+        this->error("Image load of %zu bytes, %zu expected", this->image.bytes, this->image_expected);
+    }
+    this->loads.push_back(this->image);
+}
+
+
+void Simulator::refresh(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h, uint16_t const mode,
+                        uint32_t const address)
+{
+    if ((x % 4) || (w % 4) || (x + w > this->width) || (y + h > this->height) || (w == 0) || (h == 0))
+    {
+        this->error("Refresh of an invalid area (%u, %u) %ux%u", x, y, w, h);
+        return;
+    }
+    if (mode > 7)
+    {
+        this->error("Refresh with an unknown mode %u", mode);
+    }
+    if ((address < this->image_address) || (address + static_cast<uint32_t>(this->width) * this->height > MEMORY_SIZE))
+    {
+        this->error("Refresh from 0x%06x, outside of the frames", address);
+        return;
+    }
+
+    uint16_t const up1sr2 = this->get_register(UP1SR2);
+    bool const one_bpp = (up1sr2 & UP1SR2_1BPP) != 0;
+    uint16_t const color_table = this->get_register(BGVR);
+    if ((up1sr2 & ~UP1SR2_1BPP) != DEFAULT_UP1SR2)
+    {
+        this->error("UP1SR2 bits other than the 1bpp mode changed: 0x%04x", up1sr2);
+    }
+
+    Refresh const refresh{x, y, w, h, mode, address, one_bpp, color_table};
+
+    this->update_luts();
+    int free_lut = -1;
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        if (!(this->lut_busy & (1u << i)))
+        {
+            if (free_lut < 0)
+            {
+                free_lut = i;
+            }
+            continue;
+        }
+        Refresh const &r = this->luts[i].refresh;
+        if (!((x + w <= r.x) || (r.x + r.w <= x) || (y + h <= r.y) || (r.y + r.h <= y)))
+        {
+            this->error("Refresh of (%u, %u) %ux%u overlaps a refresh in progress", x, y, w, h);
+        }
+    }
+
+    if (free_lut < 0)
+    {
+        this->error("Refresh with all LUT engines busy");
+        return;
+    }
+
+    if (this->refresh_time_ms)
+    {
+        this->lut_busy |= 1u << free_lut;
+        this->luts[free_lut] = Lut{host::now_us() + this->refresh_time_ms * 1000, refresh};
+    }
+
+    for (uint16_t py = y; py < y + h; py++)
+    {
+        for (uint16_t px = x; px < x + w; px++)
+        {
+            uint8_t level;
+            if (one_bpp)
+            {
+                uint8_t const bits = this->memory[address + static_cast<uint32_t>(py) * this->width + (px >> 3)];
+                bool const set = (bits >> (7 - (px & 7))) & 0x1;
+                level = (set ? (color_table >> 8) : color_table) & 0xFF;
+            }
+            else
+            {
+                level = this->memory[address + static_cast<uint32_t>(py) * this->width + px];
+            }
+            this->panel[static_cast<size_t>(py) * this->width + px] = level >> 4;
+        }
+    }
+
+    this->refreshes.push_back(refresh);
+}
+
+} // namespace testing
+} // namespace it8951e
+} // namespace esphome
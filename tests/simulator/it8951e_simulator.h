@@ -0,0 +1,215 @@
+#pragma once
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/**
+ * @file it8951e_simulator.h
+ * @brief Host simulation of the IT8951 controller, at the level of its SPI host interface.
+ */
+
+#include "esphome/components/spi/spi.h"
+#include "esphome/core/gpio.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace it8951e {
+namespace testing {
+
+/**
+ * @brief GPIO pin wired to the simulator
+ */
+class SimulatedPin : public GPIOPin
+{
+    public:
+        SimulatedPin(std::function<bool()> read, std::function<void(bool)> write) : read(read), write(write) {}
+
+        void setup() override {}
+        void pin_mode(gpio::Flags flags) override {}
+        bool digital_read() override;
+        void digital_write(bool value) override;
+        std::string dump_summary() const override { return "simulated"; }
+
+        bool get_level() const { return this->level; }
+
+    private:
+        std::function<bool()> read;
+        std::function<void(bool)> write;
+        bool level = true;
+};
+
+
+/**
+ * @brief IT8951 controller simulated on the SPI bus of the host build
+ *
+ * Implements the SPI transactions of the host interface (command, write data and read data preambles framed by the
+ * chip select, HRDY handshake), the registers and commands used by the driver, the 8 MB controller memory and the
+ * display engine, which copies the image data of each refresh onto a simulated panel.
+ *
+ * Timing follows the virtual clock of the host build: each SPI call advances it by a fixed overhead plus the time
+ * of its bytes at the configured data rate, and each pin access by a GPIO access time. HRDY stays low for the HRDY
+ * latency after each command, and each LUT engine stays busy for the refresh time.
+ *
+ * Protocol violations do not stop the simulation: they are collected in get_errors(), which the tests check.
+ */
+class Simulator : public spi::HostBus
+{
+    public:
+        static constexpr uint32_t MEMORY_SIZE = 8 * 1024 * 1024;
+        static constexpr uint16_t DEFAULT_UP1SR2 = 0x0020;
+
+        // Costs on the virtual clock
+        static constexpr uint32_t SPI_CALL_NS = 2000;
+        static constexpr uint32_t PIN_ACCESS_NS = 100;
+        static constexpr uint32_t DEFAULT_HRDY_LATENCY_US = 20;
+
+        struct Load {
+            uint32_t address;
+            uint16_t x, y, w, h;
+            uint8_t pixel_mode;
+            uint8_t rotation;
+            size_t bytes;
+        };
+
+        struct Refresh {
+            uint16_t x, y, w, h;
+            uint16_t mode;
+            uint32_t address;
+            bool one_bpp;
+            uint16_t color_table;
+        };
+
+        Simulator(uint16_t const width = 960, uint16_t const height = 540, uint32_t const image_address = 0x1236E0);
+        ~Simulator();
+
+        GPIOPin *get_cs_pin() { return &this->cs_pin; }
+        GPIOPin *get_ready_pin() { return &this->ready_pin; }
+        GPIOPin *get_reset_pin() { return &this->reset_pin; }
+
+        void write(uint8_t const *data, size_t length) override;
+        void transfer(uint8_t *data, size_t length) override;
+        void set_data_rate(uint32_t rate) override { this->data_rate = rate; }
+
+        // Behaviour
+        void set_refresh_time(uint32_t const ms) { this->refresh_time_ms = ms; }
+        void set_hrdy_latency(uint32_t const us) { this->hrdy_latency_us = us; }
+        void set_max_rates(uint32_t const write_rate, uint32_t const read_rate);
+        // Keep HRDY low from now on, like a controller busy with a slow command
+        void stall_hrdy(uint32_t const us) { this->hrdy_low_until_ns = host::now_ns() + static_cast<uint64_t>(us) * 1000; }
+
+        // State
+        uint16_t get_width() const { return this->width; }
+        uint16_t get_height() const { return this->height; }
+        uint32_t get_image_address() const { return this->image_address; }
+        uint8_t get_panel_level(uint16_t const x, uint16_t const y) const { return this->panel[y * this->width + x]; }
+        uint8_t get_image_level(uint16_t const x, uint16_t const y) const;
+        uint8_t get_memory(uint32_t const address) const { return this->memory[address]; }
+        void set_memory(uint32_t const address, uint8_t const value) { this->memory[address] = value; }
+        uint16_t get_register(uint16_t const address) const;
+        uint16_t get_vcom() const { return this->vcom; }
+        uint32_t get_data_rate() const { return this->data_rate; }
+        uint16_t get_busy_luts() const;
+        bool is_asleep() const { return this->asleep; }
+
+        // Activity since the last clear_log()
+        std::vector<Load> const &get_loads() const { return this->loads; }
+        std::vector<Refresh> const &get_refreshes() const { return this->refreshes; }
+        uint32_t get_command_count(uint16_t const command) const;
+        uint32_t get_resets() const { return this->resets; }
+        size_t get_bytes_written() const { return this->bytes_written; }
+        size_t get_bytes_read() const { return this->bytes_read; }
+        uint32_t get_cs_toggles() const { return this->cs_toggles; }
+        void clear_log();
+
+        std::vector<std::string> const &get_errors() const { return this->errors; }
+        void clear_errors() { this->errors.clear(); }
+
+    private:
+        enum class Frame { Idle, Preamble, Command, Data, ReadDummy, Read, Done };
+
+        struct Lut {
+            uint32_t end_us;
+            Refresh refresh;
+        };
+
+        uint16_t width;
+        uint16_t height;
+        uint32_t image_address;
+
+        SimulatedPin cs_pin;
+        SimulatedPin ready_pin;
+        SimulatedPin reset_pin;
+
+        std::vector<uint8_t> memory;
+        std::vector<uint8_t> panel;
+        std::vector<std::pair<uint16_t, uint16_t>> registers;
+        uint16_t vcom = 0;
+        bool asleep = false;
+
+        uint32_t refresh_time_ms = 0;
+        uint32_t hrdy_latency_us = DEFAULT_HRDY_LATENCY_US;
+        uint64_t hrdy_low_until_ns = 0;
+        uint32_t data_rate = 0;
+        uint32_t max_write_rate = UINT32_MAX;
+        uint32_t max_read_rate = UINT32_MAX;
+
+        // Transaction in progress
+        Frame frame = Frame::Idle;
+        uint8_t partial[2] = {};
+        size_t partial_length = 0;
+        std::vector<uint8_t> read_queue;
+        size_t read_position = 0;
+
+        // Command in progress: its arguments, then the image data or burst write data that follows
+        uint16_t command = 0;
+        bool command_active = false;
+        std::vector<uint16_t> arguments;
+        size_t expected_arguments = 0;
+        bool image_active = false;
+        Load image = {};
+        size_t image_expected = 0;
+        uint32_t burst_address = 0;
+        uint32_t burst_words = 0;
+        size_t burst_read_bytes = 0;
+
+        Lut luts[16] = {};
+        uint16_t lut_busy = 0;
+
+        std::vector<Load> loads;
+        std::vector<Refresh> refreshes;
+        std::vector<std::pair<uint16_t, uint32_t>> command_counts;
+        uint32_t resets = 0;
+        size_t bytes_written = 0;
+        size_t bytes_read = 0;
+        uint32_t cs_toggles = 0;
+        std::vector<std::string> errors;
+
+        void error(char const *format, ...) __attribute__((format(printf, 2, 3)));
+        void reset();
+        void select(bool selected);
+        bool ready() const;
+        void advance_bus(size_t length) const;
+
+        void on_byte(uint8_t byte);
+        void on_word(uint16_t word);
+        void start_command(uint16_t command);
+        void on_argument(uint16_t argument);
+        void execute();
+        void on_image_byte(uint8_t byte);
+        void end_image();
+
+        void set_register(uint16_t address, uint16_t value);
+        void queue_word(uint16_t word);
+        void start_load(uint32_t address, uint16_t mode, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+        void refresh(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t mode, uint32_t address);
+        void update_luts();
+        bool to_panel(uint8_t rotation, uint16_t fx, uint16_t fy, uint16_t &px, uint16_t &py) const;
+};
+
+} // namespace testing
+} // namespace it8951e
+} // namespace esphome
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "esphome/core/automation.h"
+#include "esphome/core/color.h"
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/optional.h"
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace esphome {
+namespace display {
+
+enum DisplayType { DISPLAY_TYPE_BINARY = 1, DISPLAY_TYPE_GRAYSCALE = 2, DISPLAY_TYPE_COLOR = 3 };
+
+enum DisplayRotation {
+    DISPLAY_ROTATION_0_DEGREES = 0,
+    DISPLAY_ROTATION_90_DEGREES = 90,
+    DISPLAY_ROTATION_180_DEGREES = 180,
+    DISPLAY_ROTATION_270_DEGREES = 270,
+};
+
+enum ColorOrder : uint8_t { COLOR_ORDER_RGB = 0, COLOR_ORDER_BGR = 1, COLOR_ORDER_GRB = 2 };
+enum ColorBitness : uint8_t { COLOR_BITNESS_888 = 0, COLOR_BITNESS_565 = 1, COLOR_BITNESS_332 = 2 };
+
+static const Color COLOR_OFF(0, 0, 0, 0);
+static const Color COLOR_ON(255, 255, 255, 255);
+
+static const int16_t VALUE_NO_SET = 32766;
+
+class Rect
+{
+  public:
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+
+    Rect() : x(VALUE_NO_SET), y(VALUE_NO_SET), w(VALUE_NO_SET), h(VALUE_NO_SET) {}
+    Rect(int16_t x, int16_t y, int16_t w, int16_t h) : x(x), y(y), w(w), h(h) {}
+
+    int16_t x2() const { return this->x + this->w; }
+    int16_t y2() const { return this->y + this->h; }
+    bool is_set() const { return (this->h != VALUE_NO_SET) && (this->w != VALUE_NO_SET); }
+
+    void shrink(Rect rect);
+    bool inside(int16_t test_x, int16_t test_y, bool absolute = true) const;
+    bool inside(Rect rect) const;
+};
+
+class Display;
+using display_writer_t = std::function<void(Display &)>;
+
+class DisplayPage
+{
+  public:
+    DisplayPage(display_writer_t writer) : writer_(std::move(writer)) {}
+    const display_writer_t &get_writer() const { return this->writer_; }
+
+  protected:
+    display_writer_t writer_;
+};
+
+class Display : public PollingComponent
+{
+  public:
+    virtual void fill(Color color);
+    void clear();
+
+    virtual int get_width() { return this->get_width_internal(); }
+    virtual int get_height() { return this->get_height_internal(); }
+
+    virtual void draw_pixel_at(int x, int y, Color color) = 0;
+    virtual void draw_pixels_at(int x_start, int y_start, int w, int h, const uint8_t *ptr, ColorOrder order,
+                                ColorBitness bitness, bool big_endian, int x_offset, int y_offset, int x_pad);
+
+    void line(int x1, int y1, int x2, int y2, Color color = COLOR_ON);
+    void horizontal_line(int x, int y, int width, Color color = COLOR_ON);
+    void vertical_line(int x, int y, int height, Color color = COLOR_ON);
+    void rectangle(int x1, int y1, int width, int height, Color color = COLOR_ON);
+    void filled_rectangle(int x1, int y1, int width, int height, Color color = COLOR_ON);
+
+    virtual DisplayType get_display_type() = 0;
+
+    void set_writer(display_writer_t &&writer) { this->writer_ = writer; }
+    void show_page(DisplayPage *page) { this->page_ = page; }
+    void set_rotation(DisplayRotation rotation) { this->rotation_ = rotation; }
+    DisplayRotation get_rotation() const { return this->rotation_; }
+    void set_auto_clear(bool auto_clear_enabled) { this->auto_clear_enabled_ = auto_clear_enabled; }
+
+    void start_clipping(Rect rect);
+    void end_clipping();
+    Rect get_clipping() const;
+    bool is_clipping() const { return !this->clipping_rectangle_.empty(); }
+
+  protected:
+    virtual int get_width_internal() = 0;
+    virtual int get_height_internal() = 0;
+
+    void do_update_();
+    void clear_clipping_() { this->clipping_rectangle_.clear(); }
+
+    DisplayRotation rotation_{DISPLAY_ROTATION_0_DEGREES};
+    optional<display_writer_t> writer_{};
+    DisplayPage *page_{nullptr};
+    bool auto_clear_enabled_{true};
+    std::vector<Rect> clipping_rectangle_;
+};
+
+class DisplayBuffer : public Display
+{
+  public:
+    uint8_t *get_buffer() { return this->buffer_; }
+
+    void draw_pixel_at(int x, int y, Color color) override;
+
+    int get_width() override;
+    int get_height() override;
+
+  protected:
+    virtual void draw_absolute_pixel_internal(int x, int y, Color color) = 0;
+
+    void init_internal_(uint32_t buffer_length);
+
+    uint8_t *buffer_{nullptr};
+};
+
+class ColorUtil
+{
+  public:
+    static Color to_color(uint32_t colorcode, ColorOrder color_order, ColorBitness color_bitness = COLOR_BITNESS_888,
+                          bool right_bit_aligned = true);
+
+    static inline uint8_t esp_scale(uint8_t i, uint8_t scale, uint8_t max_value = 255) { return (max_value * i / scale); }
+};
+
+} // namespace display
+} // namespace esphome
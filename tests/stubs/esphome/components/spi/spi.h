@@ -0,0 +1,117 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/core/gpio.h"
+#include "esphome/core/helpers.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+namespace esphome {
+namespace spi {
+
+enum SPIBitOrder { BIT_ORDER_LSB_FIRST, BIT_ORDER_MSB_FIRST };
+enum SPIClockPolarity { CLOCK_POLARITY_LOW = false, CLOCK_POLARITY_HIGH = true };
+enum SPIClockPhase { CLOCK_PHASE_LEADING, CLOCK_PHASE_TRAILING };
+enum SPIDataRate : uint32_t {
+    DATA_RATE_1KHZ = 1000,
+    DATA_RATE_1MHZ = 1000000,
+    DATA_RATE_8MHZ = 8000000,
+    DATA_RATE_10MHZ = 10000000,
+    DATA_RATE_20MHZ = 20000000,
+    DATA_RATE_40MHZ = 40000000,
+    DATA_RATE_80MHZ = 80000000,
+};
+
+/**
+ * @brief Device on the other end of the SPI bus of the host build
+ *
+ * The chip select is a plain GPIO pin of the driver: the device watches it itself.
+ */
+class HostBus
+{
+  public:
+    virtual ~HostBus() = default;
+    virtual void write(const uint8_t *data, size_t length) = 0;
+    virtual void transfer(uint8_t *data, size_t length) = 0;
+    virtual void set_data_rate(uint32_t rate) {}
+};
+
+// Device the SPI devices of the host build talk to, nullptr to drop the writes and read zeroes
+void set_host_bus(HostBus *bus);
+HostBus *get_host_bus();
+
+class SPIClient
+{
+  public:
+    virtual ~SPIClient() = default;
+    virtual void spi_setup();
+    virtual void spi_teardown() {}
+    void set_data_rate(uint32_t data_rate) { this->data_rate_ = data_rate; }
+
+  protected:
+    uint32_t data_rate_{1000000};
+};
+
+template<SPIBitOrder BIT_ORDER, SPIClockPolarity CLOCK_POLARITY, SPIClockPhase CLOCK_PHASE, SPIDataRate DATA_RATE>
+class SPIDevice : public SPIClient
+{
+  public:
+    SPIDevice() { this->data_rate_ = DATA_RATE; }
+
+    void enable() {}
+    void disable() {}
+
+    void write_byte(uint8_t data) { this->write_array(&data, 1); }
+
+    void write_byte16(uint16_t data)
+    {
+        uint8_t const bytes[2] = {static_cast<uint8_t>(data >> 8), static_cast<uint8_t>(data)};
+        this->write_array(bytes, 2);
+    }
+
+    void write_array(const uint8_t *data, size_t length)
+    {
+        if (get_host_bus() != nullptr)
+        {
+            get_host_bus()->write(data, length);
+        }
+    }
+
+    void transfer_array(uint8_t *data, size_t length)
+    {
+        if (get_host_bus() != nullptr)
+        {
+            get_host_bus()->transfer(data, length);
+        }
+        else
+        {
+            for (size_t i = 0; i < length; i++)
+            {
+                data[i] = 0;
+            }
+        }
+    }
+
+    uint8_t read_byte()
+    {
+        uint8_t data = 0;
+        this->transfer_array(&data, 1);
+        return data;
+    }
+
+    void read_array(uint8_t *data, size_t length)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            data[i] = 0;
+        }
+        this->transfer_array(data, length);
+    }
+};
+
+} // namespace spi
+} // namespace esphome
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <functional>
+
+namespace esphome {
+
+template<typename... Ts> class Action
+{
+  public:
+    virtual ~Action() = default;
+    virtual void play(Ts... x) = 0;
+};
+
+template<typename T, typename... X> class TemplatableValue
+{
+  public:
+    TemplatableValue() {}
+    TemplatableValue(T value) : value_(value) {}
+    template<typename F> TemplatableValue(F f) : f_(f), lambda_(true) {}
+
+    T value(X... x) { return this->lambda_ ? this->f_(x...) : this->value_; }
+
+  private:
+    T value_{};
+    std::function<T(X...)> f_;
+    bool lambda_{false};
+};
+
+} // namespace esphome
+
+#define TEMPLATABLE_VALUE(type, name) \
+  protected: \
+    TemplatableValue<type, Ts...> name##_{}; \
+\
+  public: \
+    template<typename V> void set_##name(V name) { this->name##_ = name; }
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace esphome {
+
+struct Color {
+    union {
+        struct {
+            union {
+                uint8_t r;
+                uint8_t red;
+            };
+            union {
+                uint8_t g;
+                uint8_t green;
+            };
+            union {
+                uint8_t b;
+                uint8_t blue;
+            };
+            union {
+                uint8_t w;
+                uint8_t white;
+            };
+        };
+        uint8_t raw[4];
+        uint32_t raw_32;
+    };
+
+    constexpr Color() : raw_32(0) {}
+    constexpr Color(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue), w(0) {}
+    constexpr Color(uint8_t red, uint8_t green, uint8_t blue, uint8_t white) : r(red), g(green), b(blue), w(white) {}
+
+    bool operator==(const Color &rhs) const { return this->raw_32 == rhs.raw_32; }
+    bool operator!=(const Color &rhs) const { return this->raw_32 != rhs.raw_32; }
+};
+
+static const Color COLOR_BLACK(0, 0, 0, 0);
+static const Color COLOR_WHITE(255, 255, 255, 255);
+
+} // namespace esphome
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "esphome/core/hal.h"
+
+#include <functional>
+#include <string>
+
+namespace esphome {
+
+namespace setup_priority {
+extern const float HARDWARE;
+extern const float PROCESSOR;
+extern const float DATA;
+} // namespace setup_priority
+
+class Component
+{
+  public:
+    virtual ~Component() = default;
+    virtual void setup() {}
+    virtual void loop() {}
+    virtual void dump_config() {}
+    virtual float get_setup_priority() const { return 0.0f; }
+    virtual float get_loop_priority() const { return 0.0f; }
+    virtual void on_shutdown() {}
+    virtual void on_safe_shutdown() {}
+
+    void mark_failed() { this->failed_ = true; }
+    bool is_failed() const { return this->failed_; }
+
+  private:
+    bool failed_{false};
+};
+
+class PollingComponent : public Component
+{
+  public:
+    virtual void update() = 0;
+    void set_update_interval(uint32_t interval) { this->update_interval_ = interval; }
+    uint32_t get_update_interval() const { return this->update_interval_; }
+
+  protected:
+    uint32_t update_interval_{0};
+};
+
+} // namespace esphome
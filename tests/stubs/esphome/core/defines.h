@@ -0,0 +1,4 @@
+#pragma once
+// Host build of the IT8951E driver tests
+
+#define USE_HOST
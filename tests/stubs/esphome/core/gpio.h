@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+namespace esphome {
+
+namespace gpio {
+enum Flags : uint8_t {
+    FLAG_NONE = 0x00,
+    FLAG_INPUT = 0x01,
+    FLAG_OUTPUT = 0x02,
+    FLAG_OPEN_DRAIN = 0x04,
+    FLAG_PULLUP = 0x08,
+    FLAG_PULLDOWN = 0x10,
+};
+} // namespace gpio
+
+class GPIOPin
+{
+  public:
+    virtual ~GPIOPin() = default;
+    virtual void setup() = 0;
+    virtual void pin_mode(gpio::Flags flags) = 0;
+    virtual bool digital_read() = 0;
+    virtual void digital_write(bool value) = 0;
+    virtual std::string dump_summary() const = 0;
+    virtual bool is_internal() { return false; }
+};
+
+} // namespace esphome
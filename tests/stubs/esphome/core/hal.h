@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+#define HOT __attribute__((hot))
+#define ESPHOME_ALWAYS_INLINE __attribute__((always_inline))
+
+namespace esphome {
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+void arch_feed_wdt();
+
+namespace host {
+
+/**
+ * @brief Virtual clock of the host build
+ *
+ * Time only moves when the code does something that takes time on the device: the delays advance it by their
+ * duration without sleeping, reading it costs CLOCK_READ_NS, and the simulated peripherals advance it for their
+ * bus transfers and pin accesses. Timeouts, refresh timings and benchmarks do not depend on the speed of the host.
+ */
+static constexpr uint32_t CLOCK_READ_NS = 50;
+
+uint32_t now_us();
+uint64_t now_ns();
+void advance_us(uint32_t us);
+void advance_ns(uint64_t ns);
+
+} // namespace host
+} // namespace esphome
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <mutex>
+#include <new>
+#include <string>
+
+namespace esphome {
+
+uint32_t fnv1_hash(const std::string &str);
+
+template<class T> class Parented
+{
+  public:
+    Parented() {}
+    Parented(T *parent) : parent_(parent) {}
+    T *get_parent() const { return this->parent_; }
+    void set_parent(T *parent) { this->parent_ = parent; }
+
+  protected:
+    T *parent_{nullptr};
+};
+
+class Mutex
+{
+  public:
+    void lock() { this->mutex_.lock(); }
+    bool try_lock() { return this->mutex_.try_lock(); }
+    void unlock() { this->mutex_.unlock(); }
+
+  private:
+    std::mutex mutex_;
+};
+
+class LockGuard
+{
+  public:
+    LockGuard(Mutex &mutex) : mutex_(mutex) { this->mutex_.lock(); }
+    ~LockGuard() { this->mutex_.unlock(); }
+
+  private:
+    Mutex &mutex_;
+};
+
+/**
+ * @brief Allocator of the host build: there is no PSRAM, allocations come from the heap
+ *
+ * host::fail_external_allocations() makes the next allocations fail, like a board without PSRAM.
+ */
+namespace host {
+void fail_external_allocations(bool fail);
+bool external_allocations_fail();
+} // namespace host
+
+template<class T> class RAMAllocator
+{
+  public:
+    enum Flags { NONE = 0, ALLOC_EXTERNAL = 1 << 0, ALLOC_INTERNAL = 1 << 1, ALLOW_FAILURE = 1 << 2 };
+
+    RAMAllocator(uint8_t flags = NONE) : flags_(flags) {}
+
+    T *allocate(size_t n)
+    {
+        if ((this->flags_ & ALLOC_EXTERNAL) && host::external_allocations_fail())
+        {
+            return nullptr;
+        }
+        return new (std::nothrow) T[n];
+    }
+
+    void deallocate(T *p, size_t n) { delete[] p; }
+
+  private:
+    uint8_t flags_;
+};
+
+template<class T> class ExternalRAMAllocator : public RAMAllocator<T>
+{
+  public:
+    enum Flags { NONE = 0, ALLOW_FAILURE = RAMAllocator<T>::ALLOW_FAILURE };
+
+    ExternalRAMAllocator(Flags flags = NONE) : RAMAllocator<T>(RAMAllocator<T>::ALLOC_EXTERNAL | flags) {}
+};
+
+} // namespace esphome
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "esphome/core/hal.h"
+
+namespace esphome {
+
+enum LogLevel { ESPHOME_LOG_LEVEL_ERROR = 1, ESPHOME_LOG_LEVEL_WARN, ESPHOME_LOG_LEVEL_INFO, ESPHOME_LOG_LEVEL_CONFIG,
+                ESPHOME_LOG_LEVEL_DEBUG, ESPHOME_LOG_LEVEL_VERBOSE };
+
+void esp_log_printf_(int level, const char *tag, int line, const char *format, ...) __attribute__((format(printf, 4, 5)));
+
+namespace host {
+
+// Log messages of this level and below are printed. Errors and warnings by default.
+void set_log_level(int level);
+
+// Number of error messages logged since the last call
+uint32_t take_error_count();
+
+} // namespace host
+} // namespace esphome
+
+#define ESP_LOGE(tag, ...) ::esphome::esp_log_printf_(::esphome::ESPHOME_LOG_LEVEL_ERROR, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) ::esphome::esp_log_printf_(::esphome::ESPHOME_LOG_LEVEL_WARN, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ::esphome::esp_log_printf_(::esphome::ESPHOME_LOG_LEVEL_INFO, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) ::esphome::esp_log_printf_(::esphome::ESPHOME_LOG_LEVEL_CONFIG, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) ::esphome::esp_log_printf_(::esphome::ESPHOME_LOG_LEVEL_DEBUG, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) ::esphome::esp_log_printf_(::esphome::ESPHOME_LOG_LEVEL_VERBOSE, tag, __LINE__, __VA_ARGS__)
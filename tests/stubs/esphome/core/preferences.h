@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <map>
+#include <vector>
+
+namespace esphome {
+
+/**
+ * @brief Preference of the host build, kept in memory across the instances of the driver
+ */
+class ESPPreferenceObject
+{
+  public:
+    ESPPreferenceObject() {}
+    ESPPreferenceObject(std::vector<uint8_t> *data) : data_(data) {}
+
+    template<typename T> bool save(const T *src)
+    {
+        if (this->data_ == nullptr)
+        {
+            return false;
+        }
+        this->data_->assign(reinterpret_cast<const uint8_t *>(src), reinterpret_cast<const uint8_t *>(src) + sizeof(T));
+        return true;
+    }
+
+    template<typename T> bool load(T *dest)
+    {
+        if ((this->data_ == nullptr) || (this->data_->size() != sizeof(T)))
+        {
+            return false;
+        }
+        memcpy(dest, this->data_->data(), sizeof(T));
+        return true;
+    }
+
+  private:
+    std::vector<uint8_t> *data_{nullptr};
+};
+
+class ESPPreferences
+{
+  public:
+    template<typename T> ESPPreferenceObject make_preference(uint32_t type, bool in_flash)
+    {
+        return ESPPreferenceObject(&this->data_[type]);
+    }
+    template<typename T> ESPPreferenceObject make_preference(uint32_t type) { return this->make_preference<T>(type, false); }
+
+    void reset() { this->data_.clear(); }
+
+  private:
+    std::map<uint32_t, std::vector<uint8_t>> data_;
+};
+
+extern ESPPreferences *global_preferences;
+
+} // namespace esphome
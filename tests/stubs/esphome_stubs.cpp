@@ -0,0 +1,450 @@
+// Host implementations of the ESPHome APIs used by the IT8951E driver. The display functions follow the ESPHome
+// implementations, so the driver's overrides are tested against the behaviour they replace.
+
+#include "esphome/components/display/display_buffer.h"
+#include "esphome/components/spi/spi.h"
+#include "esphome/core/application.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <thread>
+
+namespace esphome {
+
+// Clock
+
+static std::atomic<uint64_t> clock_ns{0};
+
+uint64_t host::now_ns() { return clock_ns.load(); }
+
+uint32_t host::now_us() { return static_cast<uint32_t>(clock_ns.load() / 1000); }
+
+void host::advance_ns(uint64_t const ns) { clock_ns.fetch_add(ns); }
+
+void host::advance_us(uint32_t const us) { clock_ns.fetch_add(static_cast<uint64_t>(us) * 1000); }
+
+uint32_t micros() { return static_cast<uint32_t>((clock_ns.fetch_add(host::CLOCK_READ_NS) + host::CLOCK_READ_NS) / 1000); }
+
+uint32_t millis() { return micros() / 1000; }
+
+void delay(uint32_t const ms)
+{
+    host::advance_us(ms * 1000);
+    std::this_thread::yield();
+}
+
+void delayMicroseconds(uint32_t const us) { host::advance_us(us); }
+
+void yield() { std::this_thread::yield(); }
+
+void arch_feed_wdt() {}
+
+// Logging
+
+static std::atomic<int> log_level{ESPHOME_LOG_LEVEL_WARN};
+static std::atomic<uint32_t> error_count{0};
+
+void host::set_log_level(int const level) { log_level = level; }
+
+uint32_t host::take_error_count() { return error_count.exchange(0); }
+
+void esp_log_printf_(int const level, const char * const tag, int const line, const char * const format, ...)
+{
+    if (level == ESPHOME_LOG_LEVEL_ERROR)
+    {
+        error_count++;
+    }
+
+    if (level > log_level)
+    {
+        return;
+    }
+
+    static const char * const LEVELS[] = {"", "E", "W", "I", "C", "D", "V"};
+    fprintf(stderr, "[%s][%s:%d]: ", LEVELS[level], tag, line);
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+// Helpers
+
+static bool fail_external = false;
+
+void host::fail_external_allocations(bool const fail) { fail_external = fail; }
+
+bool host::external_allocations_fail() { return fail_external; }
+
+uint32_t fnv1_hash(const std::string &str)
+{
+    uint32_t hash = 2166136261UL;
+    for (char const c : str)
+    {
+        hash *= 16777619UL;
+        hash ^= c;
+    }
+    return hash;
+}
+
+// Application
+
+namespace setup_priority {
+const float HARDWARE = 800.0f;
+const float PROCESSOR = 400.0f;
+const float DATA = 600.0f;
+} // namespace setup_priority
+
+Application App;
+
+void Application::feed_wdt() { arch_feed_wdt(); }
+
+static ESPPreferences preferences;
+ESPPreferences *global_preferences = &preferences;
+
+// SPI
+
+namespace spi {
+
+static HostBus *host_bus = nullptr;
+
+void set_host_bus(HostBus * const bus) { host_bus = bus; }
+
+HostBus *get_host_bus() { return host_bus; }
+
+void SPIClient::spi_setup()
+{
+    if (host_bus != nullptr)
+    {
+        host_bus->set_data_rate(this->data_rate_);
+    }
+}
+
+} // namespace spi
+
+// Display
+
+namespace display {
+
+void Rect::shrink(Rect rect)
+{
+    if (!this->inside(rect))
+    {
+        (*this) = Rect();
+        return;
+    }
+
+    if (this->x2() > rect.x2())
+    {
+        this->w = rect.x2() - this->x;
+    }
+    if (this->x < rect.x)
+    {
+        this->w += this->x - rect.x;
+        this->x = rect.x;
+    }
+    if (this->y2() > rect.y2())
+    {
+        this->h = rect.y2() - this->y;
+    }
+    if (this->y < rect.y)
+    {
+        this->h += this->y - rect.y;
+        this->y = rect.y;
+    }
+}
+
+bool Rect::inside(int16_t const test_x, int16_t const test_y, bool const absolute) const
+{
+    if (!this->is_set())
+    {
+        return true;
+    }
+    if (absolute)
+    {
+        return (test_x >= this->x) && (test_x < this->x2()) && (test_y >= this->y) && (test_y < this->y2());
+    }
+    return (test_x >= 0) && (test_x < this->w) && (test_y >= 0) && (test_y < this->h);
+}
+
+bool Rect::inside(Rect const rect) const
+{
+    if (!this->is_set() || !rect.is_set())
+    {
+        return true;
+    }
+    return (this->x2() >= rect.x) && (this->x <= rect.x2()) && (this->y2() >= rect.y) && (this->y <= rect.y2());
+}
+
+void Display::fill(Color const color) { this->filled_rectangle(0, 0, this->get_width(), this->get_height(), color); }
+
+void Display::clear() { this->fill(COLOR_OFF); }
+
+void Display::line(int x1, int y1, int const x2, int const y2, Color const color)
+{
+    int32_t const dx = abs(x2 - x1);
+    int32_t const sx = (x1 < x2) ? 1 : -1;
+    int32_t const dy = -abs(y2 - y1);
+    int32_t const sy = (y1 < y2) ? 1 : -1;
+    int32_t err = dx + dy;
+
+    while (true)
+    {
+        this->draw_pixel_at(x1, y1, color);
+        if ((x1 == x2) && (y1 == y2))
+        {
+            break;
+        }
+        int32_t const e2 = 2 * err;
+        if (e2 >= dy)
+        {
+            err += dy;
+            x1 += sx;
+        }
+        if (e2 <= dx)
+        {
+            err += dx;
+            y1 += sy;
+        }
+    }
+}
+
+void Display::horizontal_line(int const x, int const y, int const width, Color const color)
+{
+    for (int i = x; i < x + width; i++)
+    {
+        this->draw_pixel_at(i, y, color);
+    }
+}
+
+void Display::vertical_line(int const x, int const y, int const height, Color const color)
+{
+    for (int i = y; i < y + height; i++)
+    {
+        this->draw_pixel_at(x, i, color);
+    }
+}
+
+void Display::rectangle(int const x1, int const y1, int const width, int const height, Color const color)
+{
+    this->horizontal_line(x1, y1, width, color);
+    this->horizontal_line(x1, y1 + height - 1, width, color);
+    this->vertical_line(x1, y1, height, color);
+    this->vertical_line(x1 + width - 1, y1, height, color);
+}
+
+void Display::filled_rectangle(int const x1, int const y1, int const width, int const height, Color const color)
+{
+    for (int i = y1; i < y1 + height; i++)
+    {
+        this->horizontal_line(x1, i, width, color);
+    }
+}
+
+void Display::draw_pixels_at(int const x_start, int const y_start, int const w, int const h, const uint8_t * const ptr,
+                             ColorOrder const order, ColorBitness const bitness, bool const big_endian, int const x_offset,
+                             int const y_offset, int const x_pad)
+{
+    size_t const line_stride = x_offset + w + x_pad;
+    uint32_t color_value;
+    for (int y = 0; y != h; y++)
+    {
+        size_t source_idx = (y_offset + y) * line_stride + x_offset;
+        size_t source_idx_mod;
+        for (int x = 0; x != w; x++, source_idx++)
+        {
+            switch (bitness)
+            {
+                default:
+                    color_value = ptr[source_idx];
+                    break;
+                case COLOR_BITNESS_565:
+                    source_idx_mod = source_idx * 2;
+                    if (big_endian)
+                    {
+                        color_value = (ptr[source_idx_mod] << 8) + ptr[source_idx_mod + 1];
+                    }
+                    else
+                    {
+                        color_value = ptr[source_idx_mod] + (ptr[source_idx_mod + 1] << 8);
+                    }
+                    break;
+                case COLOR_BITNESS_888:
+                    source_idx_mod = source_idx * 3;
+                    if (big_endian)
+                    {
+                        color_value = (ptr[source_idx_mod + 0] << 16) + (ptr[source_idx_mod + 1] << 8) + ptr[source_idx_mod + 2];
+                    }
+                    else
+                    {
+                        color_value = ptr[source_idx_mod + 0] + (ptr[source_idx_mod + 1] << 8) + (ptr[source_idx_mod + 2] << 16);
+                    }
+                    break;
+            }
+            this->draw_pixel_at(x + x_start, y + y_start, ColorUtil::to_color(color_value, order, bitness));
+        }
+    }
+}
+
+void Display::start_clipping(Rect rect)
+{
+    if (!this->clipping_rectangle_.empty())
+    {
+        rect.shrink(this->clipping_rectangle_.back());
+    }
+    this->clipping_rectangle_.push_back(rect);
+}
+
+void Display::end_clipping()
+{
+    if (!this->clipping_rectangle_.empty())
+    {
+        this->clipping_rectangle_.pop_back();
+    }
+}
+
+Rect Display::get_clipping() const
+{
+    return this->clipping_rectangle_.empty() ? Rect() : this->clipping_rectangle_.back();
+}
+
+void Display::do_update_()
+{
+    if (this->auto_clear_enabled_)
+    {
+        this->clear();
+    }
+    if (this->page_ != nullptr)
+    {
+        this->page_->get_writer()(*this);
+    }
+    else if (this->writer_.has_value())
+    {
+        (*this->writer_)(*this);
+    }
+    this->clear_clipping_();
+}
+
+void DisplayBuffer::draw_pixel_at(int x, int y, Color const color)
+{
+    if (!this->get_clipping().inside(x, y))
+    {
+        return;
+    }
+
+    switch (this->rotation_)
+    {
+        case DISPLAY_ROTATION_0_DEGREES:
+            break;
+        case DISPLAY_ROTATION_90_DEGREES:
+            std::swap(x, y);
+            x = this->get_width_internal() - x - 1;
+            break;
+        case DISPLAY_ROTATION_180_DEGREES:
+            x = this->get_width_internal() - x - 1;
+            y = this->get_height_internal() - y - 1;
+            break;
+        case DISPLAY_ROTATION_270_DEGREES:
+            std::swap(x, y);
+            y = this->get_height_internal() - y - 1;
+            break;
+    }
+    this->draw_absolute_pixel_internal(x, y, color);
+    App.feed_wdt();
+}
+
+int DisplayBuffer::get_width()
+{
+    switch (this->rotation_)
+    {
+        case DISPLAY_ROTATION_90_DEGREES:
+        case DISPLAY_ROTATION_270_DEGREES:
+            return this->get_height_internal();
+        default:
+            return this->get_width_internal();
+    }
+}
+
+int DisplayBuffer::get_height()
+{
+    switch (this->rotation_)
+    {
+        case DISPLAY_ROTATION_90_DEGREES:
+        case DISPLAY_ROTATION_270_DEGREES:
+            return this->get_width_internal();
+        default:
+            return this->get_height_internal();
+    }
+}
+
+void DisplayBuffer::init_internal_(uint32_t const buffer_length)
+{
+    RAMAllocator<uint8_t> allocator(RAMAllocator<uint8_t>::ALLOC_EXTERNAL);
+    this->buffer_ = allocator.allocate(buffer_length);
+}
+
+Color ColorUtil::to_color(uint32_t const colorcode, ColorOrder const color_order, ColorBitness const color_bitness,
+                          bool const right_bit_aligned)
+{
+    uint8_t first_bits = 8;
+    uint8_t second_bits = 8;
+    uint8_t third_bits = 8;
+
+    switch (color_bitness)
+    {
+        case COLOR_BITNESS_888:
+            break;
+        case COLOR_BITNESS_565:
+            first_bits = 5;
+            second_bits = 6;
+            third_bits = 5;
+            break;
+        case COLOR_BITNESS_332:
+            first_bits = 3;
+            second_bits = 3;
+            third_bits = 2;
+            break;
+    }
+
+    uint8_t const first_color = right_bit_aligned
+        ? esp_scale(((colorcode >> (second_bits + third_bits)) & ((1 << first_bits) - 1)), ((1 << first_bits) - 1))
+        : esp_scale(((colorcode >> 16) & 0xFF), (1 << first_bits) - 1);
+    uint8_t const second_color = right_bit_aligned
+        ? esp_scale(((colorcode >> third_bits) & ((1 << second_bits) - 1)), ((1 << second_bits) - 1))
+        : esp_scale(((colorcode >> 8) & 0xFF), ((1 << second_bits) - 1));
+    uint8_t const third_color = right_bit_aligned
+        ? esp_scale(((colorcode >> 0) & ((1 << third_bits) - 1)), ((1 << third_bits) - 1))
+        : esp_scale(((colorcode >> 0) & 0xFF), (1 << third_bits) - 1);
+
+    Color color;
+    switch (color_order)
+    {
+        case COLOR_ORDER_RGB:
+            color.r = first_color;
+            color.g = second_color;
+            color.b = third_color;
+            break;
+        case COLOR_ORDER_BGR:
+            color.b = first_color;
+            color.g = second_color;
+            color.r = third_color;
+            break;
+        case COLOR_ORDER_GRB:
+            color.g = first_color;
+            color.r = second_color;
+            color.b = third_color;
+            break;
+    }
+    return color;
+}
+
+} // namespace display
+} // namespace esphome
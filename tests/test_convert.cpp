@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "it8951e_convert.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace esphome {
+namespace it8951e {
+namespace {
+
+/**
+ * @brief Gray level of a source pixel the way the generic path computes it: Display::draw_pixels_at decodes the
+ * pixel with ColorUtil::to_color, and the driver weighs the channels of the color
+ */
+uint8_t reference_level(uint8_t const *pixel, display::ColorOrder const order, display::ColorBitness const bitness,
+                        bool const big_endian, bool const reversed)
+{
+    uint32_t value;
+    switch (bitness)
+    {
+        case display::COLOR_BITNESS_565:
+            value = big_endian ? ((pixel[0] << 8) | pixel[1]) : (pixel[0] | (pixel[1] << 8));
+            break;
+        case display::COLOR_BITNESS_888:
+            value = big_endian ? ((pixel[0] << 16) | (pixel[1] << 8) | pixel[2]) : (pixel[0] | (pixel[1] << 8) | (pixel[2] << 16));
+            break;
+        default:
+            value = pixel[0];
+            break;
+    }
+
+    Color const color = display::ColorUtil::to_color(value, order, bitness);
+    uint8_t const level = ((color.r * 77) + (color.g * 151) + (color.b * 28)) >> 12;
+    return reversed ? ((~level) & 0x0F) : level;
+}
+
+size_t bytes_per_pixel(display::ColorBitness const bitness)
+{
+    switch (bitness)
+    {
+        case display::COLOR_BITNESS_565:
+            return 2;
+        case display::COLOR_BITNESS_332:
+            return 1;
+        default:
+            return 3;
+    }
+}
+
+uint8_t get_level(std::vector<uint8_t> const &line, size_t const x)
+{
+    return (x & 1) ? (line[x >> 1] & 0x0F) : (line[x >> 1] >> 4);
+}
+
+struct Format {
+    display::ColorOrder order;
+    display::ColorBitness bitness;
+    bool big_endian;
+    bool reversed;
+};
+
+class ConvertRow : public ::testing::TestWithParam<Format>
+{
+};
+
+TEST_P(ConvertRow, MatchesTheGenericPath)
+{
+    Format const format = GetParam();
+    PixelConverter converter;
+    converter.configure(format.order, format.bitness, format.big_endian, format.reversed);
+
+    size_t const bpp = bytes_per_pixel(format.bitness);
+    EXPECT_EQ(converter.get_bytes_per_pixel(), bpp);
+
+    std::mt19937 random(51);
+    constexpr uint16_t LINE_PIXELS = 64;
+
+    // Even and odd start and end columns
+    for (uint16_t const x : {0, 1, 6, 7})
+    {
+        for (uint16_t const count : {1, 2, 15, 16, 57})
+        {
+            std::vector<uint8_t> source(count * bpp);
+            for (uint8_t &byte : source)
+            {
+                byte = random();
+            }
+
+            std::vector<uint8_t> line(LINE_PIXELS / 2, 0xA5);
+            converter.convert_row(source.data(), line.data(), x, count);
+
+            for (uint16_t i = 0; i < LINE_PIXELS; i++)
+            {
+                if ((i < x) || (i >= x + count))
+                {
+                    // Untouched neighbours
+                    EXPECT_EQ(get_level(line, i), (i & 1) ? 0x5 : 0xA) << "x " << x << " count " << count << " pixel " << i;
+                }
+                else
+                {
+                    uint8_t const expected = reference_level(source.data() + (i - x) * bpp, format.order, format.bitness,
+                                                             format.big_endian, format.reversed);
+                    EXPECT_EQ(get_level(line, i), expected) << "x " << x << " count " << count << " pixel " << i;
+                }
+            }
+        }
+    }
+}
+
+TEST_P(ConvertRow, CoversAllValuesOfTheChannels)
+{
+    Format const format = GetParam();
+    PixelConverter converter;
+    converter.configure(format.order, format.bitness, format.big_endian, format.reversed);
+    size_t const bpp = bytes_per_pixel(format.bitness);
+
+    // Every byte value in every position of the pixel
+    for (size_t position = 0; position < bpp; position++)
+    {
+        std::vector<uint8_t> source(256 * bpp, 0x3C);
+        for (size_t value = 0; value < 256; value++)
+        {
+            source[value * bpp + position] = value;
+        }
+
+        std::vector<uint8_t> line(128);
+        converter.convert_row(source.data(), line.data(), 0, 256);
+        for (size_t value = 0; value < 256; value++)
+        {
+            EXPECT_EQ(get_level(line, value), reference_level(source.data() + value * bpp, format.order, format.bitness,
+                                                              format.big_endian, format.reversed))
+                << "byte " << position << " value " << value;
+        }
+    }
+}
+
+std::vector<Format> all_formats()
+{
+    std::vector<Format> formats;
+    for (auto const order : {display::COLOR_ORDER_RGB, display::COLOR_ORDER_BGR, display::COLOR_ORDER_GRB})
+    {
+        for (auto const bitness : {display::COLOR_BITNESS_888, display::COLOR_BITNESS_565, display::COLOR_BITNESS_332})
+        {
+            for (bool const big_endian : {false, true})
+            {
+                for (bool const reversed : {false, true})
+                {
+                    formats.push_back(Format{order, bitness, big_endian, reversed});
+                }
+            }
+        }
+    }
+    return formats;
+}
+
+INSTANTIATE_TEST_SUITE_P(AllFormats, ConvertRow, ::testing::ValuesIn(all_formats()));
+
+TEST(PixelConverter, ReconfiguresOnFormatChange)
+{
+    PixelConverter converter;
+    uint8_t const white[3] = {0xFF, 0xFF, 0xFF};
+    uint8_t line[1] = {0};
+
+    converter.configure(display::COLOR_ORDER_RGB, display::COLOR_BITNESS_888, true, false);
+    converter.convert_row(white, line, 0, 1);
+    EXPECT_EQ(line[0] >> 4, 0x0F);
+
+    converter.configure(display::COLOR_ORDER_RGB, display::COLOR_BITNESS_888, true, true);
+    converter.convert_row(white, line, 0, 1);
+    EXPECT_EQ(line[0] >> 4, 0x00);
+
+    converter.configure(display::COLOR_ORDER_RGB, display::COLOR_BITNESS_565, true, false);
+    EXPECT_EQ(converter.get_bytes_per_pixel(), 2u);
+}
+
+} // namespace
+} // namespace it8951e
+} // namespace esphome
@@ -0,0 +1,238 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "it8951e_dirty.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace esphome {
+namespace it8951e {
+namespace {
+
+constexpr uint16_t WIDTH = 960;
+constexpr uint16_t HEIGHT = 540;
+
+bool overlap(Area const &a, Area const &b)
+{
+    return !(((a.x + a.w) <= b.x) || ((b.x + b.w) <= a.x) || ((a.y + a.h) <= b.y) || ((b.y + b.h) <= a.y));
+}
+
+bool contains(Area const &area, uint16_t const x, uint16_t const y)
+{
+    return (x >= area.x) && (x < area.x + area.w) && (y >= area.y) && (y < area.y + area.h);
+}
+
+bool covered(Area const * const areas, size_t const count, uint16_t const x, uint16_t const y)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (contains(areas[i], x, y))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void expect_valid(Area const * const areas, size_t const count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        EXPECT_GT(areas[i].w, 0);
+        EXPECT_GT(areas[i].h, 0);
+        EXPECT_EQ(areas[i].x % 4, 0) << "area " << i;
+        EXPECT_EQ(areas[i].w % 4, 0) << "area " << i;
+        EXPECT_LE(areas[i].x + areas[i].w, WIDTH);
+        EXPECT_LE(areas[i].y + areas[i].h, HEIGHT);
+        for (size_t j = i + 1; j < count; j++)
+        {
+            EXPECT_FALSE(overlap(areas[i], areas[j])) << "areas " << i << " and " << j;
+        }
+    }
+}
+
+TEST(DirtyTracker, StartsEmpty)
+{
+    DirtyTracker tracker;
+    tracker.init(WIDTH, HEIGHT);
+    EXPECT_TRUE(tracker.empty());
+
+    Area areas[DirtyTracker::MAX_AREAS];
+    EXPECT_EQ(tracker.extract(areas, DirtyTracker::MAX_AREAS, 0), 0u);
+}
+
+TEST(DirtyTracker, TilesFitTheBitmap)
+{
+    DirtyTracker tracker;
+    tracker.init(WIDTH, HEIGHT);
+    EXPECT_EQ(tracker.get_tile_width(), 16);
+    EXPECT_EQ(tracker.get_tile_height(), 8);
+
+    tracker.init(2048, 2048);
+    EXPECT_EQ(tracker.get_tile_width(), 32);
+    EXPECT_EQ(tracker.get_tile_height(), 16);
+}
+
+TEST(DirtyTracker, ExtractsTheMarkedTiles)
+{
+    DirtyTracker tracker;
+    tracker.init(WIDTH, HEIGHT);
+    tracker.mark(20, 10, 30, 5);
+    EXPECT_FALSE(tracker.empty());
+
+    Area areas[DirtyTracker::MAX_AREAS];
+    ASSERT_EQ(tracker.extract(areas, DirtyTracker::MAX_AREAS, 0), 1u);
+    EXPECT_EQ(areas[0].x, 16);
+    EXPECT_EQ(areas[0].y, 8);
+    EXPECT_EQ(areas[0].w, 48);
+    EXPECT_EQ(areas[0].h, 8);
+
+    // Extracting marks all tiles clean
+    EXPECT_TRUE(tracker.empty());
+    EXPECT_EQ(tracker.extract(areas, DirtyTracker::MAX_AREAS, 0), 0u);
+}
+
+TEST(DirtyTracker, MarksSinglePixels)
+{
+    DirtyTracker tracker;
+    tracker.init(WIDTH, HEIGHT);
+    tracker.mark_pixel(WIDTH - 1, HEIGHT - 1);
+
+    Area areas[DirtyTracker::MAX_AREAS];
+    ASSERT_EQ(tracker.extract(areas, DirtyTracker::MAX_AREAS, 0), 1u);
+    EXPECT_TRUE(contains(areas[0], WIDTH - 1, HEIGHT - 1));
+    expect_valid(areas, 1);
+}
+
+TEST(DirtyTracker, ClipsToTheDisplay)
+{
+    DirtyTracker tracker;
+    tracker.init(WIDTH, HEIGHT);
+    tracker.mark(WIDTH - 10, HEIGHT - 10, 100, 100);
+    tracker.mark(WIDTH, 0, 10, 10);
+    tracker.mark(0, 0, 0, 10);
+
+    Area areas[DirtyTracker::MAX_AREAS];
+    ASSERT_EQ(tracker.extract(areas, DirtyTracker::MAX_AREAS, 0), 1u);
+    EXPECT_EQ(areas[0].x + areas[0].w, WIDTH);
+    EXPECT_EQ(areas[0].y + areas[0].h, HEIGHT);
+}
+
+TEST(DirtyTracker, KeepsDistantAreasApartWithoutOverhead)
+{
+    DirtyTracker tracker;
+    tracker.init(WIDTH, HEIGHT);
+    tracker.mark(0, 0, 16, 8);
+    tracker.mark(WIDTH - 16, HEIGHT - 8, 16, 8);
+
+    Area areas[DirtyTracker::MAX_AREAS];
+    EXPECT_EQ(tracker.extract(areas, DirtyTracker::MAX_AREAS, 0), 2u);
+}
+
+TEST(DirtyTracker, MergesNearbyAreasWhenCheaper)
+{
+    DirtyTracker tracker;
+    tracker.init(WIDTH, HEIGHT);
+    tracker.mark(0, 0, 16, 8);
+    tracker.mark(32, 0, 16, 8);
+
+    // The gap costs 64 bytes, less than the overhead of one more area
+    Area areas[DirtyTracker::MAX_AREAS];
+    ASSERT_EQ(tracker.extract(areas, DirtyTracker::MAX_AREAS, 1024), 1u);
+    EXPECT_EQ(areas[0].x, 0);
+    EXPECT_EQ(areas[0].w, 48);
+}
+
+TEST(DirtyTracker, MergesStacksOfIdenticalRuns)
+{
+    DirtyTracker tracker;
+    tracker.init(WIDTH, HEIGHT);
+    for (uint16_t y = 40; y < 120; y++)
+    {
+        tracker.mark_pixel(100, y);
+        tracker.mark_pixel(140, y);
+    }
+
+    Area areas[DirtyTracker::MAX_AREAS];
+    ASSERT_EQ(tracker.extract(areas, DirtyTracker::MAX_AREAS, 0), 2u);
+    EXPECT_EQ(areas[0].h, 80);
+    EXPECT_EQ(areas[1].h, 80);
+}
+
+TEST(DirtyTracker, RespectsTheCapacity)
+{
+    DirtyTracker tracker;
+    tracker.init(WIDTH, HEIGHT);
+    for (uint16_t i = 0; i < 8; i++)
+    {
+        tracker.mark(i * 120, i * 64, 16, 8);
+    }
+
+    Area areas[DirtyTracker::MAX_AREAS];
+    size_t const count = tracker.extract(areas, 3, 0);
+    EXPECT_LE(count, 3u);
+    expect_valid(areas, count);
+    for (uint16_t i = 0; i < 8; i++)
+    {
+        EXPECT_TRUE(covered(areas, count, i * 120, i * 64)) << "mark " << i;
+    }
+    EXPECT_TRUE(tracker.empty());
+}
+
+TEST(DirtyTracker, ZeroCapacityDropsTheTiles)
+{
+    DirtyTracker tracker;
+    tracker.init(WIDTH, HEIGHT);
+    tracker.mark(0, 0, 100, 100);
+
+    Area areas[1];
+    EXPECT_EQ(tracker.extract(areas, 0, 0), 0u);
+    EXPECT_TRUE(tracker.empty());
+}
+
+TEST(DirtyTracker, RandomMarksAreCoveredByDisjointAreas)
+{
+    std::mt19937 random(8951);
+    for (uint32_t const overhead : {0u, 256u, 1024u, 65536u})
+    {
+        for (int round = 0; round < 50; round++)
+        {
+            DirtyTracker tracker;
+            tracker.init(WIDTH, HEIGHT);
+
+            std::vector<Area> marks;
+            int const count = 1 + random() % 40;
+            for (int i = 0; i < count; i++)
+            {
+                uint16_t const x = random() % WIDTH;
+                uint16_t const y = random() % HEIGHT;
+                uint16_t const w = 1 + random() % 120;
+                uint16_t const h = 1 + random() % 80;
+                tracker.mark(x, y, w, h);
+                marks.push_back(Area{x, y, static_cast<uint16_t>(std::min(w, static_cast<uint16_t>(WIDTH - x))),
+                                     static_cast<uint16_t>(std::min(h, static_cast<uint16_t>(HEIGHT - y)))});
+            }
+
+            Area areas[DirtyTracker::MAX_AREAS];
+            size_t const extracted = tracker.extract(areas, DirtyTracker::MAX_AREAS, overhead);
+            ASSERT_GE(extracted, 1u);
+            ASSERT_LE(extracted, DirtyTracker::MAX_AREAS);
+            expect_valid(areas, extracted);
+
+            for (Area const &mark : marks)
+            {
+                // Corners and center of each mark
+                EXPECT_TRUE(covered(areas, extracted, mark.x, mark.y));
+                EXPECT_TRUE(covered(areas, extracted, mark.x + mark.w - 1, mark.y + mark.h - 1));
+                EXPECT_TRUE(covered(areas, extracted, mark.x + mark.w / 2, mark.y + mark.h / 2));
+            }
+            EXPECT_TRUE(tracker.empty());
+        }
+    }
+}
+
+} // namespace
+} // namespace it8951e
+} // namespace esphome
@@ -0,0 +1,681 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// End to end tests of the driver against the simulated controller: the frames on the panel, and the protocol the
+// driver follows to get them there.
+
+#include "it8951e.h"
+#include "it8951e_simulator.h"
+
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace esphome {
+namespace it8951e {
+namespace {
+
+using Simulator = testing::Simulator;
+
+constexpr uint16_t WIDTH = 960;
+constexpr uint16_t HEIGHT = 540;
+
+Color const BLACK(0, 0, 0);
+Color const WHITE(255, 255, 255);
+Color const GRAY(0x55, 0x55, 0x55);  // Level 5, one of the DU4 levels
+Color const LIGHT(0x77, 0x77, 0x77);  // Level 7
+
+std::string describe(std::vector<std::string> const &errors)
+{
+    std::string text;
+    for (std::string const &error : errors)
+    {
+        text += error + "\n";
+    }
+    return text;
+}
+
+/**
+ * @brief Draw a solid rectangle as an image, through draw_pixels_at
+ */
+void draw_image(display::Display &it, int const x, int const y, int const w, int const h, Color const color)
+{
+    std::vector<uint8_t> pixels;
+    for (int i = 0; i < w * h; i++)
+    {
+        pixels.insert(pixels.end(), {color.r, color.g, color.b});
+    }
+    it.draw_pixels_at(x, y, w, h, pixels.data(), display::COLOR_ORDER_RGB, display::COLOR_BITNESS_888, true, 0, 0, 0);
+}
+
+/**
+ * @brief A display wired to a simulated controller, set up the way the generated code does it
+ */
+class Panel
+{
+    public:
+        Panel()
+        {
+            // Frames are drawn on top of the previous one, tests that want a blank frame fill it
+            this->display->set_auto_clear(false);
+        }
+
+        ~Panel()
+        {
+            if (this->flush_task)
+            {
+                // The flush task thread never ends: leave it the simulator it uses
+                this->simulator.release();
+            }
+        }
+
+        Simulator &sim() { return *this->simulator; }
+        IT8951EDisplay &get() { return *this->display; }
+
+        void use_flush_task()
+        {
+            this->flush_task = true;
+            this->display->set_flush_task(2, -1);
+        }
+
+        void setup()
+        {
+            this->display->set_reset_pin(this->simulator->get_reset_pin());
+            this->display->set_ready_pin(this->simulator->get_ready_pin());
+            this->display->set_cs_pin(this->simulator->get_cs_pin());
+            this->display->setup();
+            this->settle();
+            this->simulator->clear_log();
+        }
+
+        /**
+         * @brief Draw a frame and run the driver until it is on the panel
+         */
+        void draw(display::display_writer_t &&writer)
+        {
+            this->display->set_writer(std::move(writer));
+            this->display->update();
+            this->settle();
+        }
+
+        /**
+         * @brief Run loop() until the driver has nothing left to do
+         *
+         * The flush task advances the virtual clock itself as it transfers, so while it has a job the clock only
+         * moves in small steps, leaving its thread the time to run.
+         */
+        void settle()
+        {
+            for (int i = 0, steps = 0; (i < 2000) && (steps < 1000000); steps++)
+            {
+                this->display->loop();
+                if (this->flush_task && !this->idle())
+                {
+                    host::advance_us(100);
+                    std::this_thread::yield();
+                    continue;
+                }
+                host::advance_us(5000);
+                if ((++i > 100) && (this->sim().get_busy_luts() == 0) && this->idle())
+                {
+                    break;
+                }
+            }
+        }
+
+        bool idle()
+        {
+            // read_area fails while the flush task runs a job
+            uint8_t level;
+            return this->display->read_area(0, 0, 1, 1, &level);
+        }
+
+        uint8_t panel(uint16_t const x, uint16_t const y) const { return this->simulator->get_panel_level(x, y); }
+
+        size_t count_panel(uint16_t const x, uint16_t const y, uint16_t const w, uint16_t const h, uint8_t const level) const
+        {
+            size_t count = 0;
+            for (uint16_t row = y; row < y + h; row++)
+            {
+                for (uint16_t column = x; column < x + w; column++)
+                {
+                    count += this->panel(column, row) == level;
+                }
+            }
+            return count;
+        }
+
+        void expect_no_errors() const
+        {
+            EXPECT_TRUE(this->simulator->get_errors().empty()) << describe(this->simulator->get_errors());
+            EXPECT_EQ(host::take_error_count(), 0u);
+        }
+
+    private:
+        std::unique_ptr<Simulator> simulator{new Simulator(WIDTH, HEIGHT)};
+        // Like on the device, the display is never destroyed
+        IT8951EDisplay *display = new IT8951EDisplay();
+        bool flush_task = false;
+};
+
+class DisplayTest : public ::testing::Test
+{
+    protected:
+        Panel panel;
+
+        void SetUp() override
+        {
+            global_preferences->reset();
+            host::take_error_count();
+        }
+
+        void TearDown() override { this->panel.expect_no_errors(); }
+};
+
+TEST_F(DisplayTest, SetupClearsThePanel)
+{
+    this->panel.setup();
+
+    EXPECT_EQ(this->panel.sim().get_vcom(), 2300);
+    EXPECT_EQ(this->panel.get().get_width(), WIDTH);
+    EXPECT_EQ(this->panel.get().get_height(), HEIGHT);
+    EXPECT_EQ(this->panel.count_panel(0, 0, WIDTH, HEIGHT, 0x0F), static_cast<size_t>(WIDTH) * HEIGHT);
+    EXPECT_FALSE(this->panel.get().is_failed());
+}
+
+TEST_F(DisplayTest, DrawsImages)
+{
+    this->panel.setup();
+    this->panel.draw([](display::Display &it) {
+        draw_image(it, 100, 50, 200, 100, BLACK);
+        draw_image(it, 500, 301, 32, 17, GRAY);
+    });
+
+    EXPECT_EQ(this->panel.count_panel(100, 50, 200, 100, 0x00), 200u * 100u);
+    EXPECT_EQ(this->panel.count_panel(500, 301, 32, 17, 0x05), 32u * 17u);
+    EXPECT_EQ(this->panel.count_panel(0, 0, WIDTH, HEIGHT, 0x0F), static_cast<size_t>(WIDTH) * HEIGHT - 200 * 100 - 32 * 17);
+    EXPECT_FALSE(this->panel.sim().get_loads().empty());
+    EXPECT_FALSE(this->panel.sim().get_refreshes().empty());
+}
+
+TEST_F(DisplayTest, DrawsTheFrame)
+{
+    this->panel.setup();
+    this->panel.draw([](display::Display &it) {
+        it.fill(WHITE);
+        it.filled_rectangle(100, 50, 200, 100, BLACK);
+        it.filled_rectangle(501, 301, 33, 17, GRAY);
+    });
+
+    EXPECT_EQ(this->panel.count_panel(100, 50, 200, 100, 0x00), 200u * 100u);
+    EXPECT_EQ(this->panel.count_panel(501, 301, 33, 17, 0x05), 33u * 17u);
+    EXPECT_EQ(this->panel.count_panel(0, 0, WIDTH, HEIGHT, 0x0F), static_cast<size_t>(WIDTH) * HEIGHT - 200 * 100 - 33 * 17);
+    EXPECT_FALSE(this->panel.sim().get_loads().empty());
+    EXPECT_FALSE(this->panel.sim().get_refreshes().empty());
+}
+
+TEST_F(DisplayTest, SendsOnlyTheChangedAreas)
+{
+    this->panel.setup();
+    this->panel.draw([](display::Display &it) { it.filled_rectangle(600, 400, 20, 20, BLACK); });
+
+    size_t bytes = 0;
+    for (auto const &load : this->panel.sim().get_loads())
+    {
+        EXPECT_GE(load.x + load.w, 620);
+        EXPECT_LE(load.x, 600);
+        bytes += load.bytes;
+    }
+    EXPECT_LT(bytes, 4096u);
+    EXPECT_EQ(this->panel.count_panel(600, 400, 20, 20, 0x00), 400u);
+}
+
+TEST_F(DisplayTest, ReadsBackTheImage)
+{
+    this->panel.setup();
+
+    // A 4 x 2 gradient through the fast 888 path
+    uint8_t const pixels[] = {
+        0x00, 0x00, 0x00, 0x44, 0x44, 0x44, 0x88, 0x88, 0x88, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0x88, 0x88, 0x88, 0x44, 0x44, 0x44, 0x00, 0x00, 0x00,
+    };
+    this->panel.draw([&pixels](display::Display &it) {
+        it.draw_pixels_at(11, 7, 4, 2, pixels, display::COLOR_ORDER_RGB, display::COLOR_BITNESS_888, true, 0, 0, 0);
+    });
+
+    uint8_t levels[4 * 2];
+    ASSERT_TRUE(this->panel.get().read_area(11, 7, 4, 2, levels));
+    uint8_t const expected[] = {0x0, 0x4, 0x8, 0xF, 0xF, 0x8, 0x4, 0x0};
+    for (size_t i = 0; i < sizeof(expected); i++)
+    {
+        EXPECT_EQ(levels[i], expected[i]) << "pixel " << i;
+        EXPECT_EQ(this->panel.panel(11 + i % 4, 7 + i / 4), expected[i]) << "pixel " << i;
+    }
+
+    EXPECT_FALSE(this->panel.get().read_area(WIDTH - 1, 0, 2, 1, levels));
+}
+
+TEST_F(DisplayTest, UpdateModeFollowsTheContent)
+{
+    this->panel.setup();
+
+    this->panel.draw([](display::Display &it) { it.filled_rectangle(0, 0, 64, 64, BLACK); });
+    this->panel.draw([](display::Display &it) { it.filled_rectangle(200, 0, 64, 64, GRAY); });
+    this->panel.draw([](display::Display &it) { it.filled_rectangle(400, 0, 64, 64, LIGHT); });
+
+    auto const &refreshes = this->panel.sim().get_refreshes();
+    ASSERT_EQ(refreshes.size(), 3u);
+    EXPECT_EQ(refreshes[0].mode, static_cast<uint16_t>(UpdateMode::DU));
+    EXPECT_EQ(refreshes[1].mode, static_cast<uint16_t>(UpdateMode::DU4));
+    EXPECT_EQ(refreshes[2].mode, static_cast<uint16_t>(UpdateMode::GLR16));
+    EXPECT_EQ(this->panel.count_panel(400, 0, 64, 64, 0x07), 64u * 64u);
+}
+
+TEST_F(DisplayTest, UpdateModeRegionsOverrideTheContent)
+{
+    this->panel.get().add_update_mode_region(0, 0, 100, 100, UpdateMode::GC16);
+    this->panel.setup();
+
+    this->panel.draw([](display::Display &it) { it.filled_rectangle(40, 40, 120, 20, BLACK); });
+
+    uint16_t modes = 0;
+    for (auto const &refresh : this->panel.sim().get_refreshes())
+    {
+        modes |= 1u << refresh.mode;
+    }
+    EXPECT_EQ(modes, (1u << static_cast<uint16_t>(UpdateMode::GC16)) | (1u << static_cast<uint16_t>(UpdateMode::DU)));
+    EXPECT_EQ(this->panel.count_panel(40, 40, 120, 20, 0x00), 120u * 20u);
+}
+
+TEST_F(DisplayTest, WaitsForHrdy)
+{
+    this->panel.sim().set_hrdy_latency(3000);
+    this->panel.setup();
+    this->panel.draw([](display::Display &it) { draw_image(it, 40, 40, 60, 30, BLACK); });
+
+    EXPECT_EQ(this->panel.count_panel(40, 40, 60, 30, 0x00), 60u * 30u);
+    EXPECT_EQ(this->panel.count_panel(0, 0, WIDTH, HEIGHT, 0x00), 60u * 30u);
+}
+
+TEST_F(DisplayTest, FrameDiffSkipsUnchangedFrames)
+{
+    this->panel.get().set_frame_diff_memory_budget(WIDTH * HEIGHT);
+    this->panel.setup();
+
+    auto const writer = [](display::Display &it) { draw_image(it, 10, 10, 50, 50, BLACK); };
+    this->panel.draw(writer);
+    EXPECT_FALSE(this->panel.sim().get_loads().empty());
+
+    this->panel.sim().clear_log();
+    this->panel.draw(writer);
+    EXPECT_TRUE(this->panel.sim().get_loads().empty());
+    EXPECT_TRUE(this->panel.sim().get_refreshes().empty());
+}
+
+TEST_F(DisplayTest, TransferBufferKeepsTheImage)
+{
+    // Smaller than a row of the frame: the rows are sent in pieces
+    this->panel.get().set_transfer_buffer_size(100);
+    this->panel.setup();
+    this->panel.draw([](display::Display &it) {
+        it.filled_rectangle(0, 20, WIDTH, 30, BLACK);
+        it.filled_rectangle(333, 100, 77, 45, GRAY);
+    });
+
+    EXPECT_EQ(this->panel.count_panel(0, 20, WIDTH, 30, 0x00), WIDTH * 30u);
+    EXPECT_EQ(this->panel.count_panel(333, 100, 77, 45, 0x05), 77u * 45u);
+    EXPECT_EQ(this->panel.count_panel(0, 0, WIDTH, HEIGHT, 0x0F), static_cast<size_t>(WIDTH) * HEIGHT - WIDTH * 30 - 77 * 45);
+}
+
+TEST_F(DisplayTest, PackedTransfersKeepTheImage)
+{
+    this->panel.get().set_packed_transfers(true);
+    this->panel.get().set_transfer_buffer_size(4096);
+    this->panel.setup();
+
+    // Two levels, aligned to 32 pixels: 1bpp through the scratch area
+    this->panel.draw([](display::Display &it) {
+        it.filled_rectangle(64, 32, 128, 64, LIGHT);
+        it.filled_rectangle(96, 48, 32, 16, BLACK);
+    });
+    bool one_bpp = false;
+    for (auto const &refresh : this->panel.sim().get_refreshes())
+    {
+        one_bpp |= refresh.one_bpp;
+    }
+    EXPECT_TRUE(one_bpp);
+    EXPECT_EQ(this->panel.count_panel(64, 32, 128, 64, 0x07), 128u * 64u - 32u * 16u);
+    EXPECT_EQ(this->panel.count_panel(96, 48, 32, 16, 0x00), 32u * 16u);
+
+    // DU4 levels: 2bpp
+    this->panel.sim().clear_log();
+    this->panel.draw([](display::Display &it) { it.filled_rectangle(304, 200, 40, 8, GRAY); it.filled_rectangle(312, 200, 8, 8, BLACK); });
+    bool two_bpp = false;
+    for (auto const &load : this->panel.sim().get_loads())
+    {
+        two_bpp |= load.pixel_mode == 0;
+    }
+    EXPECT_TRUE(two_bpp);
+    EXPECT_EQ(this->panel.count_panel(304, 200, 40, 8, 0x05), 32u * 8u);
+    EXPECT_EQ(this->panel.count_panel(312, 200, 8, 8, 0x00), 8u * 8u);
+
+    // The image buffer stays a full 4bpp copy of the frame
+    uint8_t levels[128];
+    ASSERT_TRUE(this->panel.get().read_area(64, 40, 128, 1, levels));
+    for (uint16_t i = 0; i < 128; i++)
+    {
+        EXPECT_EQ(levels[i], 0x07) << "pixel " << i;
+    }
+    ASSERT_TRUE(this->panel.get().read_area(96, 50, 32, 1, levels));
+    for (uint16_t i = 0; i < 32; i++)
+    {
+        EXPECT_EQ(levels[i], 0x00) << "pixel " << i;
+    }
+}
+
+TEST_F(DisplayTest, SolidAreasNeedNoImageData)
+{
+    this->panel.get().set_packed_transfers(true);
+    this->panel.get().set_transfer_buffer_size(4096);
+    this->panel.setup();
+
+    this->panel.get().set_writer([](display::Display &it) { it.filled_rectangle(320, 160, 64, 32, BLACK); });
+    this->panel.get().update();
+    EXPECT_TRUE(this->panel.sim().get_loads().empty());
+    ASSERT_EQ(this->panel.sim().get_refreshes().size(), 1u);
+    EXPECT_TRUE(this->panel.sim().get_refreshes()[0].one_bpp);
+
+    this->panel.settle();
+    EXPECT_EQ(this->panel.count_panel(320, 160, 64, 32, 0x00), 64u * 32u);
+
+    // The image buffer is restored before it is read
+    uint8_t levels[64];
+    ASSERT_TRUE(this->panel.get().read_area(320, 170, 64, 1, levels));
+    for (uint16_t i = 0; i < 64; i++)
+    {
+        EXPECT_EQ(levels[i], 0x00) << "pixel " << i;
+    }
+}
+
+/**
+ * @brief Draw the same frame with software and hardware rotation, the panels must match
+ */
+class RotationTest : public ::testing::TestWithParam<display::DisplayRotation>
+{
+};
+
+TEST_P(RotationTest, HardwareRotationMatchesSoftwareRotation)
+{
+    auto const writer = [](display::Display &it) {
+        it.fill(WHITE);
+        it.filled_rectangle(3, 5, 101, 37, BLACK);
+        it.filled_rectangle(it.get_width() - 50, it.get_height() - 20, 50, 20, GRAY);
+        it.line(0, 0, 200, 300, BLACK);
+    };
+
+    Panel software;
+    software.get().set_rotation(GetParam());
+    software.setup();
+    software.draw(writer);
+    software.expect_no_errors();
+
+    Panel hardware;
+    hardware.get().set_rotation(GetParam());
+    hardware.get().set_hardware_rotation(true);
+    hardware.setup();
+    hardware.draw(writer);
+    hardware.expect_no_errors();
+
+    size_t differences = 0;
+    for (uint16_t y = 0; y < HEIGHT; y++)
+    {
+        for (uint16_t x = 0; x < WIDTH; x++)
+        {
+            differences += software.panel(x, y) != hardware.panel(x, y);
+        }
+    }
+    EXPECT_EQ(differences, 0u);
+    EXPECT_GT(software.count_panel(0, 0, WIDTH, HEIGHT, 0x00), 101u * 37u);
+}
+
+INSTANTIATE_TEST_SUITE_P(AllRotations, RotationTest,
+                         ::testing::Values(display::DISPLAY_ROTATION_0_DEGREES, display::DISPLAY_ROTATION_90_DEGREES,
+                                           display::DISPLAY_ROTATION_180_DEGREES, display::DISPLAY_ROTATION_270_DEGREES));
+
+TEST_F(DisplayTest, FlushTaskDrawsTheFrames)
+{
+    this->panel.use_flush_task();
+    this->panel.setup();
+
+    for (int frame = 0; frame < 4; frame++)
+    {
+        this->panel.draw([frame](display::Display &it) {
+            it.fill(WHITE);
+            it.filled_rectangle(100 * frame, 100, 80, 80, BLACK);
+        });
+        EXPECT_EQ(this->panel.count_panel(100 * frame, 100, 80, 80, 0x00), 80u * 80u) << "frame " << frame;
+        EXPECT_EQ(this->panel.count_panel(0, 0, WIDTH, HEIGHT, 0x00), 80u * 80u) << "frame " << frame;
+    }
+}
+
+TEST_F(DisplayTest, OverlappingRefreshesWait)
+{
+    this->panel.sim().set_refresh_time(450);
+    this->panel.setup();
+
+    // Each frame changes the area the previous refresh is still running on
+    for (int frame = 0; frame < 6; frame++)
+    {
+        this->panel.get().set_writer([frame](display::Display &it) {
+            it.fill(WHITE);
+            it.filled_rectangle(200 + 10 * frame, 200, 100, 100, BLACK);
+        });
+        this->panel.get().update();
+        for (int i = 0; i < 10; i++)
+        {
+            this->panel.get().loop();
+            host::advance_us(10000);
+        }
+    }
+    this->panel.settle();
+    EXPECT_EQ(this->panel.count_panel(250, 200, 100, 100, 0x00), 100u * 100u);
+    EXPECT_EQ(this->panel.count_panel(0, 0, WIDTH, HEIGHT, 0x00), 100u * 100u);
+}
+
+TEST_F(DisplayTest, DoubleBufferingLoadsWhileRefreshing)
+{
+    this->panel.sim().set_refresh_time(450);
+    this->panel.get().set_double_buffering(true);
+    this->panel.setup();
+
+    for (int frame = 0; frame < 4; frame++)
+    {
+        this->panel.get().set_writer([frame](display::Display &it) {
+            it.fill(WHITE);
+            it.filled_rectangle(200, 200, 100, 100, (frame & 1) ? BLACK : GRAY);
+        });
+        this->panel.get().update();
+        for (int i = 0; i < 20; i++)
+        {
+            this->panel.get().loop();
+            host::advance_us(10000);
+        }
+    }
+    this->panel.settle();
+    EXPECT_EQ(this->panel.count_panel(200, 200, 100, 100, 0x00), 100u * 100u);
+}
+
+TEST_F(DisplayTest, BandsDrawTheWholeFrame)
+{
+    this->panel.get().set_band_rows(64);
+    this->panel.setup();
+
+    this->panel.draw([](display::Display &it) {
+        it.fill(WHITE);
+        it.filled_rectangle(0, 60, WIDTH, 10, BLACK);
+        it.filled_rectangle(300, 500, 40, 40, GRAY);
+    });
+    EXPECT_EQ(this->panel.count_panel(0, 60, WIDTH, 10, 0x00), WIDTH * 10u);
+    EXPECT_EQ(this->panel.count_panel(300, 500, 40, 40, 0x05), 40u * 40u);
+    EXPECT_EQ(this->panel.count_panel(0, 0, WIDTH, HEIGHT, 0x0F), static_cast<size_t>(WIDTH) * HEIGHT - WIDTH * 10 - 40 * 40);
+}
+
+TEST_F(DisplayTest, PageSlotsBeyondTheControllerMemoryFail)
+{
+    this->panel.get().set_page_slots(8);
+    this->panel.get().set_controller_memory(4 * 1024 * 1024);
+    // Like the application, do not run a failed display
+    this->panel.get().set_reset_pin(this->panel.sim().get_reset_pin());
+    this->panel.get().set_ready_pin(this->panel.sim().get_ready_pin());
+    this->panel.get().set_cs_pin(this->panel.sim().get_cs_pin());
+    this->panel.get().setup();
+
+    EXPECT_TRUE(this->panel.get().is_failed());
+    host::take_error_count();
+}
+
+TEST_F(DisplayTest, PreloadedPagesAreShown)
+{
+    this->panel.get().set_page_slots(2);
+    this->panel.setup();
+
+    display::DisplayPage first([](display::Display &it) {
+        it.fill(WHITE);
+        it.filled_rectangle(0, 0, 100, 100, BLACK);
+    });
+    display::DisplayPage second([](display::Display &it) {
+        it.fill(WHITE);
+        it.filled_rectangle(500, 300, 100, 100, BLACK);
+    });
+
+    this->panel.get().preload_page(0, &first);
+    this->panel.get().preload_page(1, &second);
+    this->panel.settle();
+    EXPECT_EQ(this->panel.count_panel(0, 0, WIDTH, HEIGHT, 0x00), 0u);
+
+    this->panel.get().show_page(1);
+    this->panel.settle();
+    EXPECT_EQ(this->panel.count_panel(500, 300, 100, 100, 0x00), 100u * 100u);
+    EXPECT_EQ(this->panel.count_panel(0, 0, WIDTH, HEIGHT, 0x00), 100u * 100u);
+
+    this->panel.get().show_page(0);
+    this->panel.settle();
+    EXPECT_EQ(this->panel.count_panel(0, 0, 100, 100, 0x00), 100u * 100u);
+    EXPECT_EQ(this->panel.count_panel(0, 0, WIDTH, HEIGHT, 0x00), 100u * 100u);
+}
+
+TEST_F(DisplayTest, PowerSavingSleepsAndWakes)
+{
+    this->panel.get().set_power_saving(1000, true);
+    this->panel.setup();
+
+    this->panel.draw([](display::Display &it) { it.filled_rectangle(10, 10, 20, 20, BLACK); });
+    for (int i = 0; i < 400; i++)
+    {
+        this->panel.get().loop();
+        host::advance_us(10000);
+    }
+    EXPECT_TRUE(this->panel.sim().is_asleep());
+
+    this->panel.draw([](display::Display &it) { it.filled_rectangle(100, 10, 20, 20, BLACK); });
+    EXPECT_EQ(this->panel.count_panel(100, 10, 20, 20, 0x00), 400u);
+    EXPECT_EQ(this->panel.count_panel(10, 10, 20, 20, 0x00), 400u);
+}
+
+TEST_F(DisplayTest, SpiAutoTuneFindsTheWorkingRate)
+{
+    this->panel.sim().set_max_rates(26000000, 16000000);
+    this->panel.get().set_spi_auto_tune(40000000, 20000000);
+    this->panel.setup();
+
+    this->panel.draw([](display::Display &it) {
+        it.fill(WHITE);
+        it.filled_rectangle(40, 40, 300, 200, BLACK);
+    });
+    EXPECT_EQ(this->panel.count_panel(40, 40, 300, 200, 0x00), 300u * 200u);
+    EXPECT_EQ(this->panel.count_panel(0, 0, WIDTH, HEIGHT, 0x0F), static_cast<size_t>(WIDTH) * HEIGHT - 300 * 200);
+
+    uint8_t levels[300];
+    ASSERT_TRUE(this->panel.get().read_area(40, 100, 300, 1, levels));
+    for (uint16_t i = 0; i < 300; i++)
+    {
+        EXPECT_EQ(levels[i], 0x00) << "pixel " << i;
+    }
+}
+
+TEST_F(DisplayTest, SpiAutoTuneKeepsRatesThroughSlowCommands)
+{
+    struct
+    {
+        uint32_t write;
+        uint32_t read;
+    } rates = {};
+    auto preference = global_preferences->make_preference<decltype(rates)>(fnv1_hash("it8951e_bus_rates"));
+
+    this->panel.sim().set_max_rates(40000000, 20000000);
+    this->panel.get().set_spi_auto_tune(40000000, 20000000);
+    this->panel.setup();
+    ASSERT_TRUE(preference.load(&rates));
+    EXPECT_EQ(rates.write, 40000000u);
+    EXPECT_EQ(rates.read, 20000000u);
+
+    // HRDY times out while the rates still verify: only the third report lowers the rate in use, commands run at the
+    // read rate
+    for (int report = 1; report <= 3; report++)
+    {
+        this->panel.sim().stall_hrdy(3500000);
+        this->panel.draw([report](display::Display &it) { it.filled_rectangle(10 * report, 10, 10, 10, BLACK); });
+
+        ASSERT_TRUE(preference.load(&rates));
+        EXPECT_EQ(rates.write, 40000000u) << "report " << report;
+        EXPECT_EQ(rates.read, (report < 3) ? 20000000u : 16000000u) << "report " << report;
+    }
+
+    // The commands that timed out are lost
+    this->panel.sim().clear_errors();
+    host::take_error_count();
+}
+
+TEST_F(DisplayTest, SpiAutoTuneLowersRatesFailingVerification)
+{
+    struct
+    {
+        uint32_t write;
+        uint32_t read;
+    } rates = {};
+    auto preference = global_preferences->make_preference<decltype(rates)>(fnv1_hash("it8951e_bus_rates"));
+
+    this->panel.sim().set_max_rates(40000000, 20000000);
+    this->panel.get().set_spi_auto_tune(40000000, 20000000);
+    this->panel.setup();
+
+    // The controller no longer keeps up with the read rate
+    this->panel.sim().set_max_rates(40000000, 16000000);
+    this->panel.sim().stall_hrdy(3500000);
+    this->panel.draw([](display::Display &it) { it.filled_rectangle(10, 10, 10, 10, BLACK); });
+
+    ASSERT_TRUE(preference.load(&rates));
+    EXPECT_EQ(rates.write, 40000000u);
+    EXPECT_EQ(rates.read, 16000000u);
+
+    this->panel.sim().clear_errors();
+    host::take_error_count();
+}
+
+TEST_F(DisplayTest, ClearWhitensThePanel)
+{
+    this->panel.setup();
+    this->panel.draw([](display::Display &it) { draw_image(it, 0, 0, 300, 300, BLACK); });
+    this->panel.get().clear();
+    this->panel.settle();
+    EXPECT_EQ(this->panel.count_panel(0, 0, WIDTH, HEIGHT, 0x0F), static_cast<size_t>(WIDTH) * HEIGHT);
+}
+
+} // namespace
+} // namespace it8951e
+} // namespace esphome
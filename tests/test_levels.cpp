@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "it8951e_levels.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace esphome {
+namespace it8951e {
+namespace {
+
+constexpr uint16_t WIDTH = 128;
+constexpr uint16_t HEIGHT = 16;
+constexpr size_t STRIDE = WIDTH / 2;
+
+constexpr uint16_t level(uint8_t const l) { return 1u << l; }
+
+class Frame
+{
+    public:
+        Frame(uint8_t const fill = 0xF) : data(STRIDE * HEIGHT, fill * 0x11) {}
+
+        void set(uint16_t const x, uint16_t const y, uint8_t const l)
+        {
+            uint8_t &byte = this->data[y * STRIDE + (x >> 1)];
+            byte = (x & 1) ? ((byte & 0xF0) | l) : ((byte & 0x0F) | (l << 4));
+        }
+
+        uint8_t const *get() const { return this->data.data(); }
+
+    private:
+        std::vector<uint8_t> data;
+};
+
+TEST(ScanLevels, FindsTheLevelsOfTheArea)
+{
+    Frame frame;
+    frame.set(10, 2, 0);
+    frame.set(11, 3, 5);
+
+    EXPECT_EQ(scan_levels(frame.get(), STRIDE, Area{0, 0, WIDTH, HEIGHT}), level(15) | level(0) | level(5));
+    EXPECT_EQ(scan_levels(frame.get(), STRIDE, Area{8, 2, 4, 1}), level(15) | level(0));
+    EXPECT_EQ(scan_levels(frame.get(), STRIDE, Area{8, 3, 4, 1}), level(15) | level(5));
+}
+
+TEST(ScanLevels, IgnoresPixelsOutsideOfTheArea)
+{
+    Frame frame;
+    frame.set(3, 0, 0);
+    frame.set(12, 0, 7);
+    frame.set(8, 9, 3);
+
+    EXPECT_EQ(scan_levels(frame.get(), STRIDE, Area{4, 0, 8, 9}), level(15));
+}
+
+TEST(ScanLevels, SolidArea)
+{
+    Frame frame(0x0A);
+    EXPECT_EQ(scan_levels(frame.get(), STRIDE, Area{0, 0, WIDTH, HEIGHT}), level(10));
+}
+
+TEST(ScanLevels, ClampsToTheStride)
+{
+    Frame frame(0x00);
+    EXPECT_EQ(scan_levels(frame.get(), STRIDE, Area{WIDTH - 4, 0, 8, 1}), level(0));
+}
+
+TEST(ScanLevels, ReportsAtLeastThreeLevelsWhenStoppingEarly)
+{
+    Frame frame;
+    frame.set(0, 0, 1);
+    frame.set(1, 0, 2);
+    frame.set(0, 15, 0);
+
+    uint16_t const levels = scan_levels(frame.get(), STRIDE, Area{0, 0, WIDTH, HEIGHT});
+    EXPECT_EQ(levels & (level(1) | level(2) | level(15)), level(1) | level(2) | level(15));
+    EXPECT_EQ(select_update_mode(levels), UpdateMode::GLR16);
+}
+
+TEST(SelectUpdateMode, PicksTheFastestModeForTheLevels)
+{
+    EXPECT_EQ(select_update_mode(level(0) | level(15)), UpdateMode::DU);
+    EXPECT_EQ(select_update_mode(level(0)), UpdateMode::DU);
+    EXPECT_EQ(select_update_mode(level(15)), UpdateMode::DU);
+    EXPECT_EQ(select_update_mode(level(0) | level(5)), UpdateMode::DU4);
+    EXPECT_EQ(select_update_mode(LEVELS_DU4), UpdateMode::DU4);
+    EXPECT_EQ(select_update_mode(level(10)), UpdateMode::DU4);
+    EXPECT_EQ(select_update_mode(level(0) | level(7)), UpdateMode::GLR16);
+    EXPECT_EQ(select_update_mode(0xFFFF), UpdateMode::GLR16);
+}
+
+TEST(SelectPacking, UnknownLevelsUse4bpp)
+{
+    EXPECT_EQ(select_packing(Area{0, 0, 64, 8}, 0, true, 4096), 4);
+}
+
+TEST(SelectPacking, SolidAlignedAreasNeedNoData)
+{
+    EXPECT_EQ(select_packing(Area{0, 0, 64, 8}, level(3), true, 4096), 0);
+
+    // Even without packed transfers
+    EXPECT_EQ(select_packing(Area{32, 0, 64, 8}, level(3), true, 0), 0);
+
+    // Not where 1bpp is ruled out, or the area is not aligned to 32 pixels
+    EXPECT_EQ(select_packing(Area{0, 0, 64, 8}, level(3), false, 4096), 2 + 2 * 1);
+    EXPECT_EQ(select_packing(Area{16, 0, 64, 8}, level(15), true, 0), 4);
+}
+
+TEST(SelectPacking, TwoLevelsUse1bpp)
+{
+    EXPECT_EQ(select_packing(Area{0, 0, 64, 8}, level(0) | level(7), true, 4096), 1);
+
+    // A packed row must fit the transfer buffer
+    EXPECT_EQ(select_packing(Area{0, 0, 64, 8}, level(0) | level(7), true, 8), 1);
+    EXPECT_EQ(select_packing(Area{0, 0, 64, 8}, level(0) | level(7), true, 7), 4);
+
+    // Not aligned to 32 pixels: 2bpp if the levels allow it
+    EXPECT_EQ(select_packing(Area{8, 0, 64, 8}, level(0) | level(15), true, 4096), 2);
+    EXPECT_EQ(select_packing(Area{8, 0, 64, 8}, level(0) | level(7), true, 4096), 4);
+    EXPECT_EQ(select_packing(Area{0, 0, 64, 8}, level(0) | level(15), false, 4096), 2);
+}
+
+TEST(SelectPacking, Du4LevelsUse2bpp)
+{
+    EXPECT_EQ(select_packing(Area{8, 0, 64, 8}, LEVELS_DU4, true, 4096), 2);
+    EXPECT_EQ(select_packing(Area{0, 0, 64, 8}, LEVELS_DU4, true, 4096), 2);
+
+    // Alignment and buffer size
+    EXPECT_EQ(select_packing(Area{4, 0, 64, 8}, LEVELS_DU4, true, 4096), 4);
+    EXPECT_EQ(select_packing(Area{8, 0, 60, 8}, LEVELS_DU4, true, 4096), 4);
+    EXPECT_EQ(select_packing(Area{8, 0, 64, 8}, LEVELS_DU4, true, 16), 2);
+    EXPECT_EQ(select_packing(Area{8, 0, 64, 8}, LEVELS_DU4, true, 15), 4);
+}
+
+TEST(SelectPacking, OtherContentUses4bpp)
+{
+    EXPECT_EQ(select_packing(Area{0, 0, 64, 8}, level(0) | level(5) | level(7), true, 4096), 4);
+    EXPECT_EQ(select_packing(Area{0, 0, 64, 8}, LEVELS_DU4, true, 0), 4);
+    EXPECT_EQ(select_packing(Area{0, 0, 64, 8}, level(0) | level(15), true, 0), 4);
+}
+
+} // namespace
+} // namespace it8951e
+} // namespace esphome
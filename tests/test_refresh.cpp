@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "it8951e_refresh.h"
+
+#include <gtest/gtest.h>
+
+namespace esphome {
+namespace it8951e {
+namespace {
+
+constexpr Area LEFT{0, 0, 100, 100};
+constexpr Area RIGHT{200, 0, 100, 100};
+constexpr Area OVERLAPPING_LEFT{96, 96, 8, 8};
+constexpr Area TOUCHING_LEFT{100, 0, 100, 100};
+constexpr uint32_t IMAGE = 0x1236E0;
+constexpr uint32_t BACK = IMAGE + 960 * 540;
+
+TEST(RefreshScheduler, StartsAnythingWhenIdle)
+{
+    RefreshScheduler scheduler;
+    EXPECT_TRUE(scheduler.can_start(LEFT, 0));
+    EXPECT_EQ(scheduler.get_in_flight(), 0u);
+    EXPECT_EQ(scheduler.get_next_end(1000), 0u);
+}
+
+TEST(RefreshScheduler, BlocksOverlappingAreas)
+{
+    RefreshScheduler scheduler;
+    scheduler.start(LEFT, UpdateMode::GC16, 1000, 0, IMAGE);
+
+    EXPECT_FALSE(scheduler.can_start(LEFT, 0x0001));
+    EXPECT_FALSE(scheduler.can_start(OVERLAPPING_LEFT, 0x0001));
+    EXPECT_TRUE(scheduler.can_start(TOUCHING_LEFT, 0x0001));
+    EXPECT_TRUE(scheduler.can_start(RIGHT, 0x0001));
+}
+
+TEST(RefreshScheduler, BlocksWhenAllEnginesAreBusy)
+{
+    RefreshScheduler scheduler;
+    EXPECT_FALSE(scheduler.can_start(RIGHT, 0xFFFF));
+    EXPECT_TRUE(scheduler.can_start(RIGHT, 0x7FFF));
+}
+
+TEST(RefreshScheduler, LimitsTheRefreshesInFlight)
+{
+    RefreshScheduler scheduler;
+    for (size_t i = 0; i < RefreshScheduler::MAX_IN_FLIGHT + 2; i++)
+    {
+        scheduler.start(Area{static_cast<uint16_t>(i * 8), 0, 4, 4}, UpdateMode::DU, 0, 0, IMAGE);
+    }
+    EXPECT_EQ(scheduler.get_in_flight(), RefreshScheduler::MAX_IN_FLIGHT);
+    EXPECT_FALSE(scheduler.can_start(Area{500, 500, 4, 4}, 0));
+}
+
+TEST(RefreshScheduler, IgnoresRefreshesWithoutMode)
+{
+    RefreshScheduler scheduler;
+    scheduler.start(LEFT, UpdateMode::None, 0, 0, IMAGE);
+    scheduler.start(LEFT, UpdateMode::Auto, 0, 0, IMAGE);
+    EXPECT_EQ(scheduler.get_in_flight(), 0u);
+}
+
+TEST(RefreshScheduler, UpdateKeepsTheRefreshesOfBusyEngines)
+{
+    RefreshScheduler scheduler;
+    scheduler.start(LEFT, UpdateMode::GC16, 1000, 0, IMAGE);
+    scheduler.start(RIGHT, UpdateMode::GC16, 1010, 0, IMAGE);
+
+    RefreshSample done[RefreshScheduler::MAX_IN_FLIGHT];
+    EXPECT_EQ(scheduler.update(0x0003, 1100, done), 0u);
+    EXPECT_EQ(scheduler.get_in_flight(), 2u);
+}
+
+TEST(RefreshScheduler, UpdateRetiresTheRefreshExpectedToEndFirst)
+{
+    RefreshScheduler scheduler;
+    // GC16 started first, but the DU refresh started later ends first
+    scheduler.start(LEFT, UpdateMode::GC16, 1000, 1234, IMAGE);
+    scheduler.start(RIGHT, UpdateMode::DU, 1100, 567, IMAGE);
+
+    RefreshSample done[RefreshScheduler::MAX_IN_FLIGHT];
+    ASSERT_EQ(scheduler.update(0x0001, 1370, done), 1u);
+    EXPECT_EQ(done[0].mode, UpdateMode::DU);
+    EXPECT_EQ(done[0].transfer_us, 567u);
+    EXPECT_EQ(done[0].busy_ms, 270u);
+
+    // The right half is free again, the left one is still refreshing
+    EXPECT_TRUE(scheduler.can_start(RIGHT, 0x0001));
+    EXPECT_FALSE(scheduler.can_start(LEFT, 0x0001));
+
+    ASSERT_EQ(scheduler.update(0x0000, 1460, done), 1u);
+    EXPECT_EQ(done[0].mode, UpdateMode::GC16);
+    EXPECT_EQ(done[0].busy_ms, 460u);
+    EXPECT_EQ(scheduler.get_in_flight(), 0u);
+    EXPECT_TRUE(scheduler.can_start(LEFT, 0));
+}
+
+TEST(RefreshScheduler, UpdateRetiresAllWhenIdle)
+{
+    RefreshScheduler scheduler;
+    for (uint16_t i = 0; i < 5; i++)
+    {
+        scheduler.start(Area{static_cast<uint16_t>(i * 100), 0, 50, 50}, UpdateMode::DU4, 2000 + i, 0, IMAGE);
+    }
+
+    RefreshSample done[RefreshScheduler::MAX_IN_FLIGHT];
+    EXPECT_EQ(scheduler.update(0, 3000, done), 5u);
+    EXPECT_EQ(scheduler.get_in_flight(), 0u);
+}
+
+TEST(RefreshScheduler, NextEndFollowsTheModeDurations)
+{
+    RefreshScheduler scheduler;
+    scheduler.start(LEFT, UpdateMode::GC16, 1000, 0, IMAGE);
+    scheduler.start(RIGHT, UpdateMode::DU4, 1000, 0, IMAGE);
+
+    uint32_t const du4_end = scheduler.get_next_end(1000);
+    EXPECT_GT(du4_end, 0u);
+    EXPECT_LT(du4_end, 450u);
+
+    // Overdue refreshes report 0
+    EXPECT_EQ(scheduler.get_next_end(1000 + 5000), 0u);
+}
+
+TEST(RefreshScheduler, ClearForgetsAllRefreshes)
+{
+    RefreshScheduler scheduler;
+    scheduler.start(LEFT, UpdateMode::GC16, 0, 0, IMAGE);
+    scheduler.clear();
+    EXPECT_EQ(scheduler.get_in_flight(), 0u);
+    EXPECT_TRUE(scheduler.can_start(LEFT, 0));
+}
+
+TEST(RefreshScheduler, CanLoadTheOtherFrame)
+{
+    RefreshScheduler scheduler;
+    scheduler.start(LEFT, UpdateMode::GC16, 0, 0, IMAGE);
+
+    EXPECT_FALSE(scheduler.can_load(OVERLAPPING_LEFT, IMAGE));
+    EXPECT_TRUE(scheduler.can_load(OVERLAPPING_LEFT, BACK));
+    EXPECT_TRUE(scheduler.can_load(RIGHT, IMAGE));
+}
+
+} // namespace
+} // namespace it8951e
+} // namespace esphome